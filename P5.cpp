@@ -10,13 +10,62 @@ using namespace LILC;
 int
 main( const int argc, const char **argv )
 {
-   if (argc != 3){
-	std::cout << "Usage: P5 <infile> <outfile>" << std::endl;
+   if (argc < 3){
+	std::cout << "Usage: P5 <infile> <outfile> [-c] [-ir] [-bc] [-S] [-O] [-unroll <factor>] [-fuel <steps>] [-layout declared|packed|hot] [-profile-gen <file>] [-profile-use <file>] [-sample <file>] [-report] [-run] [-jit] [-bench]" << std::endl;
 	return 1;
    }
 
    LILC::LilC_Compiler compiler;
+   for (int i = 3; i < argc; i++){
+	if (strcmp(argv[i], "-c") == 0){
+		compiler.setEmit(LILC::EmitKind::C);
+	} else if (strcmp(argv[i], "-ir") == 0){
+		compiler.setEmit(LILC::EmitKind::IR);
+	} else if (strcmp(argv[i], "-bc") == 0){
+		compiler.setEmit(LILC::EmitKind::Bytecode);
+	} else if (strcmp(argv[i], "-S") == 0){
+		compiler.setEmit(LILC::EmitKind::Asm);
+	} else if (strcmp(argv[i], "-O") == 0){
+		compiler.setOptimize(true);
+	} else if (strcmp(argv[i], "-unroll") == 0 && i + 1 < argc){
+		compiler.setUnroll(atoi(argv[++i]));
+	} else if (strcmp(argv[i], "-fuel") == 0 && i + 1 < argc){
+		compiler.setFuel(atol(argv[++i]));
+	} else if (strcmp(argv[i], "-layout") == 0 && i + 1 < argc){
+		i++;
+		if (strcmp(argv[i], "declared") == 0){
+			compiler.setLayout(LILC::LayoutMode::Declared);
+		} else if (strcmp(argv[i], "packed") == 0){
+			compiler.setLayout(LILC::LayoutMode::Packed);
+		} else if (strcmp(argv[i], "hot") == 0){
+			compiler.setLayout(LILC::LayoutMode::Hot);
+		} else {
+			std::cout << "Unknown layout: " << argv[i] << std::endl;
+			return 1;
+		}
+	} else if (strcmp(argv[i], "-profile-gen") == 0 && i + 1 < argc){
+		compiler.setProfileGen(argv[++i]);
+		compiler.setRun(true);
+	} else if (strcmp(argv[i], "-profile-use") == 0 && i + 1 < argc){
+		compiler.setProfileUse(argv[++i]);
+	} else if (strcmp(argv[i], "-sample") == 0 && i + 1 < argc){
+		compiler.setSample(argv[++i]);
+		compiler.setRun(true);
+	} else if (strcmp(argv[i], "-report") == 0){
+		compiler.setReport(&std::cerr);
+	} else if (strcmp(argv[i], "-run") == 0){
+		compiler.setRun(true);
+	} else if (strcmp(argv[i], "-jit") == 0){
+		compiler.setJIT(true);
+	} else if (strcmp(argv[i], "-bench") == 0){
+		compiler.setBench(true);
+	} else {
+		std::cout << "Unknown option: " << argv[i] << std::endl;
+		return 1;
+	}
+   }
    // compiler.nameAnalysis( argv[1], argv[2] );
-   compiler.typeAnalysis( argv[1], argv[2] ); //typeAnalysis extends nameAnalysis in terms of execution
-   return 0;
+   // compiler.typeAnalysis( argv[1], argv[2] );
+   //compile extends typeAnalysis with the optimization passes
+   return compiler.compile( argv[1], argv[2] ) ? 0 : 1;
 }
@@ -4,11 +4,25 @@
 #include <iostream>  // For outputting type errors
 #include <ostream>
 #include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "tokens.hpp"
+#include "bitvector.hpp"
+#include "string_pool.hpp"
 
 namespace LILC{
 
 class SymbolTable;
+class CallGraph;
+class IRLowering;
+struct IRModule;
+struct IRLoc;
+struct IRStructInfo;
+struct FnProfile;
+class Profile;
 
 class DeclListNode;
 class StmtListNode;
@@ -17,10 +31,169 @@ class DeclNode;
 class StmtNode;
 class AssignNode;
 class FormalDeclNode;
+class FnDeclNode;
+class StructDeclNode;
+class VarDeclNode;
 class TypeNode;
 class ExpNode;
 class IdNode;
 
+enum class TypeKind { Int, Bool, Void, String, Struct, StructName, Fn, Error };
+
+/*
+* A type as type analysis sees it. name is the struct's for Struct
+* (a variable of that struct type) and StructName (the type itself),
+* and the function's for Fn. Error is the type of an expression
+* already reported, so that one mistake is reported once.
+*/
+struct SemType{
+	TypeKind kind;
+	std::string name;
+	bool operator==(const SemType& other) const {
+		return kind == other.kind && name == other.name;
+	}
+	bool operator!=(const SemType& other) const { return !(*this == other); }
+};
+
+typedef std::unordered_map<std::string, SemType> SemScope;
+
+struct FnSignature{
+	std::vector<SemType> formals;
+	SemType ret;
+};
+
+/*
+* The state of type analysis: the names in scope, the fields of each
+* struct type, the signature of each function and the result type of
+* the function being checked.
+*/
+struct TypeChecker{
+	std::vector<SemScope> scopes;
+	std::unordered_map<std::string, SemScope> structs;
+	std::unordered_map<std::string, FnSignature> functions;
+	SemType retType;
+	int errors = 0;
+	void error(const std::string& message);
+	void declare(const std::string& name, SemType type);
+	SemType lookup(const std::string& name);
+};
+
+/*
+* State of the backward liveness walk over one function body that
+* dead-store elimination makes; see dead_stores.cpp. Keys name a
+* local or formal, or a field of a local struct by its path, such
+* as p.pos.x, and get a dense index into the live set the first
+* time they are met. Globals are never keys: calls may read them and
+* they outlive the function.
+*/
+struct LiveVars{
+	LiveVars(const std::set<std::string>& globalNames) : globals(globalNames) { }
+	bool isLocal(const std::string& key);
+	bool isDead(const std::string& key);
+	void use(const std::string& key);
+	void def(const std::string& key);
+	size_t indexOf(const std::string& key);
+
+	const std::set<std::string>& globals;
+	std::unordered_map<std::string, size_t> indices; // dense, in order met
+	BitVector live;
+	std::set<std::string> referenced; // locals named by the code kept
+	bool transform = true;            // remove dead stores while walking
+	int removed = 0;
+};
+
+/*
+* State of the C emitter; see emit_c.cpp. scope says what a
+* variable declaration is met as, and temps counts the int
+* temporaries the function being emitted needs, named t0, t1, ...
+*/
+struct CEmitter{
+	enum Scope { Global, Field, Local };
+	Scope scope = Global;
+	int temps = 0;
+	std::set<int> strings; // the pool's literals the code refers to
+};
+
+/*
+* A loop test unrolling recognizes: var, a plain local, compared
+* with the constant bound; see unroll.cpp.
+*/
+struct LoopTest{
+	enum Rel { Lt, Le, Gt, Ge, Ne };
+	std::string var;
+	Rel rel;
+	int bound;
+};
+
+/*
+* State of loop unrolling over one function body; see unroll.cpp.
+* factor is how many copies of the body an iteration of a partially
+* unrolled loop runs. Globals never count a loop, since any call
+* may assign them. profile holds the function's counts under
+* -profile-use, which leave cold loops alone and unroll hot ones.
+*/
+struct Unroller{
+	Unroller(const std::set<std::string>& globalNames, int unrollFactor)
+	  : globals(globalNames), factor(unrollFactor) { }
+
+	const std::set<std::string>& globals;
+	int factor;
+	int full = 0;     // loops replaced by copies of their body
+	int partial = 0;  // loops unrolled by some factor
+	const FnProfile * profile = nullptr;
+	int hot = 0;      // loops of unknown trip count unrolled by profile
+	int cold = 0;     // loops left alone, never run when profiled
+};
+
+/*
+* State of compile-time evaluation of calls to pure functions; see
+* eval_calls.cpp. pure names the functions that neither do I/O nor
+* touch a global, directly or through a call. fuel is the number of
+* steps the call being evaluated has left, starting from fuelLimit.
+* An EvalFrame holds the locals of one activation by access path,
+* in order, so that a struct's fields sort right after its name.
+*/
+typedef std::map<std::string, int> EvalFrame;
+enum class EvalStatus { Next, Return, Fail };
+
+struct CallEvaluator{
+	CallEvaluator(long limit) : fuelLimit(limit) { }
+
+	std::unordered_map<std::string, FnDeclNode *> functions;
+	std::set<std::string> pure;
+	long fuelLimit;
+	long fuel = 0;
+	int depth = 0;
+	int result = 0;      // value of the last return executed
+	int evaluated = 0;   // calls replaced by their result
+	int outOfFuel = 0;   // calls given up on for want of fuel
+};
+
+/*
+* How struct layout orders the fields of each struct; see
+* struct_layout.cpp.
+*/
+enum class LayoutMode { Declared, Packed, Hot };
+
+/*
+* State of struct layout. Struct variables and struct-typed fields,
+* the latter named Struct.field, map to their struct's name; heat
+* counts the accesses of each field, weighted by how deeply they are
+* nested in loops, or under -profile-use by how often the block they
+* are in ran. sizes and aligns are in bytes, per struct laid out.
+*/
+struct LayoutContext{
+	std::unordered_map<std::string, StructDeclNode *> structs;
+	std::unordered_map<std::string, std::string> varStructs;
+	std::unordered_map<std::string, std::string> fieldStructs;
+	std::unordered_map<std::string, double> heat;
+	std::vector<VarDeclNode *> structVars;
+	std::unordered_map<std::string, int> sizes;
+	std::unordered_map<std::string, int> aligns;
+	double weight = 1;
+	const FnProfile * profile = nullptr;
+};
+
 class ASTNode{
 public:
 	virtual void unparse(std::ostream& out, int indent) = 0;
@@ -38,6 +211,16 @@ public:
 	}
 	bool typeAnalysis();
 	bool nameAnalysis(SymbolTable * symTab);
+	void elimDeadCode();
+	void lower(IRModule * module, bool probes = false);
+	void buildCallGraph(CallGraph * graph);
+	void elimDeadFunctions(std::ostream * report);
+	void elimDeadStores(std::ostream * report);
+	void unrollLoops(int factor, std::ostream * report);
+	void evalCalls(long fuel, std::ostream * report);
+	void numberSites(Profile * shape, Profile * used, std::ostream * report);
+	void layoutStructs(LayoutMode mode, std::ostream * report);
+	void emitC(std::ostream& out, const StringPool& strings);
 	void unparse(std::ostream& out, int indent);
 private:
 	DeclListNode * myDeclList;
@@ -46,36 +229,86 @@ private:
 
 class DeclNode : public ASTNode{
 public:
+	virtual void typeCheck(TypeChecker * types) = 0;
+	virtual void typeCheckField(TypeChecker * types, SemScope * fields) { }
 	virtual void unparse(std::ostream& out, int indent) = 0;
 	virtual std::string getId() { return "DECLNODE"; }
 	virtual std::string getType() { return "AAAHHH"; }
+	virtual void elimDeadCode() { }
+	virtual void declareFunction(IRLowering * ir) { }
+	virtual void lower(IRLowering * ir) { }
+	virtual void lowerField(IRLowering * ir, IRStructInfo * info) { }
+	virtual void collectUses(CallGraph * graph, int fn, std::set<std::string> * used) { }
+	virtual void elimDeadStores(const std::set<std::string>& globals, std::ostream * report) { }
+	virtual void unrollLoops(const std::set<std::string>& globals, int factor, std::ostream * report) { }
+	virtual void evalCalls(CallEvaluator * ev) { }
+	virtual void countFieldUses(LayoutContext * ctx) { }
+	virtual void numberSites(Profile * shape, Profile * used) { }
+	virtual void emitCPrototype(std::ostream& out) { }
+	virtual void emitC(CEmitter * c, std::ostream& out, int indent) { }
 };
 
 class ExpNode : public ASTNode{
 public:
+	virtual SemType typeCheck(TypeChecker * types) = 0;
 	virtual void unparse(std::ostream& out, int indent) = 0;
 	virtual bool nameAnalysis(SymbolTable * symTab);
 	virtual std::string getType() { return "uhoh"; }
 	virtual std::string getId() { return "uhoh"; }
+	// The source line it starts on, 0 if unknown
+	virtual int line() { return 0; }
+	virtual bool constValue(int & val) { return false; }
+	virtual bool hasSideEffects() { return false; }
+	virtual int lower(IRLowering * ir) = 0;
+	virtual IRLoc lowerLoc(IRLowering * ir);
+	virtual void lowerCond(IRLowering * ir, int ifTrue, int ifFalse);
+	virtual int lowerString(IRLowering * ir);
+	virtual void collectUses(CallGraph * graph, int fn, std::set<std::string> * used) { }
+	virtual std::string accessPath() { return ""; }
+	virtual bool canTrap() { return false; }
+	virtual void liveUses(LiveVars * vars) { }
+	virtual bool assigns(const std::string& var) { return false; }
+	virtual bool loopTest(LoopTest * test) { return false; }
+	virtual ExpNode * clone() = 0;
+	virtual ExpNode * evalCalls(CallEvaluator * ev) { return this; }
+	virtual bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val) { return constValue(val); }
+	virtual void countFieldUses(LayoutContext * ctx) { }
+	virtual void numberSites(FnProfile * fn) { }
+	virtual std::string structType(LayoutContext * ctx) { return ""; }
+	virtual void emitC(CEmitter * c, std::ostream& out) = 0;
 };
 
 class IdNode : public ExpNode{
 public:
 	IdNode(IDToken * token) : ExpNode(){
 		myStrVal = token->value();
+		myLine = token->line;
 	}
 	bool nameAnalysis(SymbolTable * symTab);
+	SemType typeCheck(TypeChecker * types);
+	int lower(IRLowering * ir);
+	IRLoc lowerLoc(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	std::string accessPath() { return myStrVal; }
+	void liveUses(LiveVars * vars);
+	IdNode * clone();
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	std::string structType(LayoutContext * ctx);
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 	std::string getType() { return "id"; }
 	std::string getId() { return myStrVal; }
+	int line() { return myLine; }
 	void setOutputType(std::string s) { outputType = s; }
 private:
 	std::string myStrVal;
+	int myLine;
 	std::string outputType;
 };
 
 class TypeNode : public ASTNode{
 public:
+	virtual SemType semType() = 0;
 	virtual void unparse(std::ostream& out, int indent) = 0;
 	virtual std::string getType() {
 		return "???";
@@ -83,6 +316,8 @@ public:
 	virtual std::string getId() {
 		return "???";
 	}
+	virtual std::string getTypeString() { return getType(); }
+	virtual std::string getCType() { return getType(); }
 };
 
 class VarDeclNode : public DeclNode{
@@ -95,6 +330,16 @@ public:
 	std::string getId() { return myId->getId(); }
 	std::string getType() { return myType->getType(); }
 	bool nameAnalysis(SymbolTable * symTab);
+	void typeCheck(TypeChecker * types);
+	void typeCheckField(TypeChecker * types, SemScope * fields);
+	void lower(IRLowering * ir);
+	void lowerField(IRLowering * ir, IRStructInfo * info);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	void countFieldUses(LayoutContext * ctx);
+	void declareField(LayoutContext * ctx, const std::string& structName);
+	void layoutShape(LayoutContext * ctx, int & size, int & align);
+	int getSize() { return mySize; }
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 	static const int NOT_STRUCT = -1; //Use this value for mySize
 					  // if this is not a struct type
@@ -123,7 +368,33 @@ public:
 		}
 		return list;
 	}
+	bool isEmpty() { return myDecls->empty(); }
+	bool declaresAny(DeclListNode * other);
+	void splice(DeclListNode * other);
 	bool nameAnalysis(SymbolTable * symTab);
+	void elimDeadCode();
+	void typeCheck(TypeChecker * types);
+	void typeCheckFields(TypeChecker * types, SemScope * fields);
+	void declareFunctions(IRLowering * ir);
+	void lower(IRLowering * ir);
+	void lowerFields(IRLowering * ir, IRStructInfo * info);
+	void buildCallGraph(CallGraph * graph,
+	  std::unordered_map<std::string, std::set<std::string>> * uses);
+	void elimDeadFunctions(std::ostream * report);
+	void elimDeadStores(std::ostream * report);
+	void unrollLoops(int factor, std::ostream * report);
+	void evalCalls(long fuel, std::ostream * report);
+	void enterBlock(EvalFrame * frame);
+	void layoutStructs(LayoutMode mode, std::ostream * report);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(Profile * shape, Profile * used);
+	void declareFields(LayoutContext * ctx, const std::string& structName);
+	void layoutFields(LayoutContext * ctx, const std::string& structName,
+	  LayoutMode mode, std::ostream * report);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	int pruneLocals(const std::set<std::string>& referenced);
+	void emitCPrototypes(std::ostream& out);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
 	std::list<DeclNode *> * myDecls;
@@ -131,8 +402,31 @@ private:
 
 class StmtNode : public ASTNode{
 public:
+	virtual void typeCheck(TypeChecker * types) = 0;
 	virtual void unparse(std::ostream& out, int indent) = 0;
 	virtual bool nameAnalysis(SymbolTable * symTab);
+	virtual bool elimDeadCode(DeclListNode * scope, std::list<StmtNode *> * out);
+	virtual void lower(IRLowering * ir) = 0;
+	virtual void collectUses(CallGraph * graph, int fn, std::set<std::string> * used) = 0;
+	virtual bool liveness(LiveVars * vars) = 0;
+	virtual int pruneLocals(const std::set<std::string>& referenced) { return 0; }
+	virtual void unrollLoops(Unroller * u, std::list<StmtNode *> * out);
+	virtual bool unrollable(const std::string& var) = 0;
+	virtual int stmtCount() { return 1; }
+	virtual bool constAssign(std::string & var, int & val) { return false; }
+	virtual int stepOf(const std::string& var) { return 0; }
+	virtual StmtNode * clone() = 0;
+	virtual void evalCalls(CallEvaluator * ev) { }
+	virtual EvalStatus execute(CallEvaluator * ev, EvalFrame * frame) { return EvalStatus::Fail; }
+	virtual bool doesIO() { return false; }
+	virtual void countFieldUses(LayoutContext * ctx) { }
+	virtual void numberSites(FnProfile * fn) { }
+	virtual void emitC(CEmitter * c, std::ostream& out, int indent) = 0;
+	// The source line it starts on, 0 for statements passes made
+	int line() { return myLine; }
+	void setLine(int line) { myLine = line; }
+private:
+	int myLine = 0;
 };
 
 class FormalsListNode : public ASTNode{
@@ -140,7 +434,13 @@ public:
 	FormalsListNode(std::list<FormalDeclNode *> * formalsIn) : ASTNode(){
 		myFormals = formalsIn;
 	}
+	std::string getTypeString();
+	size_t size() { return myFormals->size(); }
+	void bind(const std::vector<int>& args, EvalFrame * frame);
+	void lower(IRLowering * ir);
 	bool nameAnalysis(SymbolTable * symTab);
+	void typeCheck(TypeChecker * types, std::vector<SemType> * formals);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
 	std::list<FormalDeclNode *> * myFormals;
@@ -157,6 +457,20 @@ public:
 		}
 		return true;
 	}
+	void typeCheck(TypeChecker * types, std::vector<SemType> * actuals);
+	bool hasSideEffects();
+	void lower(IRLowering * ir, std::list<int> * vals);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpListNode * clone();
+	void evalCalls(CallEvaluator * ev);
+	bool constValues(std::vector<int> * vals);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, std::vector<int> * vals);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out, const std::string& fn);
 	void unparse(std::ostream& out, int indent);
 private:
 	std::list<ExpNode *> myExps;
@@ -167,7 +481,27 @@ public:
 	StmtListNode(std::list<StmtNode *> * stmtsIn) : ASTNode(){
 		myStmts = stmtsIn;
 	}
+	void spliceInto(std::list<StmtNode *> * out);
 	bool nameAnalysis(SymbolTable * symTab);
+	bool elimDeadCode(DeclListNode * scope);
+	void typeCheck(TypeChecker * types);
+	void lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool liveness(LiveVars * vars);
+	int pruneLocals(const std::set<std::string>& referenced);
+	void unrollLoops(Unroller * u);
+	bool unrollable(const std::string& var);
+	int stepOf(const std::string& var);
+	int stmtCount();
+	StmtListNode * clone();
+	void cloneInto(std::list<StmtNode *> * out);
+	void evalCalls(CallEvaluator * ev);
+	EvalStatus execute(CallEvaluator * ev, EvalFrame * frame);
+	bool doesIO();
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	bool endsInReturn();
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
 	std::list<StmtNode *> * myStmts;
@@ -180,6 +514,20 @@ public:
 		myStmtList = stmts;
 	}
 	bool nameAnalysis(SymbolTable * symTab);
+	void elimDeadCode();
+	void typeCheck(TypeChecker * types);
+	void lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool liveness(LiveVars * vars);
+	int pruneLocals(const std::set<std::string>& referenced);
+	void unrollLoops(Unroller * u) { myStmtList->unrollLoops(u); }
+	void evalCalls(CallEvaluator * ev) { myStmtList->evalCalls(ev); }
+	EvalStatus execute(CallEvaluator * ev, EvalFrame * frame) { return myStmtList->execute(ev, frame); }
+	bool doesIO() { return myStmtList->doesIO(); }
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	bool endsInReturn() { return myStmtList->endsInReturn(); }
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
 	DeclListNode * myDeclList;
@@ -195,13 +543,35 @@ public:
 		myFormals = formals;
 		myBody = fnBody;
 	}
+	std::string getId() { return myId->getId(); }
+	int line() { return myId->line(); }
+	std::string getType() { return "fn"; }
+	std::string getTypeString();
 	bool nameAnalysis(SymbolTable * symTab);
+	void elimDeadCode();
+	void typeCheck(TypeChecker * types);
+	void declareFunction(IRLowering * ir);
+	void lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	void elimDeadStores(const std::set<std::string>& globals, std::ostream * report);
+	void unrollLoops(const std::set<std::string>& globals, int factor, std::ostream * report);
+	void evalCalls(CallEvaluator * ev);
+	bool evalCall(CallEvaluator * ev, const std::vector<int>& args, int & val);
+	std::string getRetType() { return myType->getType(); }
+	bool doesIO() { return myBody->doesIO(); }
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(Profile * shape, Profile * used);
+	void emitCPrototype(std::ostream& out);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
+	void emitCHeader(std::ostream& out);
+
 	TypeNode * myType;
 	IdNode * myId;
 	FormalsListNode * myFormals;
 	FnBodyNode * myBody;
+	FnProfile * myProfile = nullptr; // counts from -profile-use, if any
 };
 
 class FormalDeclNode : public DeclNode{
@@ -210,7 +580,13 @@ public:
 		myType = type;
 		myId = id;
 	}
+	std::string getId() { return myId->getId(); }
+	std::string getTypeString();
+	SemType semType() { return myType->semType(); }
 	bool nameAnalysis(SymbolTable * symTab);
+	void typeCheck(TypeChecker * types);
+	void lower(IRLowering * ir);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 
 private:
@@ -224,7 +600,14 @@ public:
 		myId = id;
 		myDeclList = decls;
 	}
+	std::string getId() { return myId->getId(); }
 	bool nameAnalysis(SymbolTable * symTab);
+	void typeCheck(TypeChecker * types);
+	void lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	void countFieldUses(LayoutContext * ctx);
+	void layout(LayoutContext * ctx, LayoutMode mode, std::ostream * report);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 	static const int NOT_STRUCT = -1; //Use this value for mySize
 					  // if this is not a struct type
@@ -236,6 +619,7 @@ private:
 class IntNode : public TypeNode{
 public:
 	IntNode(): TypeNode(){ }
+	SemType semType() { return SemType{TypeKind::Int}; }
 	void unparse(std::ostream& out, int indent);
 	std::string getType() { return "int"; }
 };
@@ -243,6 +627,7 @@ public:
 class BoolNode : public TypeNode{
 public:
 	BoolNode(): TypeNode(){ }
+	SemType semType() { return SemType{TypeKind::Bool}; }
 	void unparse(std::ostream& out, int indent);
 	std::string getType() { return "bool"; }
 };
@@ -250,6 +635,7 @@ public:
 class VoidNode : public TypeNode{
 public:
 	VoidNode(): TypeNode(){ }
+	SemType semType() { return SemType{TypeKind::Void}; }
 	void unparse(std::ostream& out, int indent);
 	std::string getType() { return "void"; }
 };
@@ -259,9 +645,12 @@ public:
 	StructNode(IdNode * id): TypeNode(){
 		myId = id;
 	}
+	SemType semType() { return SemType{TypeKind::Struct, myId->getId()}; }
 	void unparse(std::ostream& out, int indent);
 	std::string getType() { return "struct"; }
 	std::string getId() { return myId->getId(); }
+	std::string getTypeString() { return myId->getId(); }
+	std::string getCType() { return "struct s_" + myId->getId(); }
 private:
 	IdNode * myId;
 };
@@ -271,24 +660,49 @@ public:
 	IntLitNode(IntLitToken * token): ExpNode(){
 		myInt = token->value();
 	}
+	IntLitNode(int value): ExpNode(){
+		myInt = value;
+	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	int lower(IRLowering * ir);
+	ExpNode * clone();
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	int myInt;
 };
 
+/*
+* A string literal is kept in the program's StringPool, unescaped
+* and shared with every other literal spelled the same.
+*/
 class StrLitNode : public ExpNode{
 public:
-	StrLitNode(StringLitToken * token): ExpNode(){
-		myString = token->value();
-	}
+	StrLitNode(StringPool * pool, StringLitToken * token): ExpNode(){
+		myPool = pool;
+		myIndex = pool->addLiteral(token->value());
+	}
+	SemType typeCheck(TypeChecker * types);
+	int lowerString(IRLowering * ir);
+	int lower(IRLowering * ir);
+	ExpNode * clone();
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
-	 std::string myString;
+	StringPool * myPool;
+	int myIndex;
 };
 
 class TrueNode : public ExpNode{
 public:
 	TrueNode(): ExpNode(){ }
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	int lower(IRLowering * ir);
+	void lowerCond(IRLowering * ir, int ifTrue, int ifFalse);
+	ExpNode * clone();
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 };
@@ -296,6 +710,12 @@ private:
 class FalseNode : public ExpNode{
 public:
 	FalseNode(): ExpNode(){ }
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	int lower(IRLowering * ir);
+	void lowerCond(IRLowering * ir, int ifTrue, int ifFalse);
+	ExpNode * clone();
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 };
 
@@ -307,6 +727,18 @@ public:
 	}
 	bool nameAnalysis(SymbolTable * symTab);
 	std::string getType() { return "dot"; }
+	SemType typeCheck(TypeChecker * types);
+	int line() { return myExp->line(); }
+	int lower(IRLowering * ir);
+	IRLoc lowerLoc(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	std::string accessPath();
+	void liveUses(LiveVars * vars);
+	ExpNode * clone();
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	std::string structType(LayoutContext * ctx);
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp;
@@ -320,6 +752,23 @@ public:
 		myExpRHS = expRHS;
 	}
 	bool nameAnalysis(SymbolTable * symTab);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects() { return true; }
+	int line() { return myExpLHS->line(); }
+	int lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool liveness(LiveVars * vars);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	bool constAssign(std::string & var, int & val);
+	AssignNode * clone();
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out);
+	void emitCAssign(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExpLHS;
@@ -337,8 +786,24 @@ public:
 		myExpList->nameAnalysis(symTab);
 		return true;
 	}
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects() { return true; }
+	int line() { return myId->line(); }
+	int lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	CallExpNode * clone();
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void evalArgs(CallEvaluator * ev);
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
+	int mySite = -1; // see profile.cpp
 	IdNode * myId;
 	ExpListNode * myExpList;
 };
@@ -357,6 +822,20 @@ public:
 		myExp->nameAnalysis(symTab);
 		return true;
 	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects();
+	int lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpNode * clone();
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp;
@@ -371,6 +850,21 @@ public:
 		myExp->nameAnalysis(symTab);
 		return true;
 	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects();
+	int lower(IRLowering * ir);
+	void lowerCond(IRLowering * ir, int ifTrue, int ifFalse);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpNode * clone();
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp;
@@ -393,17 +887,20 @@ public:
 		myExp2->nameAnalysis(symTab);
 		return true;
 	}
-	bool checkType(){
-		std::string type1 = myExp1->getType();
-		std::string type2 = myExp2->getType();
-		if (type1 == "int" && type2 == "int") {
-			std::cerr << "Nice-------~~~~~\n";
-			return true;
-		} else {
-			std::cerr << "Arithmetic operator applied to non-numeric operand\n";
-			return false;
-		}
-	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects();
+	int lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpNode * clone();
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp1;
@@ -421,6 +918,20 @@ public:
 		myExp2->nameAnalysis(symTab);
 		return true;
 	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects();
+	int lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpNode * clone();
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp1;
@@ -438,6 +949,20 @@ public:
 		myExp2->nameAnalysis(symTab);
 		return true;
 	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects();
+	int lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpNode * clone();
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp1;
@@ -455,6 +980,20 @@ public:
 		myExp2->nameAnalysis(symTab);
 		return true;
 	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects();
+	int lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpNode * clone();
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp1;
@@ -472,6 +1011,21 @@ public:
 		myExp2->nameAnalysis(symTab);
 		return true;
 	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects();
+	int lower(IRLowering * ir);
+	void lowerCond(IRLowering * ir, int ifTrue, int ifFalse);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpNode * clone();
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp1;
@@ -489,6 +1043,21 @@ public:
 		myExp2->nameAnalysis(symTab);
 		return true;
 	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects();
+	int lower(IRLowering * ir);
+	void lowerCond(IRLowering * ir, int ifTrue, int ifFalse);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpNode * clone();
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp1;
@@ -506,6 +1075,20 @@ public:
 		myExp2->nameAnalysis(symTab);
 		return true;
 	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects();
+	int lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpNode * clone();
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp1;
@@ -523,6 +1106,21 @@ public:
 		myExp2->nameAnalysis(symTab);
 		return true;
 	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects();
+	int lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	bool loopTest(LoopTest * test);
+	ExpNode * clone();
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp1;
@@ -540,6 +1138,21 @@ public:
 		myExp2->nameAnalysis(symTab);
 		return true;
 	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects();
+	int lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	bool loopTest(LoopTest * test);
+	ExpNode * clone();
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp1;
@@ -557,6 +1170,21 @@ public:
 		myExp2->nameAnalysis(symTab);
 		return true;
 	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects();
+	int lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	bool loopTest(LoopTest * test);
+	ExpNode * clone();
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp1;
@@ -574,6 +1202,21 @@ public:
 		myExp2->nameAnalysis(symTab);
 		return true;
 	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects();
+	int lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	bool loopTest(LoopTest * test);
+	ExpNode * clone();
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp1;
@@ -591,6 +1234,21 @@ public:
 		myExp2->nameAnalysis(symTab);
 		return true;
 	}
+	bool constValue(int & val);
+	SemType typeCheck(TypeChecker * types);
+	bool hasSideEffects();
+	int lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool canTrap();
+	void liveUses(LiveVars * vars);
+	bool assigns(const std::string& var);
+	ExpNode * evalCalls(CallEvaluator * ev);
+	bool evaluate(CallEvaluator * ev, EvalFrame * frame, int & val);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	bool loopTest(LoopTest * test);
+	ExpNode * clone();
+	void emitC(CEmitter * c, std::ostream& out);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp1;
@@ -603,6 +1261,18 @@ public:
 		myAssign = assignment;
 	}
 	bool nameAnalysis(SymbolTable * symTab);
+	void typeCheck(TypeChecker * types);
+	void lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool liveness(LiveVars * vars);
+	bool unrollable(const std::string& var);
+	bool constAssign(std::string & var, int & val);
+	StmtNode * clone();
+	void evalCalls(CallEvaluator * ev);
+	EvalStatus execute(CallEvaluator * ev, EvalFrame * frame);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
 	AssignNode * myAssign;
@@ -617,6 +1287,16 @@ public:
 		myExp->nameAnalysis(symTab);
 		return true;
 	}
+	void typeCheck(TypeChecker * types);
+	void lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool liveness(LiveVars * vars);
+	bool unrollable(const std::string& var);
+	int stepOf(const std::string& var);
+	StmtNode * clone();
+	EvalStatus execute(CallEvaluator * ev, EvalFrame * frame);
+	void countFieldUses(LayoutContext * ctx);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp;
@@ -631,6 +1311,16 @@ public:
 		myExp->nameAnalysis(symTab);
 		return true;
 	}
+	void typeCheck(TypeChecker * types);
+	void lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool liveness(LiveVars * vars);
+	bool unrollable(const std::string& var);
+	int stepOf(const std::string& var);
+	StmtNode * clone();
+	EvalStatus execute(CallEvaluator * ev, EvalFrame * frame);
+	void countFieldUses(LayoutContext * ctx);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp;
@@ -645,6 +1335,15 @@ public:
 		myExp->nameAnalysis(symTab);
 		return true;
 	}
+	void typeCheck(TypeChecker * types);
+	void lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool liveness(LiveVars * vars);
+	bool unrollable(const std::string& var);
+	StmtNode * clone();
+	bool doesIO() { return true; }
+	void countFieldUses(LayoutContext * ctx);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp;
@@ -659,6 +1358,17 @@ public:
 		myExp->nameAnalysis(symTab);
 		return true;
 	}
+	void typeCheck(TypeChecker * types);
+	void lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool liveness(LiveVars * vars);
+	bool unrollable(const std::string& var);
+	StmtNode * clone();
+	void evalCalls(CallEvaluator * ev);
+	bool doesIO() { return true; }
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp;
@@ -674,8 +1384,25 @@ public:
 		myStmts = stmts;
 	}
 	bool nameAnalysis(SymbolTable * symTab);
+	bool elimDeadCode(DeclListNode * scope, std::list<StmtNode *> * out);
+	void typeCheck(TypeChecker * types);
+	void lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool liveness(LiveVars * vars);
+	int pruneLocals(const std::set<std::string>& referenced);
+	void unrollLoops(Unroller * u, std::list<StmtNode *> * out);
+	bool unrollable(const std::string& var);
+	int stmtCount();
+	StmtNode * clone();
+	void evalCalls(CallEvaluator * ev);
+	EvalStatus execute(CallEvaluator * ev, EvalFrame * frame);
+	bool doesIO();
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
+	int mySite = -1; // see profile.cpp
 	ExpNode * myExp;
 	DeclListNode * myDecls;
 	StmtListNode * myStmts;
@@ -694,8 +1421,25 @@ public:
 		myStmtsF = stmtsF;
 	}
 	bool nameAnalysis(SymbolTable * symTab);
+	bool elimDeadCode(DeclListNode * scope, std::list<StmtNode *> * out);
+	void typeCheck(TypeChecker * types);
+	void lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool liveness(LiveVars * vars);
+	int pruneLocals(const std::set<std::string>& referenced);
+	void unrollLoops(Unroller * u, std::list<StmtNode *> * out);
+	bool unrollable(const std::string& var);
+	int stmtCount();
+	StmtNode * clone();
+	void evalCalls(CallEvaluator * ev);
+	EvalStatus execute(CallEvaluator * ev, EvalFrame * frame);
+	bool doesIO();
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
+	int mySite = -1; // see profile.cpp
 	ExpNode * myExp;
 	DeclListNode * myDeclsT;
 	StmtListNode * myStmtsT;
@@ -712,8 +1456,26 @@ public:
 		myStmts = stmts;
 	}
 	bool nameAnalysis(SymbolTable * symTab);
+	bool elimDeadCode(DeclListNode * scope, std::list<StmtNode *> * out);
+	void typeCheck(TypeChecker * types);
+	void lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool liveness(LiveVars * vars);
+	int pruneLocals(const std::set<std::string>& referenced);
+	void unrollLoops(Unroller * u, std::list<StmtNode *> * out);
+	bool unrollable(const std::string& var);
+	bool unrollHot(Unroller * u);
+	int stmtCount();
+	StmtNode * clone();
+	void evalCalls(CallEvaluator * ev);
+	EvalStatus execute(CallEvaluator * ev, EvalFrame * frame);
+	bool doesIO();
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
+	int mySite = -1; // see profile.cpp
 	ExpNode * myExp;
 	DeclListNode * myDecls;
 	StmtListNode * myStmts;
@@ -728,6 +1490,17 @@ public:
 		myCallExp->nameAnalysis(symTab);
 		return true;
 	}
+	void typeCheck(TypeChecker * types);
+	void lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool liveness(LiveVars * vars);
+	bool unrollable(const std::string& var);
+	StmtNode * clone();
+	void evalCalls(CallEvaluator * ev);
+	EvalStatus execute(CallEvaluator * ev, EvalFrame * frame);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
 	CallExpNode * myCallExp;
@@ -739,9 +1512,21 @@ public:
 		myExp = exp;
 	}
 	bool nameAnalysis(SymbolTable * symTab) {
-		myExp->nameAnalysis(symTab);
+		if (myExp != nullptr) myExp->nameAnalysis(symTab);
 		return true;
 	}
+	bool elimDeadCode(DeclListNode * scope, std::list<StmtNode *> * out);
+	void typeCheck(TypeChecker * types);
+	void lower(IRLowering * ir);
+	void collectUses(CallGraph * graph, int fn, std::set<std::string> * used);
+	bool liveness(LiveVars * vars);
+	bool unrollable(const std::string& var);
+	StmtNode * clone();
+	void evalCalls(CallEvaluator * ev);
+	EvalStatus execute(CallEvaluator * ev, EvalFrame * frame);
+	void countFieldUses(LayoutContext * ctx);
+	void numberSites(FnProfile * fn);
+	void emitC(CEmitter * c, std::ostream& out, int indent);
 	void unparse(std::ostream& out, int indent);
 private:
 	ExpNode * myExp;
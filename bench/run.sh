@@ -0,0 +1,12 @@
+#!/bin/sh
+# Runs each benchmark on the bytecode VM, unoptimized and with -O,
+# reporting the instructions executed per second.
+# Usage: bench/run.sh [path to P5]
+P5=${1:-./P5}
+DIR=$(dirname "$0")
+for prog in "$DIR"/*.lilc; do
+	for opt in "" "-O"; do
+		printf '%-16s %-3s ' "$(basename "$prog" .lilc)" "$opt"
+		"$P5" "$prog" /dev/null -bench $opt </dev/null 2>&1 >/dev/null | grep '^vm:'
+	done
+done
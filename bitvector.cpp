@@ -0,0 +1,148 @@
+#include "bitvector.hpp"
+#include <algorithm>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace LILC{
+
+/*
+* Word kernels. Each combines n words of src into dst and returns
+* whether any word of dst changed; AVX2 handles four words a step,
+* SSE2 two, and a scalar loop the rest.
+*/
+
+namespace {
+
+#if defined(__AVX2__)
+
+const size_t LANES = 4;
+typedef __m256i Vec;
+
+inline Vec loadVec(const uint64_t * p){ return _mm256_loadu_si256((const Vec *)p); }
+inline void storeVec(uint64_t * p, Vec v){ _mm256_storeu_si256((Vec *)p, v); }
+inline Vec orVec(Vec a, Vec b){ return _mm256_or_si256(a, b); }
+inline Vec andVec(Vec a, Vec b){ return _mm256_and_si256(a, b); }
+inline Vec andNotVec(Vec a, Vec b){ return _mm256_andnot_si256(b, a); }
+inline Vec xorVec(Vec a, Vec b){ return _mm256_xor_si256(a, b); }
+inline Vec zeroVec(){ return _mm256_setzero_si256(); }
+inline bool isZero(Vec v){ return _mm256_testz_si256(v, v); }
+
+#elif defined(__SSE2__)
+
+const size_t LANES = 2;
+typedef __m128i Vec;
+
+inline Vec loadVec(const uint64_t * p){ return _mm_loadu_si128((const Vec *)p); }
+inline void storeVec(uint64_t * p, Vec v){ _mm_storeu_si128((Vec *)p, v); }
+inline Vec orVec(Vec a, Vec b){ return _mm_or_si128(a, b); }
+inline Vec andVec(Vec a, Vec b){ return _mm_and_si128(a, b); }
+inline Vec andNotVec(Vec a, Vec b){ return _mm_andnot_si128(b, a); }
+inline Vec xorVec(Vec a, Vec b){ return _mm_xor_si128(a, b); }
+inline Vec zeroVec(){ return _mm_setzero_si128(); }
+inline bool isZero(Vec v){
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xFFFF;
+}
+
+#endif
+
+enum class Kernel { Or, And, AndNot };
+
+inline uint64_t apply(Kernel kernel, uint64_t a, uint64_t b){
+	switch (kernel){
+		case Kernel::Or: return a | b;
+		case Kernel::And: return a & b;
+		case Kernel::AndNot: return a & ~b;
+	}
+	return a;
+}
+
+template <Kernel kernel>
+bool combine(uint64_t * dst, const uint64_t * src, size_t n){
+	size_t i = 0;
+	uint64_t diff = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+	Vec changed = zeroVec();
+	for (; i + LANES <= n; i += LANES){
+		Vec a = loadVec(dst + i);
+		Vec b = loadVec(src + i);
+		Vec r = kernel == Kernel::Or ? orVec(a, b)
+		  : kernel == Kernel::And ? andVec(a, b) : andNotVec(a, b);
+		changed = orVec(changed, xorVec(a, r));
+		storeVec(dst + i, r);
+	}
+	if (!isZero(changed)) diff = 1;
+#endif
+	for (; i < n; i++){
+		uint64_t r = apply(kernel, dst[i], src[i]);
+		diff |= dst[i] ^ r;
+		dst[i] = r;
+	}
+	return diff != 0;
+}
+
+} // End anonymous namespace
+
+void BitVector::resize(size_t bits){
+	myBits = bits;
+	myWords.resize((bits + 63) / 64, 0);
+	if (bits % 64 != 0) myWords.back() &= ((uint64_t)1 << (bits % 64)) - 1;
+}
+
+void BitVector::set(size_t i){
+	if (i >= myBits) resize(i + 1);
+	myWords[i / 64] |= (uint64_t)1 << (i % 64);
+}
+
+void BitVector::clear(){
+	for (uint64_t & word : myWords){
+		word = 0;
+	}
+}
+
+void BitVector::fill(){
+	for (uint64_t & word : myWords){
+		word = ~(uint64_t)0;
+	}
+	resize(myBits);
+}
+
+size_t BitVector::count() const{
+	size_t total = 0;
+	for (uint64_t word : myWords){
+		total += __builtin_popcountll(word);
+	}
+	return total;
+}
+
+bool BitVector::unionWith(const BitVector& other){
+	if (other.myBits > myBits) resize(other.myBits);
+	return combine<Kernel::Or>(myWords.data(), other.myWords.data(), other.myWords.size());
+}
+
+bool BitVector::intersectWith(const BitVector& other){
+	size_t common = std::min(myWords.size(), other.myWords.size());
+	bool changed = combine<Kernel::And>(myWords.data(), other.myWords.data(), common);
+	for (size_t w = common; w < myWords.size(); w++){
+		if (myWords[w] != 0) changed = true;
+		myWords[w] = 0;
+	}
+	return changed;
+}
+
+bool BitVector::subtract(const BitVector& other){
+	size_t common = std::min(myWords.size(), other.myWords.size());
+	return combine<Kernel::AndNot>(myWords.data(), other.myWords.data(), common);
+}
+
+bool BitVector::operator==(const BitVector& other) const{
+	const std::vector<uint64_t> & shorter = myWords.size() < other.myWords.size() ? myWords : other.myWords;
+	const std::vector<uint64_t> & longer = myWords.size() < other.myWords.size() ? other.myWords : myWords;
+	for (size_t w = 0; w < longer.size(); w++){
+		uint64_t word = w < shorter.size() ? shorter[w] : 0;
+		if (word != longer[w]) return false;
+	}
+	return true;
+}
+
+} // End namespace LILC
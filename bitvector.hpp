@@ -0,0 +1,62 @@
+#ifndef LILC_BITVECTOR_HPP
+#define LILC_BITVECTOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace LILC{
+
+/*
+* A dense set of small integers, one bit per element, as used by
+* the dataflow analyses. Union, intersection and difference run a
+* word-parallel kernel over the whole vector (vectorized with SSE2
+* or AVX2 where the compiler targets them; see bitvector.cpp).
+*
+* A set grows when an element past its end is added, and two sets
+* of different sizes combine as if the shorter one were padded with
+* zeros, so analyses can hand out indices as they meet variables.
+*/
+class BitVector{
+public:
+	BitVector(size_t bits = 0) { resize(bits); }
+	size_t size() const { return myBits; }
+	void resize(size_t bits);
+	bool test(size_t i) const {
+		return i < myBits && ((myWords[i / 64] >> (i % 64)) & 1);
+	}
+	void set(size_t i);
+	void reset(size_t i){
+		if (i < myBits) myWords[i / 64] &= ~((uint64_t)1 << (i % 64));
+	}
+	void clear();
+	void fill();
+	size_t count() const;
+	bool empty() const { return count() == 0; }
+
+	// Each returns whether this set changed
+	bool unionWith(const BitVector& other);
+	bool intersectWith(const BitVector& other);
+	bool subtract(const BitVector& other);
+
+	bool operator==(const BitVector& other) const;
+	bool operator!=(const BitVector& other) const { return !(*this == other); }
+
+	// Calls f(i) for each element i, in increasing order
+	template <typename F> void forEach(F f) const {
+		for (size_t w = 0; w < myWords.size(); w++){
+			uint64_t word = myWords[w];
+			while (word != 0){
+				f(w * 64 + __builtin_ctzll(word));
+				word &= word - 1;
+			}
+		}
+	}
+private:
+	std::vector<uint64_t> myWords;
+	size_t myBits = 0;
+};
+
+} //End namespace LILC
+
+#endif
@@ -0,0 +1,513 @@
+#include "bytecode.hpp"
+#include <iomanip>
+
+namespace LILC{
+
+const char * bcOpName(BCOp op){
+	switch (op){
+		case BCOp::Const: return "const";
+		case BCOp::Move: return "move";
+		case BCOp::Neg: return "neg";
+		case BCOp::Not: return "not";
+		case BCOp::Add: return "add";
+		case BCOp::Sub: return "sub";
+		case BCOp::Mul: return "mul";
+		case BCOp::Div: return "div";
+		case BCOp::Shl: return "shl";
+		case BCOp::Sar: return "sar";
+		case BCOp::Shr: return "shr";
+		case BCOp::Eq: return "eq";
+		case BCOp::Ne: return "ne";
+		case BCOp::Lt: return "lt";
+		case BCOp::Gt: return "gt";
+		case BCOp::Le: return "le";
+		case BCOp::Ge: return "ge";
+		case BCOp::GLoad: return "gload";
+		case BCOp::GStore: return "gstore";
+		case BCOp::Arg: return "arg";
+		case BCOp::Call: return "call";
+		case BCOp::TailCall: return "tailcall";
+		case BCOp::Ret: return "ret";
+		case BCOp::RetVoid: return "ret";
+		case BCOp::Jump: return "jump";
+		case BCOp::JumpIf: return "jumpif";
+		case BCOp::JumpIfNot: return "jumpifnot";
+		case BCOp::Read: return "read";
+		case BCOp::Write: return "write";
+		case BCOp::WriteStr: return "writestr";
+		case BCOp::Count: return "count";
+		case BCOp::AddImm: return "addi";
+		case BCOp::SubImm: return "subi";
+		case BCOp::MulImm: return "muli";
+		case BCOp::JumpLt: return "jlt";
+		case BCOp::JumpGt: return "jgt";
+		case BCOp::JumpLe: return "jle";
+		case BCOp::JumpGe: return "jge";
+		case BCOp::JumpEq: return "jeq";
+		case BCOp::JumpNe: return "jne";
+		case BCOp::JumpLtImm: return "jlti";
+		case BCOp::JumpGtImm: return "jgti";
+		case BCOp::JumpLeImm: return "jlei";
+		case BCOp::JumpGeImm: return "jgei";
+		case BCOp::JumpEqImm: return "jeqi";
+		case BCOp::JumpNeImm: return "jnei";
+		case BCOp::NumOps: break;
+	}
+	return "?";
+}
+
+namespace {
+
+BCOp binaryOp(IROp op){
+	switch (op){
+		case IROp::Add: return BCOp::Add;
+		case IROp::Sub: return BCOp::Sub;
+		case IROp::Mul: return BCOp::Mul;
+		case IROp::Div: return BCOp::Div;
+		case IROp::Shl: return BCOp::Shl;
+		case IROp::Sar: return BCOp::Sar;
+		case IROp::Shr: return BCOp::Shr;
+		case IROp::Eq: return BCOp::Eq;
+		case IROp::Ne: return BCOp::Ne;
+		case IROp::Lt: return BCOp::Lt;
+		case IROp::Gt: return BCOp::Gt;
+		case IROp::Le: return BCOp::Le;
+		case IROp::Ge: return BCOp::Ge;
+		default: break;
+	}
+	throw std::runtime_error("Internal Error: not a binary IR operation");
+}
+
+bool isCompare(IROp op){
+	return op == IROp::Eq || op == IROp::Ne || op == IROp::Lt
+	  || op == IROp::Gt || op == IROp::Le || op == IROp::Ge;
+}
+
+// The comparison that holds exactly when op does not
+IROp negate(IROp op){
+	switch (op){
+		case IROp::Eq: return IROp::Ne;
+		case IROp::Ne: return IROp::Eq;
+		case IROp::Lt: return IROp::Ge;
+		case IROp::Ge: return IROp::Lt;
+		case IROp::Gt: return IROp::Le;
+		case IROp::Le: return IROp::Gt;
+		default: return op;
+	}
+}
+
+// The comparison that holds for (b, a) exactly when op does for (a, b)
+IROp mirror(IROp op){
+	switch (op){
+		case IROp::Lt: return IROp::Gt;
+		case IROp::Gt: return IROp::Lt;
+		case IROp::Le: return IROp::Ge;
+		case IROp::Ge: return IROp::Le;
+		default: return op;
+	}
+}
+
+BCOp jumpOp(IROp op, bool imm){
+	switch (op){
+		case IROp::Lt: return imm ? BCOp::JumpLtImm : BCOp::JumpLt;
+		case IROp::Gt: return imm ? BCOp::JumpGtImm : BCOp::JumpGt;
+		case IROp::Le: return imm ? BCOp::JumpLeImm : BCOp::JumpLe;
+		case IROp::Ge: return imm ? BCOp::JumpGeImm : BCOp::JumpGe;
+		case IROp::Eq: return imm ? BCOp::JumpEqImm : BCOp::JumpEq;
+		default: return imm ? BCOp::JumpNeImm : BCOp::JumpNe;
+	}
+}
+
+bool isJump(BCOp op){
+	return op == BCOp::Jump || op == BCOp::JumpIf || op == BCOp::JumpIfNot
+	  || (op >= BCOp::JumpLt && op <= BCOp::JumpNeImm);
+}
+
+// Where a jump keeps its target
+int32_t & jumpTarget(BCInst& inst){
+	if (inst.op == BCOp::Jump) return inst.a;
+	if (inst.op == BCOp::JumpIf || inst.op == BCOp::JumpIfNot) return inst.b;
+	return inst.c;
+}
+
+// The registers inst reads
+void readsOf(const BCInst& inst, std::vector<int>& regs){
+	regs.clear();
+	switch (inst.op){
+		case BCOp::Const:
+		case BCOp::GLoad:
+		case BCOp::Call:
+		case BCOp::TailCall:
+		case BCOp::RetVoid:
+		case BCOp::Jump:
+		case BCOp::Read:
+		case BCOp::WriteStr:
+		case BCOp::Count:
+			return;
+		case BCOp::Move:
+		case BCOp::Neg:
+		case BCOp::Not:
+		case BCOp::GStore:
+		case BCOp::AddImm:
+		case BCOp::SubImm:
+		case BCOp::MulImm:
+			regs.push_back(inst.b);
+			return;
+		case BCOp::Arg:
+		case BCOp::Ret:
+		case BCOp::JumpIf:
+		case BCOp::JumpIfNot:
+		case BCOp::Write:
+		case BCOp::JumpLtImm:
+		case BCOp::JumpGtImm:
+		case BCOp::JumpLeImm:
+		case BCOp::JumpGeImm:
+		case BCOp::JumpEqImm:
+		case BCOp::JumpNeImm:
+			regs.push_back(inst.a);
+			return;
+		case BCOp::JumpLt:
+		case BCOp::JumpGt:
+		case BCOp::JumpLe:
+		case BCOp::JumpGe:
+		case BCOp::JumpEq:
+		case BCOp::JumpNe:
+			regs.push_back(inst.a);
+			regs.push_back(inst.b);
+			return;
+		default:
+			regs.push_back(inst.b);
+			regs.push_back(inst.c);
+			return;
+	}
+}
+
+class FunctionCompiler{
+public:
+	FunctionCompiler(IRFunction& fn) : myFn(fn) {
+		mySlotBase = fn.vals.size();
+		std::vector<int> defs(fn.vals.size(), 0);
+		myUses.assign(fn.vals.size(), 0);
+		myConst.assign(fn.vals.size(), false);
+		myConstVal.assign(fn.vals.size(), 0);
+		for (IRBlock & block : fn.blocks){
+			for (IRInst & inst : block.insts){
+				if (inst.a >= 0) myUses[inst.a]++;
+				if (inst.b >= 0) myUses[inst.b]++;
+				if (inst.dst < 0) continue;
+				defs[inst.dst]++;
+				if (inst.op == IROp::Const){
+					myConst[inst.dst] = true;
+					myConstVal[inst.dst] = inst.imm;
+				}
+			}
+			if (block.term.val >= 0) myUses[block.term.val]++;
+		}
+		for (size_t v = 0; v < fn.vals.size(); v++){
+			if (defs[v] != 1 || (int)v < fn.numFormals) myConst[v] = false;
+		}
+	}
+
+	BCFunction compile(){
+		BCFunction out{myFn.name, myFn.numFormals,
+		  (int)(myFn.vals.size() + myFn.slots.size()), {}, myFn.line, {}};
+		// Blocks go in layout order, which leaves out unreachable ones
+		std::vector<int> order = myFn.layoutOrder();
+		myLine = myFn.line;
+		std::vector<int> blockStart(myFn.blocks.size(), -1);
+		for (size_t k = 0; k < order.size(); k++){
+			blockStart[order[k]] = myCode.size();
+			compileBlock(order[k], k + 1 < order.size() ? order[k + 1] : -1);
+		}
+		for (BCInst & inst : myCode){
+			if (isJump(inst.op)) jumpTarget(inst) = blockStart[jumpTarget(inst)];
+		}
+		removeDeadConsts();
+		out.code.swap(myCode);
+		out.lines.swap(myLines);
+		return out;
+	}
+private:
+	void emit(BCOp op, int a = 0, int b = 0, int c = 0){
+		myCode.push_back(BCInst{op, a, b, c});
+		myLines.push_back(myLine);
+	}
+
+	// Code of an instruction passes made with no line keeps the last one
+	void setLine(int line){
+		if (line > 0) myLine = line;
+	}
+
+	// Compiles block b, to be followed by block next
+	void compileBlock(int b, int next){
+		IRBlock & block = myFn.blocks[b];
+		size_t numInsts = block.insts.size();
+		bool fuse = false;
+		if (block.term.kind == IRTermKind::Branch && numInsts > 0){
+			IRInst & last = block.insts.back();
+			fuse = isCompare(last.op) && last.dst == block.term.val && myUses[last.dst] == 1;
+		}
+		for (size_t i = 0; i < numInsts; i++){
+			setLine(block.insts[i].line);
+			if (fuse && i + 1 == numInsts) break;
+			if (i + 1 == numInsts && irIsTailCall(myFn, block, i)){
+				emit(BCOp::TailCall, 0, block.insts[i].imm);
+				return;
+			}
+			compileInst(block.insts[i]);
+		}
+
+		IRTerm & term = block.term;
+		switch (term.kind){
+			case IRTermKind::Return:
+				if (term.val >= 0){
+					emit(BCOp::Ret, term.val);
+				} else {
+					emit(BCOp::RetVoid);
+				}
+				return;
+			case IRTermKind::Jump:
+				if (term.succ[0] != next) emit(BCOp::Jump, term.succ[0]);
+				return;
+			case IRTermKind::Branch:
+				break;
+		}
+
+		// Jump on the condition holding or failing, whichever lets the
+		// other successor be reached by falling through
+		int ifTrue = term.succ[0];
+		int ifFalse = term.succ[1];
+		bool invert = ifTrue == next;
+		int target = invert ? ifFalse : ifTrue;
+		if (fuse){
+			IRInst cmp = block.insts.back();
+			IROp op = invert ? negate(cmp.op) : cmp.op;
+			if (myConst[cmp.b]){
+				emit(jumpOp(op, true), cmp.a, myConstVal[cmp.b], target);
+			} else if (myConst[cmp.a]){
+				emit(jumpOp(mirror(op), true), cmp.b, myConstVal[cmp.a], target);
+			} else {
+				emit(jumpOp(op, false), cmp.a, cmp.b, target);
+			}
+		} else {
+			emit(invert ? BCOp::JumpIfNot : BCOp::JumpIf, term.val, target);
+		}
+		if (!invert && ifFalse != next) emit(BCOp::Jump, ifFalse);
+	}
+
+	void compileInst(IRInst& inst){
+		switch (inst.op){
+			case IROp::Const:
+				emit(BCOp::Const, inst.dst, inst.imm);
+				return;
+			case IROp::Copy:
+				if (inst.dst != inst.a) emit(BCOp::Move, inst.dst, inst.a);
+				return;
+			case IROp::Neg:
+				emit(BCOp::Neg, inst.dst, inst.a);
+				return;
+			case IROp::Not:
+				emit(BCOp::Not, inst.dst, inst.a);
+				return;
+			case IROp::Load:
+				emit(BCOp::Move, inst.dst, mySlotBase + inst.imm);
+				return;
+			case IROp::Store:
+				emit(BCOp::Move, mySlotBase + inst.imm, inst.a);
+				return;
+			case IROp::GLoad:
+				emit(BCOp::GLoad, inst.dst, inst.imm);
+				return;
+			case IROp::GStore:
+				emit(BCOp::GStore, inst.imm, inst.a);
+				return;
+			case IROp::Arg:
+				emit(BCOp::Arg, inst.a);
+				return;
+			case IROp::Call:
+				emit(BCOp::Call, inst.dst, inst.imm);
+				return;
+			case IROp::Read:
+				emit(BCOp::Read, inst.dst);
+				return;
+			case IROp::Write:
+				emit(BCOp::Write, inst.a);
+				return;
+			case IROp::WriteStr:
+				emit(BCOp::WriteStr, inst.imm);
+				return;
+			case IROp::Probe:
+				emit(BCOp::Count, inst.imm);
+				return;
+			case IROp::Add:
+				if (myConst[inst.b]){
+					emit(BCOp::AddImm, inst.dst, inst.a, myConstVal[inst.b]);
+				} else if (myConst[inst.a]){
+					emit(BCOp::AddImm, inst.dst, inst.b, myConstVal[inst.a]);
+				} else {
+					emit(BCOp::Add, inst.dst, inst.a, inst.b);
+				}
+				return;
+			case IROp::Sub:
+				if (myConst[inst.b]){
+					emit(BCOp::SubImm, inst.dst, inst.a, myConstVal[inst.b]);
+				} else {
+					emit(BCOp::Sub, inst.dst, inst.a, inst.b);
+				}
+				return;
+			case IROp::Mul:
+				if (myConst[inst.b]){
+					emit(BCOp::MulImm, inst.dst, inst.a, myConstVal[inst.b]);
+				} else if (myConst[inst.a]){
+					emit(BCOp::MulImm, inst.dst, inst.b, myConstVal[inst.a]);
+				} else {
+					emit(BCOp::Mul, inst.dst, inst.a, inst.b);
+				}
+				return;
+			default:
+				emit(binaryOp(inst.op), inst.dst, inst.a, inst.b);
+				return;
+		}
+	}
+
+	/*
+	* Drops the constants that were all folded into
+	* superinstructions, and renumbers jump targets to match.
+	*/
+	void removeDeadConsts(){
+		std::vector<char> read(myFn.vals.size() + myFn.slots.size(), 0);
+		std::vector<int> regs;
+		for (BCInst & inst : myCode){
+			readsOf(inst, regs);
+			for (int r : regs){
+				read[r] = 1;
+			}
+		}
+		std::vector<int> newIndex(myCode.size() + 1, 0);
+		std::vector<BCInst> kept;
+		std::vector<int> keptLines;
+		for (size_t i = 0; i < myCode.size(); i++){
+			newIndex[i] = kept.size();
+			if (myCode[i].op == BCOp::Const && !read[myCode[i].a]) continue;
+			kept.push_back(myCode[i]);
+			keptLines.push_back(myLines[i]);
+		}
+		newIndex[myCode.size()] = kept.size();
+		for (BCInst & inst : kept){
+			if (isJump(inst.op)) jumpTarget(inst) = newIndex[jumpTarget(inst)];
+		}
+		myCode.swap(kept);
+		myLines.swap(keptLines);
+	}
+
+	IRFunction & myFn;
+	int mySlotBase;
+	std::vector<int> myUses;
+	std::vector<bool> myConst;
+	std::vector<int> myConstVal;
+	std::vector<BCInst> myCode;
+	std::vector<int> myLines;
+	int myLine = 0;
+};
+
+} // End anonymous namespace
+
+BCModule compileBytecode(IRModule& module){
+	BCModule out;
+	out.numGlobals = module.globals.size();
+	out.numCounters = module.probes.size();
+	out.strings = module.strings;
+	for (IRFunction & fn : module.functions){
+		FunctionCompiler compiler(fn);
+		out.functions.push_back(compiler.compile());
+	}
+	out.mainIndex = module.findFunction("main");
+	return out;
+}
+
+void BCModule::dump(std::ostream& out) const{
+	out << "globals " << numGlobals << "\n";
+	for (size_t s = 0; s < strings.size(); s++){
+		out << "string " << s << " " << strings.literal(s) << "\n";
+	}
+	for (const BCFunction & fn : functions){
+		out << "\nfunction " << fn.name << " (" << fn.numFormals
+		  << " formals, " << fn.numRegs << " registers)\n";
+		for (size_t i = 0; i < fn.code.size(); i++){
+			const BCInst & inst = fn.code[i];
+			out << std::setw(6) << i << "  " << std::left << std::setw(10)
+			  << bcOpName(inst.op) << std::right;
+			switch (inst.op){
+				case BCOp::Const:
+					out << "r" << inst.a << ", " << inst.b;
+					break;
+				case BCOp::GLoad:
+					out << "r" << inst.a << ", @" << inst.b;
+					break;
+				case BCOp::GStore:
+					out << "@" << inst.a << ", r" << inst.b;
+					break;
+				case BCOp::Call:
+					if (inst.a >= 0) out << "r" << inst.a << ", ";
+					out << functions[inst.b].name;
+					break;
+				case BCOp::TailCall:
+					out << functions[inst.b].name;
+					break;
+				case BCOp::RetVoid:
+					break;
+				case BCOp::Jump:
+					out << inst.a;
+					break;
+				case BCOp::JumpIf:
+				case BCOp::JumpIfNot:
+					out << "r" << inst.a << ", " << inst.b;
+					break;
+				case BCOp::Arg:
+				case BCOp::Ret:
+				case BCOp::Read:
+				case BCOp::Write:
+					out << "r" << inst.a;
+					break;
+				case BCOp::WriteStr:
+					out << "$" << inst.a;
+					break;
+				case BCOp::Count:
+					out << "#" << inst.a;
+					break;
+				case BCOp::Move:
+				case BCOp::Neg:
+				case BCOp::Not:
+					out << "r" << inst.a << ", r" << inst.b;
+					break;
+				case BCOp::AddImm:
+				case BCOp::SubImm:
+				case BCOp::MulImm:
+					out << "r" << inst.a << ", r" << inst.b << ", " << inst.c;
+					break;
+				case BCOp::JumpLt:
+				case BCOp::JumpGt:
+				case BCOp::JumpLe:
+				case BCOp::JumpGe:
+				case BCOp::JumpEq:
+				case BCOp::JumpNe:
+					out << "r" << inst.a << ", r" << inst.b << ", " << inst.c;
+					break;
+				case BCOp::JumpLtImm:
+				case BCOp::JumpGtImm:
+				case BCOp::JumpLeImm:
+				case BCOp::JumpGeImm:
+				case BCOp::JumpEqImm:
+				case BCOp::JumpNeImm:
+					out << "r" << inst.a << ", " << inst.b << ", " << inst.c;
+					break;
+				default:
+					out << "r" << inst.a << ", r" << inst.b << ", r" << inst.c;
+					break;
+			}
+			out << "\n";
+		}
+	}
+}
+
+} // End namespace LILC
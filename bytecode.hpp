@@ -0,0 +1,146 @@
+#ifndef LILC_BYTECODE_HPP
+#define LILC_BYTECODE_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ir.hpp"
+
+namespace LILC{
+
+class Sampler;
+
+/*
+* Register bytecode for the LIL'C virtual machine. Each function
+* runs in a frame of int registers: its IR values first (formals in
+* registers 0..numFormals-1), then its frame slots, so a local
+* struct's fields are registers too. Globals live in one array
+* shared by every function. Bools are 0 or 1.
+*
+* Every instruction has three operands. Jump targets are
+* instruction indices within the function, and a conditional jump
+* falls through to the next instruction when not taken.
+*/
+enum class BCOp : uint8_t {
+	Const,    // r[a] = b
+	Move,     // r[a] = r[b]
+	Neg,      // r[a] = -r[b]
+	Not,      // r[a] = !r[b]
+	Add,      // r[a] = r[b] + r[c]
+	Sub,
+	Mul,
+	Div,
+	Shl,
+	Sar,
+	Shr,
+	Eq,
+	Ne,
+	Lt,
+	Gt,
+	Le,
+	Ge,
+	GLoad,    // r[a] = global b
+	GStore,   // global a = r[b]
+	Arg,      // pass r[a] to the next call
+	Call,     // r[a] = call function b (a is -1 to drop the result)
+	TailCall, // return the result of calling function b, in this frame
+	Ret,      // return r[a]
+	RetVoid,
+	Jump,     // go to a
+	JumpIf,   // if r[a] go to b
+	JumpIfNot,
+	Read,     // r[a] = integer from input
+	Write,    // write r[a]
+	WriteStr, // write string a
+	Count,    // add one to counter a of the profile being taken
+
+	// Superinstructions: an operation on a constant, or a compare
+	// fused with the conditional jump that consumes it.
+	AddImm,   // r[a] = r[b] + c
+	SubImm,
+	MulImm,
+	JumpLt,   // if r[a] < r[b] go to c
+	JumpGt,
+	JumpLe,
+	JumpGe,
+	JumpEq,
+	JumpNe,
+	JumpLtImm, // if r[a] < b go to c
+	JumpGtImm,
+	JumpLeImm,
+	JumpGeImm,
+	JumpEqImm,
+	JumpNeImm,
+
+	NumOps
+};
+
+struct BCInst{
+	BCOp op;
+	int32_t a;
+	int32_t b;
+	int32_t c;
+};
+
+struct BCFunction{
+	std::string name;
+	int numFormals;
+	int numRegs;
+	std::vector<BCInst> code;
+	int line = 0;           // of its FnDeclNode
+	std::vector<int> lines; // the source line of each instruction of code
+};
+
+struct BCModule{
+	int numGlobals = 0;
+	int numCounters = 0;
+	StringPool strings; // the IR module's, ready to write
+	std::vector<BCFunction> functions;
+	int mainIndex = -1;
+
+	void dump(std::ostream& out) const;
+};
+
+/*
+* Translates a module whose functions are out of SSA form into
+* bytecode, fusing instruction sequences into superinstructions
+* where the intermediate result is not used elsewhere.
+*/
+BCModule compileBytecode(IRModule& module);
+
+const char * bcOpName(BCOp op);
+
+/*
+* Interprets a BCModule, starting at main, with threaded dispatch:
+* before running, each instruction's opcode is replaced by the
+* address of the code handling it, and every handler ends by
+* jumping straight to the next instruction's handler (GCC's
+* computed goto) rather than returning to one central switch.
+* Input and output go through the buffered runtime in
+* lilc_runtime.c, as they do for compiled code.
+*/
+class VM{
+public:
+	VM(const BCModule& module) : myModule(module) { }
+	// Runs main; counts executed instructions if countInsts is set
+	void run(bool countInsts = false);
+	// Has later runs take samples for sampler, whose timer the caller runs
+	void setSampler(Sampler * sampler) { mySampler = sampler; }
+	uint64_t instructionsExecuted() const { return myExecuted; }
+	// The module's counters, as the last run left them
+	const std::vector<uint64_t>& counters() const { return myCounters; }
+
+	static const size_t MAX_STACK = 1 << 26; // registers, all frames
+private:
+	template <bool COUNT, bool SAMPLE> void execute();
+
+	const BCModule & myModule;
+	uint64_t myExecuted = 0;
+	std::vector<uint64_t> myCounters;
+	Sampler * mySampler = nullptr;
+};
+
+} //End namespace LILC
+
+#endif
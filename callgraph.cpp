@@ -0,0 +1,145 @@
+#include "callgraph.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace LILC{
+
+int CallGraph::addFunction(const std::string& name){
+	std::unordered_map<std::string, int>::iterator found = myIndex.find(name);
+	if (found != myIndex.end()) return found->second;
+	int fn = myNames.size();
+	myNames.push_back(name);
+	myIndex[name] = fn;
+	myCallees.push_back(std::vector<int>());
+	mySiteCounts.push_back(std::vector<int>());
+	mySCCsValid = false;
+	return fn;
+}
+
+void CallGraph::addCall(int caller, int callee){
+	std::vector<int> & callees = myCallees[caller];
+	for (size_t i = 0; i < callees.size(); i++){
+		if (callees[i] == callee){
+			mySiteCounts[caller][i]++;
+			return;
+		}
+	}
+	callees.push_back(callee);
+	mySiteCounts[caller].push_back(1);
+	mySCCsValid = false;
+}
+
+int CallGraph::find(const std::string& name) const{
+	std::unordered_map<std::string, int>::const_iterator found = myIndex.find(name);
+	return found == myIndex.end() ? -1 : found->second;
+}
+
+int CallGraph::callSites(int caller, int callee) const{
+	const std::vector<int> & callees = myCallees[caller];
+	for (size_t i = 0; i < callees.size(); i++){
+		if (callees[i] == callee) return mySiteCounts[caller][i];
+	}
+	return 0;
+}
+
+// Call sites of callee across the whole program
+int CallGraph::callersOf(int callee) const{
+	int sites = 0;
+	for (int fn = 0; fn < size(); fn++){
+		sites += callSites(fn, callee);
+	}
+	return sites;
+}
+
+std::vector<std::vector<int>> CallGraph::sccs() const{
+	computeSCCs();
+	return mySCCs;
+}
+
+int CallGraph::sccOf(int fn) const{
+	computeSCCs();
+	return mySCCOf[fn];
+}
+
+bool CallGraph::isRecursive(int fn) const{
+	computeSCCs();
+	return mySCCs[mySCCOf[fn]].size() > 1 || callSites(fn, fn) > 0;
+}
+
+std::vector<char> CallGraph::reachableFrom(int root) const{
+	std::vector<char> reached(size(), 0);
+	if (root < 0) return reached;
+	std::vector<int> work;
+	reached[root] = 1;
+	work.push_back(root);
+	while (!work.empty()){
+		int fn = work.back();
+		work.pop_back();
+		for (int callee : myCallees[fn]){
+			if (reached[callee]) continue;
+			reached[callee] = 1;
+			work.push_back(callee);
+		}
+	}
+	return reached;
+}
+
+/*
+* Tarjan's algorithm, with an explicit stack of (function, next
+* callee) frames so deep call chains do not exhaust the C++ stack.
+* Components are completed callees first.
+*/
+void CallGraph::computeSCCs() const{
+	if (mySCCsValid) return;
+	int n = size();
+	mySCCs.clear();
+	mySCCOf.assign(n, -1);
+	std::vector<int> index(n, -1);
+	std::vector<int> low(n, 0);
+	std::vector<char> onStack(n, 0);
+	std::vector<int> stack;
+	std::vector<std::pair<int, size_t>> frames;
+	int counter = 0;
+	for (int root = 0; root < n; root++){
+		if (index[root] >= 0) continue;
+		frames.push_back({root, 0});
+		index[root] = low[root] = counter++;
+		stack.push_back(root);
+		onStack[root] = 1;
+		while (!frames.empty()){
+			int fn = frames.back().first;
+			size_t & next = frames.back().second;
+			if (next < myCallees[fn].size()){
+				int callee = myCallees[fn][next++];
+				if (index[callee] < 0){
+					index[callee] = low[callee] = counter++;
+					stack.push_back(callee);
+					onStack[callee] = 1;
+					frames.push_back({callee, 0});
+				} else if (onStack[callee]){
+					low[fn] = std::min(low[fn], index[callee]);
+				}
+				continue;
+			}
+			frames.pop_back();
+			if (!frames.empty()){
+				int caller = frames.back().first;
+				low[caller] = std::min(low[caller], low[fn]);
+			}
+			if (low[fn] != index[fn]) continue;
+			std::vector<int> component;
+			int member;
+			do {
+				member = stack.back();
+				stack.pop_back();
+				onStack[member] = 0;
+				mySCCOf[member] = mySCCs.size();
+				component.push_back(member);
+			} while (member != fn);
+			mySCCs.push_back(component);
+		}
+	}
+	mySCCsValid = true;
+}
+
+} // End namespace LILC
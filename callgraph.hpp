@@ -0,0 +1,50 @@
+#ifndef LILC_CALLGRAPH_HPP
+#define LILC_CALLGRAPH_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace LILC{
+
+/*
+* Which function calls which. Functions are numbered in the order
+* they are added and looked up by name; each edge remembers how
+* many call sites it stands for.
+*/
+class CallGraph{
+public:
+	int addFunction(const std::string& name);
+	void addCall(int caller, int callee);
+	int find(const std::string& name) const;
+	int size() const { return myNames.size(); }
+	const std::string& name(int fn) const { return myNames[fn]; }
+	const std::vector<int>& callees(int fn) const { return myCallees[fn]; }
+	int callSites(int caller, int callee) const;
+	int callersOf(int callee) const;
+
+	/*
+	* Strongly connected components (Tarjan), listed callees before
+	* callers: a component only calls into itself and the ones
+	* before it.
+	*/
+	std::vector<std::vector<int>> sccs() const;
+	int sccOf(int fn) const;
+	bool isRecursive(int fn) const;
+
+	std::vector<char> reachableFrom(int root) const;
+private:
+	void computeSCCs() const;
+
+	std::vector<std::string> myNames;
+	std::unordered_map<std::string, int> myIndex;
+	std::vector<std::vector<int>> myCallees;
+	std::vector<std::vector<int>> mySiteCounts; // parallel to myCallees
+	mutable std::vector<std::vector<int>> mySCCs;
+	mutable std::vector<int> mySCCOf;
+	mutable bool mySCCsValid = false;
+};
+
+} //End namespace LILC
+
+#endif
@@ -0,0 +1,556 @@
+#include "codegen.hpp"
+#include "regalloc.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace LILC{
+
+/*
+* x86-64 code generation. Values live where allocateRegisters puts
+* them: in registers, or in 4-byte spill slots of a frame addressed
+* from %rbp, which also holds the callee-saved registers the function
+* uses and, last, its frame slots laid out like the structs they
+* come from. Instructions work in %eax, %ecx and %edx where an
+* operand or result is on the stack or the instruction needs them.
+*
+* Calls follow the System V ABI: the first six arguments go in
+* %edi, %esi, %edx, %ecx, %r8d and %r9d, the rest on the stack, 8
+* bytes each, with %rsp 16-byte aligned at the call; the result
+* comes back in %eax. Moving the arguments into place, and a
+* callee's formals to where it keeps them, is a parallel move.
+* A tail call instead leaves its arguments where the callee would
+* find them had it been called by the caller's caller, tears down
+* the frame and jumps, so the callee returns there directly.
+*
+* Division matches the other backends rather than the hardware: a
+* zero divisor calls the runtime, which reports it and exits, and
+* dividing INT_MIN by -1 wraps instead of trapping.
+*/
+
+namespace {
+
+const char * const ARG_REGS[] = {"%edi", "%esi", "%edx", "%ecx", "%r8d", "%r9d"};
+const int NUM_ARG_REGS = 6;
+
+bool isCompare(IROp op){
+	return op == IROp::Eq || op == IROp::Ne || op == IROp::Lt
+	  || op == IROp::Gt || op == IROp::Le || op == IROp::Ge;
+}
+
+// The comparison that holds exactly when op does not
+IROp negate(IROp op){
+	switch (op){
+		case IROp::Eq: return IROp::Ne;
+		case IROp::Ne: return IROp::Eq;
+		case IROp::Lt: return IROp::Ge;
+		case IROp::Ge: return IROp::Lt;
+		case IROp::Gt: return IROp::Le;
+		case IROp::Le: return IROp::Gt;
+		default: return op;
+	}
+}
+
+// The condition code suffix of a signed comparison
+const char * condition(IROp op){
+	switch (op){
+		case IROp::Eq: return "e";
+		case IROp::Ne: return "ne";
+		case IROp::Lt: return "l";
+		case IROp::Gt: return "g";
+		case IROp::Le: return "le";
+		case IROp::Ge: return "ge";
+		default: break;
+	}
+	throw std::runtime_error("Internal Error: not a comparison");
+}
+
+/*
+* A literal's text escaped for the .string directive, in octal for
+* any character that is not printable ASCII.
+*/
+std::string asmString(const char * chars, size_t length){
+	static const char * const octal = "01234567";
+	std::string text = "\"";
+	for (size_t i = 0; i < length; i++){
+		char c = chars[i];
+		unsigned char u = c;
+		if (c == '"' || c == '\\'){
+			text += '\\';
+			text += c;
+		} else if (c == '\n'){
+			text += "\\n";
+		} else if (c == '\t'){
+			text += "\\t";
+		} else if (u < 0x20 || u >= 0x7f){
+			text += '\\';
+			text += octal[u >> 6];
+			text += octal[(u >> 3) & 7];
+			text += octal[u & 7];
+		} else {
+			text += c;
+		}
+	}
+	return text + "\"";
+}
+
+bool isMemory(const std::string& operand){
+	return operand.find('(') != std::string::npos;
+}
+
+class FunctionEmitter{
+public:
+	FunctionEmitter(IRModule& module, int index, std::ostream& out,
+	  const std::vector<std::string>& globals, const RegAllocation& alloc)
+	: myModule(module), myFn(module.functions[index]), myIndex(index),
+	  myOut(out), myGlobals(globals), myAlloc(alloc) {
+		myUses.assign(myFn.vals.size(), 0);
+		myConstants.assign(myFn.vals.size(), 0);
+		for (IRBlock & block : myFn.blocks){
+			for (IRInst & inst : block.insts){
+				if (inst.a >= 0) myUses[inst.a]++;
+				if (inst.b >= 0) myUses[inst.b]++;
+				if (inst.op == IROp::Const) myConstants[inst.dst] = inst.imm;
+			}
+			if (block.term.val >= 0) myUses[block.term.val]++;
+		}
+		mySlots = layoutSlots(myFn.slots, 0, myFn.slots.size());
+		mySpillBase = -8 * (int)alloc.calleeSaved.size();
+		mySlotBase = mySpillBase - 4 * alloc.numSpillSlots - mySlots.size;
+		myFrameSize = (-mySlotBase + 15) / 16 * 16;
+	}
+
+	void emit(){
+		std::string symbol = "lilc_f_" + myFn.name;
+		myOut << "\n\t.text\n\t.globl " << symbol << "\n\t.type "
+		  << symbol << ", @function\n" << symbol << ":\n";
+		line("pushq %rbp");
+		line("movq %rsp, %rbp");
+		if (myFrameSize > 0) line("subq $" + std::to_string(myFrameSize) + ", %rsp");
+		for (size_t r = 0; r < myAlloc.calleeSaved.size(); r++){
+			line("movq " + std::string(reg64Name(myAlloc.calleeSaved[r])) + ", "
+			  + std::to_string(-8 * (int)(r + 1)) + "(%rbp)");
+		}
+		std::vector<std::pair<std::string, std::string>> formals;
+		for (int i = 0; i < myFn.numFormals; i++){
+			if (!occurs(i)) continue;
+			if (i < NUM_ARG_REGS){
+				formals.push_back({value(i), ARG_REGS[i]});
+			} else {
+				formals.push_back({value(i), incomingArg(i)});
+			}
+		}
+		parallelMove(formals);
+
+		const std::vector<int> & order = myAlloc.order;
+		for (size_t k = 0; k < order.size(); k++){
+			myOut << label(order[k]) << ":\n";
+			emitBlock(order[k], k + 1 < order.size() ? order[k + 1] : -1);
+		}
+
+		myOut << label("ret") << ":\n";
+		leave();
+		line("ret");
+		if (myDivides > 0){
+			myOut << label("divzero") << ":\n";
+			line("call lilc_rt_div_zero");
+		}
+		myOut << "\t.size " << symbol << ", .-" << symbol << "\n";
+	}
+private:
+	void line(const std::string& text){
+		myOut << "\t" << text << "\n";
+	}
+
+	// Restores the callee-saved registers and pops the frame
+	void leave(){
+		for (size_t r = 0; r < myAlloc.calleeSaved.size(); r++){
+			line("movq " + std::to_string(-8 * (int)(r + 1)) + "(%rbp), "
+			  + reg64Name(myAlloc.calleeSaved[r]));
+		}
+		line("leave");
+	}
+
+	// Where the callee of a call finds argument i
+	std::string incomingArg(int i){
+		return std::to_string(16 + 8 * (i - NUM_ARG_REGS)) + "(%rbp)";
+	}
+
+	std::string label(int block){
+		return label(std::to_string(block));
+	}
+
+	std::string label(const std::string& name){
+		return ".L" + std::to_string(myIndex) + "_" + name;
+	}
+
+	bool occurs(int val){
+		return myAlloc.reg[val] >= 0 || myAlloc.spillSlot[val] >= 0
+		  || myAlloc.rematerialized[val];
+	}
+
+	// The operand holding val: a register, a stack slot or an immediate
+	std::string value(int val){
+		if (myAlloc.reg[val] >= 0) return reg32Name(myAlloc.reg[val]);
+		if (myAlloc.rematerialized[val]) return "$" + std::to_string(myConstants[val]);
+		return std::to_string(mySpillBase - 4 * (myAlloc.spillSlot[val] + 1)) + "(%rbp)";
+	}
+
+	// Whether operand can be written, or compared against
+	static bool isLocation(const std::string& operand){
+		return operand[0] != '$';
+	}
+
+	// A move between any two locations, through %r11d if both are memory
+	void move(const std::string& to, const std::string& from){
+		if (to == from) return;
+		if (isMemory(to) && isMemory(from)){
+			line("movl " + from + ", %r11d");
+			line("movl %r11d, " + to);
+		} else {
+			line("movl " + from + ", " + to);
+		}
+	}
+
+	/*
+	* Performs the moves (to, from) as if all at once: a move goes
+	* once no other still reads its destination, and a cycle is
+	* broken by parking one value in %eax.
+	*/
+	void parallelMove(std::vector<std::pair<std::string, std::string>> moves){
+		while (!moves.empty()){
+			bool progress = false;
+			for (size_t i = 0; i < moves.size(); i++){
+				bool read = false;
+				for (size_t j = 0; j < moves.size(); j++){
+					if (j != i && moves[j].second == moves[i].first) read = true;
+				}
+				if (read) continue;
+				move(moves[i].first, moves[i].second);
+				moves.erase(moves.begin() + i);
+				progress = true;
+				break;
+			}
+			if (progress) continue;
+			std::string parked = moves[0].first;
+			line("movl " + parked + ", %eax");
+			for (std::pair<std::string, std::string> & other : moves){
+				if (other.second == parked) other.second = "%eax";
+			}
+		}
+	}
+
+	std::string slot(int s){
+		return std::to_string(mySlotBase + mySlots.offsets[s]) + "(%rbp)";
+	}
+
+	// Loads from or stores to a memory location of the given type
+	std::string load(IRType type, const std::string& from){
+		return (type == IRType::Bool ? "movzbl " : "movl ") + from + ", %eax";
+	}
+
+	std::string store(IRType type, const std::string& to){
+		return (type == IRType::Bool ? "movb %al, " : "movl %eax, ") + to;
+	}
+
+	void emitBlock(int b, int next){
+		IRBlock & block = myFn.blocks[b];
+		size_t numInsts = block.insts.size();
+		bool fuse = false;
+		if (block.term.kind == IRTermKind::Branch && numInsts > 0){
+			IRInst & last = block.insts.back();
+			fuse = isCompare(last.op) && last.dst == block.term.val && myUses[last.dst] == 1;
+		}
+		bool tail = numInsts > 0 && irIsTailCall(myFn, block, numInsts - 1)
+		  && fitsTailJump(myFn, myModule.functions[block.insts.back().imm]);
+		for (size_t i = 0; i < numInsts; i++){
+			if (fuse && i + 1 == numInsts) break;
+			if (tail && i + 1 == numInsts){
+				emitTailCall(block.insts[i]);
+				return;
+			}
+			emitInst(block.insts[i]);
+		}
+
+		IRTerm & term = block.term;
+		switch (term.kind){
+			case IRTermKind::Return:
+				if (term.val >= 0) line("movl " + value(term.val) + ", %eax");
+				if (next != -1) line("jmp " + label("ret"));
+				return;
+			case IRTermKind::Jump:
+				if (term.succ[0] != next) line("jmp " + label(term.succ[0]));
+				return;
+			case IRTermKind::Branch:
+				break;
+		}
+
+		// Jump on the condition holding or failing, whichever lets the
+		// other successor be reached by falling through
+		int ifTrue = term.succ[0];
+		int ifFalse = term.succ[1];
+		bool invert = ifTrue == next;
+		int target = invert ? ifFalse : ifTrue;
+		IROp op = IROp::Ne;
+		if (fuse){
+			IRInst & cmp = block.insts.back();
+			if (isMemory(value(cmp.a)) || !isLocation(value(cmp.a))){
+				line("movl " + value(cmp.a) + ", %eax");
+				line("cmpl " + value(cmp.b) + ", %eax");
+			} else {
+				line("cmpl " + value(cmp.b) + ", " + value(cmp.a));
+			}
+			op = cmp.op;
+		} else if (isLocation(value(term.val))){
+			line("cmpl $0, " + value(term.val));
+		} else {
+			line("movl " + value(term.val) + ", %eax");
+			line("cmpl $0, %eax");
+		}
+		if (invert) op = negate(op);
+		line("j" + std::string(condition(op)) + " " + label(target));
+		if (!invert && ifFalse != next) line("jmp " + label(ifFalse));
+	}
+
+	void emitInst(const IRInst& inst){
+		switch (inst.op){
+			case IROp::Const:
+				if (isLocation(value(inst.dst))) move(value(inst.dst), "$" + std::to_string(inst.imm));
+				return;
+			case IROp::Copy:
+				move(value(inst.dst), value(inst.a));
+				return;
+			case IROp::Neg:
+				line("movl " + value(inst.a) + ", %eax");
+				line("negl %eax");
+				line("movl %eax, " + value(inst.dst));
+				return;
+			case IROp::Not:
+				line("movl " + value(inst.a) + ", %ecx");
+				line("xorl %eax, %eax");
+				line("testl %ecx, %ecx");
+				line("sete %al");
+				line("movl %eax, " + value(inst.dst));
+				return;
+			case IROp::Add:
+			case IROp::Sub:
+			case IROp::Mul: {
+				const char * mnemonic = inst.op == IROp::Add ? "addl "
+				  : inst.op == IROp::Sub ? "subl " : "imull ";
+				std::string dst = value(inst.dst);
+				if (isMemory(dst) || dst == value(inst.b)) dst = "%eax";
+				move(dst, value(inst.a));
+				line(mnemonic + value(inst.b) + ", " + dst);
+				move(value(inst.dst), dst);
+				return;
+			}
+			case IROp::Div:
+				emitDivide(inst);
+				return;
+			case IROp::Shl:
+			case IROp::Sar:
+			case IROp::Shr: {
+				const char * mnemonic = inst.op == IROp::Shl ? "shll"
+				  : inst.op == IROp::Sar ? "sarl" : "shrl";
+				line("movl " + value(inst.b) + ", %ecx");
+				line("movl " + value(inst.a) + ", %eax");
+				line(std::string(mnemonic) + " %cl, %eax");
+				line("movl %eax, " + value(inst.dst));
+				return;
+			}
+			case IROp::Eq:
+			case IROp::Ne:
+			case IROp::Lt:
+			case IROp::Gt:
+			case IROp::Le:
+			case IROp::Ge:
+				line("movl " + value(inst.a) + ", %ecx");
+				line("xorl %eax, %eax");
+				line("cmpl " + value(inst.b) + ", %ecx");
+				line("set" + std::string(condition(inst.op)) + " %al");
+				line("movl %eax, " + value(inst.dst));
+				return;
+			case IROp::Load:
+				line(load(myFn.slots[inst.imm].type, slot(inst.imm)));
+				line("movl %eax, " + value(inst.dst));
+				return;
+			case IROp::Store:
+				line("movl " + value(inst.a) + ", %eax");
+				line(store(myFn.slots[inst.imm].type, slot(inst.imm)));
+				return;
+			case IROp::GLoad:
+				line(load(myModule.globals[inst.imm].type, myGlobals[inst.imm]));
+				line("movl %eax, " + value(inst.dst));
+				return;
+			case IROp::GStore:
+				line("movl " + value(inst.a) + ", %eax");
+				line(store(myModule.globals[inst.imm].type, myGlobals[inst.imm]));
+				return;
+			case IROp::Arg:
+				myArgs.push_back(inst.a);
+				return;
+			case IROp::Call:
+				emitCall(inst);
+				return;
+			case IROp::Read:
+				line("call lilc_rt_read_int");
+				line("movl %eax, " + value(inst.dst));
+				return;
+			case IROp::Write:
+				line("movl " + value(inst.a) + ", %edi");
+				line("call lilc_rt_write_int");
+				return;
+			case IROp::WriteStr:
+				line("leaq .LS" + std::to_string(inst.imm) + "(%rip), %rdi");
+				line("call lilc_rt_write_str");
+				return;
+			case IROp::Probe: // only the VM takes profiles
+				return;
+		}
+	}
+
+	void emitDivide(const IRInst& inst){
+		std::string divide = label("div" + std::to_string(myDivides));
+		std::string done = label("divdone" + std::to_string(myDivides));
+		myDivides++;
+		line("movl " + value(inst.b) + ", %ecx");
+		line("testl %ecx, %ecx");
+		line("je " + label("divzero"));
+		line("movl " + value(inst.a) + ", %eax");
+		line("cmpl $-1, %ecx");
+		line("jne " + divide);
+		line("negl %eax");
+		line("jmp " + done);
+		myOut << divide << ":\n";
+		line("cltd");
+		line("idivl %ecx");
+		myOut << done << ":\n";
+		line("movl %eax, " + value(inst.dst));
+	}
+
+	/*
+	* Stack arguments are pushed last to first, after padding that
+	* keeps %rsp 16-byte aligned at the call; register arguments are
+	* loaded last, since nothing else touches those registers.
+	*/
+	void emitCall(const IRInst& call){
+		int numStack = (int)myArgs.size() - NUM_ARG_REGS;
+		int popped = 0;
+		if (numStack > 0){
+			if (numStack % 2 == 1){
+				line("subq $8, %rsp");
+				popped += 8;
+			}
+			for (int i = myArgs.size() - 1; i >= NUM_ARG_REGS; i--){
+				line("movl " + value(myArgs[i]) + ", %eax");
+				line("pushq %rax");
+				popped += 8;
+			}
+		}
+		std::vector<std::pair<std::string, std::string>> moves;
+		for (int i = 0; i < (int)myArgs.size() && i < NUM_ARG_REGS; i++){
+			moves.push_back({ARG_REGS[i], value(myArgs[i])});
+		}
+		parallelMove(moves);
+		myArgs.clear();
+		line("call lilc_f_" + myModule.functions[call.imm].name);
+		if (popped > 0) line("addq $" + std::to_string(popped) + ", %rsp");
+		if (call.dst >= 0) line("movl %eax, " + value(call.dst));
+	}
+
+	/*
+	* Stack arguments overwrite the caller's own, which its formals
+	* were moved out of on entry, so nothing still reads them.
+	*/
+	void emitTailCall(const IRInst& call){
+		std::vector<std::pair<std::string, std::string>> moves;
+		for (int i = 0; i < (int)myArgs.size(); i++){
+			moves.push_back({i < NUM_ARG_REGS ? ARG_REGS[i] : incomingArg(i), value(myArgs[i])});
+		}
+		parallelMove(moves);
+		myArgs.clear();
+		leave();
+		line("jmp lilc_f_" + myModule.functions[call.imm].name);
+	}
+
+	IRModule & myModule;
+	IRFunction & myFn;
+	int myIndex;
+	std::ostream & myOut;
+	const std::vector<std::string> & myGlobals; // operand per global slot
+	const RegAllocation & myAlloc;
+	std::vector<int> myUses;
+	std::vector<int> myConstants; // per value defined by a Const
+	SlotLayout mySlots;
+	int mySpillBase;    // frame offset of the spill slots
+	int mySlotBase;     // frame offset of the slot area
+	int myFrameSize;
+	int myDivides = 0;
+	std::vector<int> myArgs; // the pending call's arguments
+};
+
+} // End anonymous namespace
+
+SlotLayout layoutSlots(const std::vector<IRSlot>& slots, size_t first, size_t count){
+	SlotLayout layout;
+	for (size_t s = first; s < first + count; s++){
+		int size = slots[s].type == IRType::Bool ? 1 : 4;
+		layout.size = (layout.size + size - 1) / size * size;
+		layout.offsets.push_back(layout.size);
+		layout.size += size;
+		if (size > layout.align) layout.align = size;
+	}
+	layout.size = (layout.size + layout.align - 1) / layout.align * layout.align;
+	return layout;
+}
+
+bool fitsTailJump(const IRFunction& caller, const IRFunction& callee){
+	return callee.numFormals <= std::max(caller.numFormals, NUM_ARG_REGS);
+}
+
+void emitAssembly(IRModule& module, std::ostream& out, std::ostream * report){
+	out << "\t.file \"lilc\"\n";
+	if (!module.strings.empty()) out << "\n\t.section .rodata\n";
+	for (size_t s = 0; s < module.strings.size(); s++){
+		out << ".LS" << s << ":\n\t.string " << asmString(module.strings.text(s), module.strings.length(s)) << "\n";
+	}
+
+	// A global struct's slots share its name up to the first dot
+	std::vector<std::string> globals(module.globals.size());
+	if (!module.globals.empty()) out << "\n\t.bss\n";
+	for (size_t first = 0; first < module.globals.size(); ){
+		const std::string & name = module.globals[first].name;
+		std::string var = name.substr(0, name.find('.'));
+		size_t count = 1;
+		while (first + count < module.globals.size()){
+			const std::string & field = module.globals[first + count].name;
+			if (field.substr(0, field.find('.')) != var || field.find('.') == std::string::npos) break;
+			count++;
+		}
+		SlotLayout layout = layoutSlots(module.globals, first, count);
+		std::string symbol = "lilc_g_" + var;
+		out << "\t.align " << layout.align << "\n" << symbol << ":\n\t.zero "
+		  << layout.size << "\n";
+		for (size_t s = 0; s < count; s++){
+			globals[first + s] = symbol + "+" + std::to_string(layout.offsets[s]) + "(%rip)";
+		}
+		first += count;
+	}
+
+	for (size_t f = 0; f < module.functions.size(); f++){
+		RegAllocation alloc = allocateRegisters(module.functions[f]);
+		if (report != nullptr){
+			const RegAllocStats & stats = alloc.stats;
+			*report << "regalloc " << module.functions[f].name << ": "
+			  << stats.inRegisters << " values in registers, " << stats.spilled
+			  << " spilled (" << stats.spillStores << " spill stores, "
+			  << stats.reloads << " reloads), " << stats.rematerialized
+			  << " constants rematerialized, " << stats.coalesced
+			  << " moves coalesced" << std::endl;
+		}
+		FunctionEmitter emitter(module, f, out, globals, alloc);
+		emitter.emit();
+	}
+	out << "\n\t.section .note.GNU-stack,\"\",@progbits\n";
+}
+
+} // End namespace LILC
@@ -0,0 +1,45 @@
+#ifndef LILC_CODEGEN_HPP
+#define LILC_CODEGEN_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ir.hpp"
+
+namespace LILC{
+
+/*
+* Byte layout of a run of scalar slots, such as the flattened fields
+* of a struct: an int takes 4 bytes aligned to 4, a bool 1 byte.
+* Lowering flattens a struct in the order its StructDeclNode lists
+* the fields once struct layout has ordered them, nested structs in
+* place, so this is the layout a C compiler gives the same struct.
+*/
+struct SlotLayout{
+	std::vector<int> offsets; // one per slot
+	int size = 0;             // rounded up to the alignment
+	int align = 1;
+};
+SlotLayout layoutSlots(const std::vector<IRSlot>& slots, size_t first, size_t count);
+
+/*
+* Whether a tail call from caller to callee can jump to it in
+* caller's frame: the callee's stack arguments, past the six passed
+* in registers, must fit where the caller's own arrived.
+*/
+bool fitsTailJump(const IRFunction& caller, const IRFunction& callee);
+
+/*
+* Writes a module whose functions are out of SSA form as GNU
+* assembler source for x86-64 following the System V ABI. Every
+* LIL'C function f becomes a global symbol lilc_f_f and every
+* global variable g a symbol lilc_g_g in .bss; input and output
+* call into the C runtime (lilc_runtime.c), whose main calls
+* lilc_f_main. Values are given registers by allocateRegisters,
+* which reports per function on report if it is not null.
+*/
+void emitAssembly(IRModule& module, std::ostream& out, std::ostream * report = nullptr);
+
+} //End namespace LILC
+
+#endif
@@ -0,0 +1,109 @@
+#include "dataflow.hpp"
+#include <algorithm>
+#include <deque>
+
+namespace LILC{
+
+DataflowResult solveDataflow(IRFunction& fn, DataflowProblem& problem){
+	size_t numBlocks = fn.blocks.size();
+	size_t numBits = problem.boundary.size();
+	bool forward = problem.direction == DataflowProblem::Direction::Forward;
+	bool unionMeet = problem.meet == DataflowProblem::Meet::Union;
+	fn.computePreds();
+
+	std::vector<int> order = fn.reversePostorder();
+	if (!forward) std::reverse(order.begin(), order.end());
+	std::vector<char> reachable(numBlocks, 0);
+	for (int b : order){
+		reachable[b] = 1;
+	}
+
+	// Facts flowing into (before) and out of (after) each block's
+	// transfer function; an intersection starts from the full set
+	std::vector<BitVector> before(numBlocks, BitVector(numBits));
+	std::vector<BitVector> after(numBlocks, BitVector(numBits));
+	if (!unionMeet){
+		for (int b : order){
+			after[b].fill();
+		}
+	}
+
+	std::deque<int> work(order.begin(), order.end());
+	std::vector<char> queued(numBlocks, 0);
+	for (int b : order){
+		queued[b] = 1;
+	}
+	std::vector<int> sources;
+	BitVector fact(numBits);
+	while (!work.empty()){
+		int b = work.front();
+		work.pop_front();
+		queued[b] = 0;
+
+		// Where facts come from: predecessors going forward,
+		// successors going backward
+		sources.clear();
+		if (forward){
+			sources = fn.blocks[b].preds;
+		} else {
+			for (int s = 0; s < fn.blocks[b].numSuccs(); s++){
+				sources.push_back(fn.blocks[b].term.succ[s]);
+			}
+		}
+		// The boundary fact enters the entry (or leaves an exit)
+		// and is met with what flows in along the block's edges,
+		// as an entry can also head a loop
+		BitVector & in = before[b];
+		bool boundary = forward ? b == 0 : sources.empty();
+		if (boundary){
+			in = problem.boundary;
+		} else if (unionMeet){
+			in.clear();
+		} else {
+			in.fill();
+		}
+		for (int source : sources){
+			if (!reachable[source]) continue;
+			fact = after[source];
+			if (forward){
+				problem.edge(source, b, fact);
+			} else {
+				problem.edge(b, source, fact);
+			}
+			if (unionMeet){
+				in.unionWith(fact);
+			} else {
+				in.intersectWith(fact);
+			}
+		}
+
+		problem.transfer(b, in, fact);
+		if (fact == after[b]) continue;
+		after[b] = fact;
+		std::vector<int> dependents;
+		if (forward){
+			for (int s = 0; s < fn.blocks[b].numSuccs(); s++){
+				dependents.push_back(fn.blocks[b].term.succ[s]);
+			}
+		} else {
+			dependents = fn.blocks[b].preds;
+		}
+		for (int d : dependents){
+			if (!reachable[d] || queued[d]) continue;
+			queued[d] = 1;
+			work.push_back(d);
+		}
+	}
+
+	DataflowResult result;
+	if (forward){
+		result.atStart.swap(before);
+		result.atEnd.swap(after);
+	} else {
+		result.atStart.swap(after);
+		result.atEnd.swap(before);
+	}
+	return result;
+}
+
+} // End namespace LILC
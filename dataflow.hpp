@@ -0,0 +1,67 @@
+#ifndef LILC_DATAFLOW_HPP
+#define LILC_DATAFLOW_HPP
+
+#include <vector>
+#include "bitvector.hpp"
+#include "ir.hpp"
+
+namespace LILC{
+
+/*
+* A dataflow problem over the blocks of an IRFunction, with facts
+* kept as BitVectors. By default a block's transfer function is
+*
+*   out = gen | (in & ~kill)
+*
+* taking "in" and "out" in the direction of the analysis (for a
+* backward problem, "in" is the fact at the block's end); override
+* transfer for anything else. edge may add facts that only hold
+* along one edge, such as the phi arguments a block passes to a
+* successor. boundary is the fact entering the entry block
+* (forward) or leaving the exit blocks (backward); it is met with
+* the facts from the entry block's predecessors, if it has any.
+*/
+class DataflowProblem{
+public:
+	enum class Direction { Forward, Backward };
+	enum class Meet { Union, Intersection };
+
+	DataflowProblem(Direction dir, Meet meet, size_t numBits, size_t numBlocks)
+	: direction(dir), meet(meet), gen(numBlocks, BitVector(numBits)),
+	  kill(numBlocks, BitVector(numBits)), boundary(numBits) { }
+	virtual ~DataflowProblem() = default;
+
+	virtual void transfer(int block, const BitVector& in, BitVector& out){
+		out = in;
+		out.subtract(kill[block]);
+		out.unionWith(gen[block]);
+	}
+	virtual void edge(int from, int to, BitVector& fact) { }
+
+	Direction direction;
+	Meet meet;
+	std::vector<BitVector> gen;
+	std::vector<BitVector> kill;
+	BitVector boundary;
+};
+
+/*
+* The facts at the start and end of each block, in program order
+* whatever the direction of the analysis.
+*/
+struct DataflowResult{
+	std::vector<BitVector> atStart;
+	std::vector<BitVector> atEnd;
+};
+
+/*
+* Solves problem over fn with a worklist seeded in reverse
+* postorder (forward) or postorder (backward), so that most blocks
+* see their final inputs the first time they are visited. Blocks
+* unreachable from the entry keep empty facts.
+*/
+DataflowResult solveDataflow(IRFunction& fn, DataflowProblem& problem);
+
+} //End namespace LILC
+
+#endif
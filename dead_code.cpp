@@ -0,0 +1,294 @@
+#include "ast.hpp"
+#include <climits>
+
+namespace LILC{
+
+/*
+* Dead-branch and unreachable-code elimination. Runs after type
+* analysis: if/if-else/while statements whose condition is a
+* compile-time constant are replaced by the branch that is always
+* taken (or removed outright), and statements that can never be
+* reached because control always leaves the list before them
+* (a return, a return on both arms of an if-else, or a while(true)
+* loop) are dropped.
+*/
+
+void ProgramNode::elimDeadCode(){
+	myDeclList->elimDeadCode();
+}
+
+void DeclListNode::elimDeadCode(){
+	for (DeclNode * decl : *myDecls){
+		decl->elimDeadCode();
+	}
+}
+
+void FnDeclNode::elimDeadCode(){
+	myBody->elimDeadCode();
+}
+
+void FnBodyNode::elimDeadCode(){
+	myStmtList->elimDeadCode(myDeclList);
+}
+
+/*
+* Returns true if any name declared in other is also declared
+* in this list.
+*/
+bool DeclListNode::declaresAny(DeclListNode * other){
+	for (DeclNode * mine : *myDecls){
+		for (DeclNode * theirs : *other->myDecls){
+			if (mine->getId() == theirs->getId()) return true;
+		}
+	}
+	return false;
+}
+
+/*
+* Moves every declaration of other onto the end of this list.
+*/
+void DeclListNode::splice(DeclListNode * other){
+	myDecls->splice(myDecls->end(), *other->myDecls);
+}
+
+void StmtListNode::spliceInto(std::list<StmtNode *> * out){
+	out->splice(out->end(), *myStmts);
+}
+
+/*
+* Rebuilds the statement list with every statement simplified.
+* scope is the declaration list of the innermost enclosing block;
+* declarations of branches that get flattened are moved there.
+* Returns true if control can never fall off the end of the list.
+*/
+bool StmtListNode::elimDeadCode(DeclListNode * scope){
+	std::list<StmtNode *> live;
+	bool terminated = false;
+	for (StmtNode * stmt : *myStmts){
+		if (stmt->elimDeadCode(scope, &live)){
+			terminated = true;
+			break;
+		}
+	}
+	myStmts->swap(live);
+	return terminated;
+}
+
+/*
+* By default a statement is kept as-is and control falls
+* through to the next one.
+*/
+bool StmtNode::elimDeadCode(DeclListNode * scope, std::list<StmtNode *> * out){
+	out->push_back(this);
+	return false;
+}
+
+bool ReturnStmtNode::elimDeadCode(DeclListNode * scope, std::list<StmtNode *> * out){
+	out->push_back(this);
+	return true;
+}
+
+/*
+* Splices an always-taken branch into the enclosing statement list.
+* The branch's declarations are hoisted into the enclosing scope
+* unless one of them would collide with a name already declared
+* there, in which case the branch is kept as an if(true) block so
+* that it retains its own scope.
+*/
+static bool spliceBranch(DeclListNode * scope, DeclListNode * decls,
+  StmtListNode * stmts, bool terminates, std::list<StmtNode *> * out){
+	if (scope->declaresAny(decls)){
+		out->push_back(new IfStmtNode(new TrueNode(), decls, stmts));
+	} else {
+		scope->splice(decls);
+		stmts->spliceInto(out);
+	}
+	return terminates;
+}
+
+bool IfStmtNode::elimDeadCode(DeclListNode * scope, std::list<StmtNode *> * out){
+	int cond;
+	bool isConst = myExp->constValue(cond);
+	if (isConst && !cond){
+		return false;
+	}
+	bool terminates = myStmts->elimDeadCode(myDecls);
+	if (isConst){
+		return spliceBranch(scope, myDecls, myStmts, terminates, out);
+	}
+	out->push_back(this);
+	return false;
+}
+
+bool IfElseStmtNode::elimDeadCode(DeclListNode * scope, std::list<StmtNode *> * out){
+	int cond;
+	if (myExp->constValue(cond)){
+		if (cond){
+			bool terminates = myStmtsT->elimDeadCode(myDeclsT);
+			return spliceBranch(scope, myDeclsT, myStmtsT, terminates, out);
+		} else {
+			bool terminates = myStmtsF->elimDeadCode(myDeclsF);
+			return spliceBranch(scope, myDeclsF, myStmtsF, terminates, out);
+		}
+	}
+	bool terminatesT = myStmtsT->elimDeadCode(myDeclsT);
+	bool terminatesF = myStmtsF->elimDeadCode(myDeclsF);
+	out->push_back(this);
+	return terminatesT && terminatesF;
+}
+
+/*
+* A loop that is never entered is removed. LIL'C has no break, so
+* the only way out of a while(true) loop is a return, which makes
+* anything after it unreachable.
+*/
+bool WhileStmtNode::elimDeadCode(DeclListNode * scope, std::list<StmtNode *> * out){
+	int cond;
+	bool isConst = myExp->constValue(cond);
+	if (isConst && !cond){
+		return false;
+	}
+	myStmts->elimDeadCode(myDecls);
+	out->push_back(this);
+	return isConst;
+}
+
+/*
+* Compile-time evaluation of side-effect free expressions built
+* from literals. Bools evaluate to 1 or 0. Returns false if the
+* expression is not a constant, or if evaluating it would trap
+* (division by zero, INT_MIN / -1), leaving that to run time.
+* Arithmetic wraps around like the 32-bit machine ints it models.
+*/
+
+static int wrap(long long val){
+	return (int)(unsigned int)(unsigned long long)val;
+}
+
+bool IntLitNode::constValue(int & val){
+	val = myInt;
+	return true;
+}
+
+bool TrueNode::constValue(int & val){
+	val = 1;
+	return true;
+}
+
+bool FalseNode::constValue(int & val){
+	val = 0;
+	return true;
+}
+
+bool UnaryMinusNode::constValue(int & val){
+	int v;
+	if (!myExp->constValue(v)) return false;
+	val = wrap(-(long long)v);
+	return true;
+}
+
+bool NotNode::constValue(int & val){
+	int v;
+	if (!myExp->constValue(v)) return false;
+	val = !v;
+	return true;
+}
+
+bool PlusNode::constValue(int & val){
+	int v1, v2;
+	if (!myExp1->constValue(v1) || !myExp2->constValue(v2)) return false;
+	val = wrap((long long)v1 + v2);
+	return true;
+}
+
+bool MinusNode::constValue(int & val){
+	int v1, v2;
+	if (!myExp1->constValue(v1) || !myExp2->constValue(v2)) return false;
+	val = wrap((long long)v1 - v2);
+	return true;
+}
+
+bool TimesNode::constValue(int & val){
+	int v1, v2;
+	if (!myExp1->constValue(v1) || !myExp2->constValue(v2)) return false;
+	val = wrap((long long)v1 * v2);
+	return true;
+}
+
+bool DivideNode::constValue(int & val){
+	int v1, v2;
+	if (!myExp1->constValue(v1) || !myExp2->constValue(v2)) return false;
+	if (v2 == 0 || (v1 == INT_MIN && v2 == -1)) return false;
+	val = v1 / v2;
+	return true;
+}
+
+// && and || short-circuit, so a constant left operand may decide
+// the result even when the right operand is not a constant.
+bool AndNode::constValue(int & val){
+	int v1, v2;
+	if (!myExp1->constValue(v1)) return false;
+	if (!v1){
+		val = 0;
+		return true;
+	}
+	if (!myExp2->constValue(v2)) return false;
+	val = (v2 != 0);
+	return true;
+}
+
+bool OrNode::constValue(int & val){
+	int v1, v2;
+	if (!myExp1->constValue(v1)) return false;
+	if (v1){
+		val = 1;
+		return true;
+	}
+	if (!myExp2->constValue(v2)) return false;
+	val = (v2 != 0);
+	return true;
+}
+
+bool EqualsNode::constValue(int & val){
+	int v1, v2;
+	if (!myExp1->constValue(v1) || !myExp2->constValue(v2)) return false;
+	val = (v1 == v2);
+	return true;
+}
+
+bool NotEqualsNode::constValue(int & val){
+	int v1, v2;
+	if (!myExp1->constValue(v1) || !myExp2->constValue(v2)) return false;
+	val = (v1 != v2);
+	return true;
+}
+
+bool LessNode::constValue(int & val){
+	int v1, v2;
+	if (!myExp1->constValue(v1) || !myExp2->constValue(v2)) return false;
+	val = (v1 < v2);
+	return true;
+}
+
+bool GreaterNode::constValue(int & val){
+	int v1, v2;
+	if (!myExp1->constValue(v1) || !myExp2->constValue(v2)) return false;
+	val = (v1 > v2);
+	return true;
+}
+
+bool LessEqNode::constValue(int & val){
+	int v1, v2;
+	if (!myExp1->constValue(v1) || !myExp2->constValue(v2)) return false;
+	val = (v1 <= v2);
+	return true;
+}
+
+bool GreaterEqNode::constValue(int & val){
+	int v1, v2;
+	if (!myExp1->constValue(v1) || !myExp2->constValue(v2)) return false;
+	val = (v1 >= v2);
+	return true;
+}
+
+} // End namespace LIL' C
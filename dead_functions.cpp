@@ -0,0 +1,261 @@
+#include "ast.hpp"
+#include "callgraph.hpp"
+#include <vector>
+
+namespace LILC{
+
+/*
+* Whole-program dead function elimination. Runs right after name
+* and type analysis: the call graph is built from the CallExpNodes
+* of every function, and only the functions reachable from main are
+* kept. A global variable or struct declaration is kept only if a
+* kept function (or another kept declaration) names it. Every later
+* pass and backend then only sees code the program can run.
+*
+* Names are unique across scopes (name analysis reports shadowing as
+* a multiple declaration), so an identifier used inside a function
+* that matches a global's name always refers to that global.
+*/
+
+void ProgramNode::buildCallGraph(CallGraph * graph){
+	std::unordered_map<std::string, std::set<std::string>> uses;
+	myDeclList->buildCallGraph(graph, &uses);
+}
+
+/*
+* Adds every function to graph and records, for each global
+* declaration, the names its body or type refers to.
+*/
+void DeclListNode::buildCallGraph(CallGraph * graph,
+  std::unordered_map<std::string, std::set<std::string>> * uses){
+	for (DeclNode * decl : *myDecls){
+		if (decl->getType() == "fn") graph->addFunction(decl->getId());
+	}
+	for (DeclNode * decl : *myDecls){
+		int fn = decl->getType() == "fn" ? graph->find(decl->getId()) : -1;
+		decl->collectUses(graph, fn, &(*uses)[decl->getId()]);
+	}
+}
+
+void ProgramNode::elimDeadFunctions(std::ostream * report){
+	myDeclList->elimDeadFunctions(report);
+}
+
+void DeclListNode::elimDeadFunctions(std::ostream * report){
+	CallGraph graph;
+	std::unordered_map<std::string, std::set<std::string>> uses;
+	buildCallGraph(&graph, &uses);
+	int main = graph.find("main");
+	if (main < 0) return;
+
+	std::vector<char> reached = graph.reachableFrom(main);
+	std::set<std::string> live;
+	std::vector<std::string> work;
+	for (int fn = 0; fn < graph.size(); fn++){
+		if (reached[fn]) work.push_back(graph.name(fn));
+	}
+	while (!work.empty()){
+		std::string name = work.back();
+		work.pop_back();
+		if (!live.insert(name).second) continue;
+		std::unordered_map<std::string, std::set<std::string>>::iterator found = uses.find(name);
+		if (found == uses.end()) continue;
+		for (const std::string & used : found->second){
+			work.push_back(used);
+		}
+	}
+
+	std::list<DeclNode *> kept;
+	for (DeclNode * decl : *myDecls){
+		if (live.count(decl->getId())){
+			kept.push_back(decl);
+		} else if (report != nullptr){
+			const char * kind = decl->getType() == "fn" ? "function" : "declaration";
+			*report << "prune: removed " << kind << " " << decl->getId() << std::endl;
+		}
+	}
+	myDecls->swap(kept);
+
+	if (report != nullptr){
+		int recursive = 0;
+		std::vector<std::vector<int>> components = graph.sccs();
+		for (std::vector<int> & component : components){
+			if (graph.isRecursive(component[0])) recursive++;
+		}
+		*report << "callgraph: " << graph.size() << " functions, "
+		  << components.size() << " strongly connected components, "
+		  << recursive << " recursive" << std::endl;
+	}
+}
+
+void DeclListNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	for (DeclNode * decl : *myDecls){
+		decl->collectUses(graph, fn, used);
+	}
+}
+
+void VarDeclNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	if (myType->getType() == "struct") used->insert(myType->getTypeString());
+}
+
+void StructDeclNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myDeclList->collectUses(graph, fn, used);
+}
+
+void FnDeclNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myBody->collectUses(graph, fn, used);
+}
+
+void FnBodyNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myDeclList->collectUses(graph, fn, used);
+	myStmtList->collectUses(graph, fn, used);
+}
+
+void StmtListNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	for (StmtNode * stmt : *myStmts){
+		stmt->collectUses(graph, fn, used);
+	}
+}
+
+void AssignStmtNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myAssign->collectUses(graph, fn, used);
+}
+
+void PostIncStmtNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp->collectUses(graph, fn, used);
+}
+
+void PostDecStmtNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp->collectUses(graph, fn, used);
+}
+
+void ReadStmtNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp->collectUses(graph, fn, used);
+}
+
+void WriteStmtNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp->collectUses(graph, fn, used);
+}
+
+void IfStmtNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp->collectUses(graph, fn, used);
+	myDecls->collectUses(graph, fn, used);
+	myStmts->collectUses(graph, fn, used);
+}
+
+void IfElseStmtNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp->collectUses(graph, fn, used);
+	myDeclsT->collectUses(graph, fn, used);
+	myStmtsT->collectUses(graph, fn, used);
+	myDeclsF->collectUses(graph, fn, used);
+	myStmtsF->collectUses(graph, fn, used);
+}
+
+void WhileStmtNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp->collectUses(graph, fn, used);
+	myDecls->collectUses(graph, fn, used);
+	myStmts->collectUses(graph, fn, used);
+}
+
+void CallStmtNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myCallExp->collectUses(graph, fn, used);
+}
+
+void ReturnStmtNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	if (myExp != nullptr) myExp->collectUses(graph, fn, used);
+}
+
+void IdNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	used->insert(myStrVal);
+}
+
+// The field name is not a use of any declaration
+void DotAccessNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp->collectUses(graph, fn, used);
+}
+
+void AssignNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExpLHS->collectUses(graph, fn, used);
+	myExpRHS->collectUses(graph, fn, used);
+}
+
+void CallExpNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	graph->addCall(fn, graph->addFunction(myId->getId()));
+	myExpList->collectUses(graph, fn, used);
+}
+
+void ExpListNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	for (ExpNode * exp : myExps){
+		exp->collectUses(graph, fn, used);
+	}
+}
+
+void UnaryMinusNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp->collectUses(graph, fn, used);
+}
+
+void NotNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp->collectUses(graph, fn, used);
+}
+
+void PlusNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp1->collectUses(graph, fn, used);
+	myExp2->collectUses(graph, fn, used);
+}
+
+void MinusNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp1->collectUses(graph, fn, used);
+	myExp2->collectUses(graph, fn, used);
+}
+
+void TimesNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp1->collectUses(graph, fn, used);
+	myExp2->collectUses(graph, fn, used);
+}
+
+void DivideNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp1->collectUses(graph, fn, used);
+	myExp2->collectUses(graph, fn, used);
+}
+
+void AndNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp1->collectUses(graph, fn, used);
+	myExp2->collectUses(graph, fn, used);
+}
+
+void OrNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp1->collectUses(graph, fn, used);
+	myExp2->collectUses(graph, fn, used);
+}
+
+void EqualsNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp1->collectUses(graph, fn, used);
+	myExp2->collectUses(graph, fn, used);
+}
+
+void NotEqualsNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp1->collectUses(graph, fn, used);
+	myExp2->collectUses(graph, fn, used);
+}
+
+void LessNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp1->collectUses(graph, fn, used);
+	myExp2->collectUses(graph, fn, used);
+}
+
+void GreaterNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp1->collectUses(graph, fn, used);
+	myExp2->collectUses(graph, fn, used);
+}
+
+void LessEqNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp1->collectUses(graph, fn, used);
+	myExp2->collectUses(graph, fn, used);
+}
+
+void GreaterEqNode::collectUses(CallGraph * graph, int fn, std::set<std::string> * used){
+	myExp1->collectUses(graph, fn, used);
+	myExp2->collectUses(graph, fn, used);
+}
+
+} // End namespace LILC
@@ -0,0 +1,407 @@
+#include "ast.hpp"
+
+namespace LILC{
+
+/*
+* Liveness analysis and dead-store elimination. Runs after dead
+* code elimination, once per function body, as a backward walk over
+* its statements that follows the control flow the statements
+* describe: both arms of an if-else meet where it ends, an if may
+* also be skipped, and the liveness at the head of a while loop is
+* iterated to a fixpoint before the body is rewritten. Each local
+* and each field of a local struct is tracked on its own.
+*
+* An assignment, or a ++ or --, whose target is dead afterwards is
+* removed when evaluating its right-hand side has no side effect
+* and cannot trap, i.e. divides only by constants other than 0 and
+* -1. Reads are always kept since they consume input. Locals no kept
+* statement names are then pruned from their declaration lists.
+*/
+
+static std::string rootOf(const std::string& key){
+	return key.substr(0, key.find('.'));
+}
+
+bool LiveVars::isLocal(const std::string& key){
+	return !key.empty() && !globals.count(rootOf(key));
+}
+
+size_t LiveVars::indexOf(const std::string& key){
+	std::unordered_map<std::string, size_t>::iterator found = indices.find(key);
+	if (found != indices.end()) return found->second;
+	size_t index = indices.size();
+	indices[key] = index;
+	return index;
+}
+
+bool LiveVars::isDead(const std::string& key){
+	return isLocal(key) && !live.test(indexOf(key));
+}
+
+void LiveVars::use(const std::string& key){
+	if (!isLocal(key)) return;
+	live.set(indexOf(key));
+	if (transform) referenced.insert(rootOf(key));
+}
+
+void LiveVars::def(const std::string& key){
+	if (!isLocal(key)) return;
+	live.reset(indexOf(key));
+	if (transform) referenced.insert(rootOf(key));
+}
+
+void ProgramNode::elimDeadStores(std::ostream * report){
+	myDeclList->elimDeadStores(report);
+}
+
+void DeclListNode::elimDeadStores(std::ostream * report){
+	std::set<std::string> globals;
+	for (DeclNode * decl : *myDecls){
+		if (decl->getType() != "fn") globals.insert(decl->getId());
+	}
+	for (DeclNode * decl : *myDecls){
+		decl->elimDeadStores(globals, report);
+	}
+}
+
+void FnDeclNode::elimDeadStores(const std::set<std::string>& globals, std::ostream * report){
+	LiveVars vars(globals);
+	myBody->liveness(&vars);
+	int pruned = myBody->pruneLocals(vars.referenced);
+	if (report != nullptr){
+		*report << "dse " << getId() << ": " << vars.removed
+		  << " dead stores removed, " << pruned
+		  << " unused locals pruned" << std::endl;
+	}
+}
+
+// Nothing a function assigns is live once it returns
+bool FnBodyNode::liveness(LiveVars * vars){
+	vars->live.clear();
+	return myStmtList->liveness(vars);
+}
+
+int FnBodyNode::pruneLocals(const std::set<std::string>& referenced){
+	return myDeclList->pruneLocals(referenced) + myStmtList->pruneLocals(referenced);
+}
+
+int DeclListNode::pruneLocals(const std::set<std::string>& referenced){
+	std::list<DeclNode *> kept;
+	for (DeclNode * decl : *myDecls){
+		if (referenced.count(decl->getId())) kept.push_back(decl);
+	}
+	int pruned = myDecls->size() - kept.size();
+	myDecls->swap(kept);
+	return pruned;
+}
+
+/*
+* Walks the list backwards from the liveness at its end, leaving
+* the liveness at its start. A statement returns false when it is
+* a dead store, and is dropped if the walk is rewriting the code.
+*/
+bool StmtListNode::liveness(LiveVars * vars){
+	std::list<StmtNode *> kept;
+	for (std::list<StmtNode *>::reverse_iterator it = myStmts->rbegin();
+	  it != myStmts->rend(); ++it){
+		if ((*it)->liveness(vars)){
+			kept.push_front(*it);
+		} else if (vars->transform){
+			vars->removed++;
+		}
+	}
+	if (vars->transform) myStmts->swap(kept);
+	return true;
+}
+
+int StmtListNode::pruneLocals(const std::set<std::string>& referenced){
+	int pruned = 0;
+	for (StmtNode * stmt : *myStmts){
+		pruned += stmt->pruneLocals(referenced);
+	}
+	return pruned;
+}
+
+bool AssignStmtNode::liveness(LiveVars * vars){
+	return myAssign->liveness(vars);
+}
+
+/*
+* As a statement, an assignment kills its target. Nested inside an
+* expression, its target is counted as used instead, which leaves
+* more live than needed but never too little.
+*/
+bool AssignNode::liveness(LiveVars * vars){
+	std::string key = myExpLHS->accessPath();
+	if (vars->isDead(key) && !myExpRHS->hasSideEffects() && !myExpRHS->canTrap()){
+		return false;
+	}
+	vars->def(key);
+	myExpRHS->liveUses(vars);
+	return true;
+}
+
+bool PostIncStmtNode::liveness(LiveVars * vars){
+	std::string key = myExp->accessPath();
+	if (vars->isDead(key)) return false;
+	vars->use(key);
+	return true;
+}
+
+bool PostDecStmtNode::liveness(LiveVars * vars){
+	std::string key = myExp->accessPath();
+	if (vars->isDead(key)) return false;
+	vars->use(key);
+	return true;
+}
+
+bool ReadStmtNode::liveness(LiveVars * vars){
+	vars->def(myExp->accessPath());
+	return true;
+}
+
+bool WriteStmtNode::liveness(LiveVars * vars){
+	myExp->liveUses(vars);
+	return true;
+}
+
+bool IfStmtNode::liveness(LiveVars * vars){
+	BitVector after = vars->live;
+	myStmts->liveness(vars);
+	vars->live.unionWith(after);
+	myExp->liveUses(vars);
+	return true;
+}
+
+int IfStmtNode::pruneLocals(const std::set<std::string>& referenced){
+	return myDecls->pruneLocals(referenced) + myStmts->pruneLocals(referenced);
+}
+
+bool IfElseStmtNode::liveness(LiveVars * vars){
+	BitVector after = vars->live;
+	myStmtsT->liveness(vars);
+	BitVector liveT = vars->live;
+	vars->live = after;
+	myStmtsF->liveness(vars);
+	vars->live.unionWith(liveT);
+	myExp->liveUses(vars);
+	return true;
+}
+
+int IfElseStmtNode::pruneLocals(const std::set<std::string>& referenced){
+	return myDeclsT->pruneLocals(referenced) + myStmtsT->pruneLocals(referenced)
+	  + myDeclsF->pruneLocals(referenced) + myStmtsF->pruneLocals(referenced);
+}
+
+/*
+* The liveness at the loop head is what the condition reads plus
+* what is live after the loop or at the start of the body, which in
+* turn depends on the liveness at the head. It only grows, so it is
+* found by iterating without rewriting; the body is then rewritten
+* once against the result.
+*/
+bool WhileStmtNode::liveness(LiveVars * vars){
+	bool transform = vars->transform;
+	vars->transform = false;
+	myExp->liveUses(vars);
+	BitVector head = vars->live;
+	while (true){
+		myStmts->liveness(vars);
+		vars->live.unionWith(head);
+		if (vars->live == head) break;
+		head = vars->live;
+	}
+	vars->transform = transform;
+	myStmts->liveness(vars);
+	vars->live = head;
+	myExp->liveUses(vars);
+	return true;
+}
+
+int WhileStmtNode::pruneLocals(const std::set<std::string>& referenced){
+	return myDecls->pruneLocals(referenced) + myStmts->pruneLocals(referenced);
+}
+
+bool CallStmtNode::liveness(LiveVars * vars){
+	myCallExp->liveUses(vars);
+	return true;
+}
+
+bool ReturnStmtNode::liveness(LiveVars * vars){
+	vars->live.clear();
+	if (myExp != nullptr) myExp->liveUses(vars);
+	return true;
+}
+
+void IdNode::liveUses(LiveVars * vars){
+	vars->use(myStrVal);
+}
+
+// The path of a field access, or "" if it is not rooted at a variable
+std::string DotAccessNode::accessPath(){
+	std::string base = myExp->accessPath();
+	if (base.empty()) return "";
+	return base + "." + myId->getId();
+}
+
+void DotAccessNode::liveUses(LiveVars * vars){
+	vars->use(accessPath());
+}
+
+void AssignNode::liveUses(LiveVars * vars){
+	vars->use(myExpLHS->accessPath());
+	myExpRHS->liveUses(vars);
+}
+
+void CallExpNode::liveUses(LiveVars * vars){
+	myExpList->liveUses(vars);
+}
+
+void ExpListNode::liveUses(LiveVars * vars){
+	for (ExpNode * exp : myExps){
+		exp->liveUses(vars);
+	}
+}
+
+void UnaryMinusNode::liveUses(LiveVars * vars){
+	myExp->liveUses(vars);
+}
+
+void NotNode::liveUses(LiveVars * vars){
+	myExp->liveUses(vars);
+}
+
+void PlusNode::liveUses(LiveVars * vars){
+	myExp1->liveUses(vars);
+	myExp2->liveUses(vars);
+}
+
+void MinusNode::liveUses(LiveVars * vars){
+	myExp1->liveUses(vars);
+	myExp2->liveUses(vars);
+}
+
+void TimesNode::liveUses(LiveVars * vars){
+	myExp1->liveUses(vars);
+	myExp2->liveUses(vars);
+}
+
+void DivideNode::liveUses(LiveVars * vars){
+	myExp1->liveUses(vars);
+	myExp2->liveUses(vars);
+}
+
+void AndNode::liveUses(LiveVars * vars){
+	myExp1->liveUses(vars);
+	myExp2->liveUses(vars);
+}
+
+void OrNode::liveUses(LiveVars * vars){
+	myExp1->liveUses(vars);
+	myExp2->liveUses(vars);
+}
+
+void EqualsNode::liveUses(LiveVars * vars){
+	myExp1->liveUses(vars);
+	myExp2->liveUses(vars);
+}
+
+void NotEqualsNode::liveUses(LiveVars * vars){
+	myExp1->liveUses(vars);
+	myExp2->liveUses(vars);
+}
+
+void LessNode::liveUses(LiveVars * vars){
+	myExp1->liveUses(vars);
+	myExp2->liveUses(vars);
+}
+
+void GreaterNode::liveUses(LiveVars * vars){
+	myExp1->liveUses(vars);
+	myExp2->liveUses(vars);
+}
+
+void LessEqNode::liveUses(LiveVars * vars){
+	myExp1->liveUses(vars);
+	myExp2->liveUses(vars);
+}
+
+void GreaterEqNode::liveUses(LiveVars * vars){
+	myExp1->liveUses(vars);
+	myExp2->liveUses(vars);
+}
+
+bool AssignNode::canTrap(){
+	return myExpLHS->canTrap() || myExpRHS->canTrap();
+}
+
+bool CallExpNode::canTrap(){
+	return true;
+}
+
+bool ExpListNode::canTrap(){
+	for (ExpNode * exp : myExps){
+		if (exp->canTrap()) return true;
+	}
+	return false;
+}
+
+bool UnaryMinusNode::canTrap(){
+	return myExp->canTrap();
+}
+
+bool NotNode::canTrap(){
+	return myExp->canTrap();
+}
+
+bool PlusNode::canTrap(){
+	return myExp1->canTrap() || myExp2->canTrap();
+}
+
+bool MinusNode::canTrap(){
+	return myExp1->canTrap() || myExp2->canTrap();
+}
+
+bool TimesNode::canTrap(){
+	return myExp1->canTrap() || myExp2->canTrap();
+}
+
+bool DivideNode::canTrap(){
+	int divisor;
+	if (!myExp2->constValue(divisor) || divisor == 0 || divisor == -1) return true;
+	return myExp1->canTrap() || myExp2->canTrap();
+}
+
+bool AndNode::canTrap(){
+	return myExp1->canTrap() || myExp2->canTrap();
+}
+
+bool OrNode::canTrap(){
+	return myExp1->canTrap() || myExp2->canTrap();
+}
+
+bool EqualsNode::canTrap(){
+	return myExp1->canTrap() || myExp2->canTrap();
+}
+
+bool NotEqualsNode::canTrap(){
+	return myExp1->canTrap() || myExp2->canTrap();
+}
+
+bool LessNode::canTrap(){
+	return myExp1->canTrap() || myExp2->canTrap();
+}
+
+bool GreaterNode::canTrap(){
+	return myExp1->canTrap() || myExp2->canTrap();
+}
+
+bool LessEqNode::canTrap(){
+	return myExp1->canTrap() || myExp2->canTrap();
+}
+
+bool GreaterEqNode::canTrap(){
+	return myExp1->canTrap() || myExp2->canTrap();
+}
+
+} // End namespace LILC
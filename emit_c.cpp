@@ -0,0 +1,480 @@
+#include "ast.hpp"
+#include "ir.hpp"
+#include <climits>
+#include <sstream>
+
+namespace LILC{
+
+/*
+* Translation of the typed AST into C99, to be built with a C
+* compiler against lilc_runtime.h and lilc_runtime.c:
+*
+*     P5 prog.lilc prog.c -c && cc -O2 prog.c lilc_runtime.c -o prog
+*
+* Every function is declared up front, by a prototype listing its
+* LIL'C type as getTypeString gives it; the rest of the
+* declarations come out in source order, as C needs them. Every
+* variable and field x becomes v_x, every struct S struct s_S and
+* every function f lilc_f_f, so no name can clash with a C keyword
+* or with the runtime. The translation keeps LIL'C semantics
+* exactly: +, -, * and unary minus wrap around and / traps on zero
+* through the runtime's helpers, && and || are C's own, and where C
+* leaves the order operands are evaluated in unspecified a temporary
+* fixes it to the left-to-right order the other backends use.
+*
+* String literals are written once each, as static arrays ahead of
+* the code, which refers to them by name: lilc_s0, lilc_s1 and so
+* on by their index in the program's StringPool.
+*/
+
+namespace {
+
+/*
+* A literal's text re-escaped for C. Question marks are escaped too,
+* as C99 would otherwise read ??( and the like as trigraphs.
+*/
+void emitCString(std::ostream& out, const char * text, size_t length){
+	static const char * const octal = "01234567";
+	out << "\"";
+	for (size_t i = 0; i < length; i++){
+		char ch = text[i];
+		unsigned char u = ch;
+		if (ch == '"' || ch == '\\' || ch == '?'){
+			out << "\\" << ch;
+		} else if (ch == '\n'){
+			out << "\\n";
+		} else if (ch == '\t'){
+			out << "\\t";
+		} else if (u < 0x20 || u >= 0x7f){
+			out << "\\" << octal[u >> 6] << octal[(u >> 3) & 7] << octal[u & 7];
+		} else {
+			out << ch;
+		}
+	}
+	out << "\"";
+}
+
+} // End anonymous namespace
+
+void ProgramNode::emitC(std::ostream& out, const StringPool& strings){
+	CEmitter c;
+	std::ostringstream code;
+	myDeclList->emitC(&c, code, 0);
+	out << "#include \"lilc_runtime.h\"\n\n";
+	for (int s : c.strings){
+		out << "static const char lilc_s" << s << "[] = ";
+		emitCString(out, strings.text(s), strings.length(s));
+		out << ";\n";
+	}
+	if (!c.strings.empty()) out << "\n";
+	myDeclList->emitCPrototypes(out);
+	out << code.str();
+}
+
+void DeclListNode::emitCPrototypes(std::ostream& out){
+	for (DeclNode * decl : *myDecls){
+		decl->emitCPrototype(out);
+	}
+}
+
+void DeclListNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	for (DeclNode * decl : *myDecls){
+		decl->emitC(c, out, indent);
+	}
+}
+
+/*
+* Globals start out zeroed as static storage does, and locals are
+* zeroed where they are declared, each time control reaches them.
+*/
+void VarDeclNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	doIndent(out, indent);
+	if (c->scope == CEmitter::Global) out << "static ";
+	out << myType->getCType() << " v_" << myId->getId();
+	if (c->scope == CEmitter::Local){
+		std::string type = myType->getType();
+		out << (type == "struct" ? " = {0}" : type == "bool" ? " = false" : " = 0");
+	}
+	out << ";\n";
+}
+
+void StructDeclNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	CEmitter::Scope outer = c->scope;
+	out << "\n";
+	doIndent(out, indent);
+	out << "struct s_" << myId->getId() << "{\n";
+	c->scope = CEmitter::Field;
+	myDeclList->emitC(c, out, indent+4);
+	c->scope = outer;
+	doIndent(out, indent);
+	out << "};\n";
+}
+
+/*
+* Only main is visible outside the translation unit, for the
+* runtime to call.
+*/
+void FnDeclNode::emitCHeader(std::ostream& out){
+	if (myId->getId() != "main") out << "static ";
+	out << myType->getCType() << " lilc_f_" << myId->getId() << "(";
+	myFormals->emitC(nullptr, out, 0);
+	out << ")";
+}
+
+void FnDeclNode::emitCPrototype(std::ostream& out){
+	emitCHeader(out);
+	out << "; /* " << getTypeString() << " */\n";
+}
+
+/*
+* The body is emitted first so that the temporaries it needs can
+* be declared ahead of it. Control reaching the end of a function
+* with a result returns 0, as lowering makes it.
+*/
+void FnDeclNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	std::ostringstream body;
+	c->scope = CEmitter::Local;
+	c->temps = 0;
+	myBody->emitC(c, body, indent+4);
+	c->scope = CEmitter::Global;
+
+	out << "\n";
+	doIndent(out, indent);
+	emitCHeader(out);
+	out << "{\n";
+	if (c->temps > 0){
+		doIndent(out, indent+4);
+		out << "int";
+		for (int t = 0; t < c->temps; t++){
+			out << (t == 0 ? " " : ", ") << "t" << t;
+		}
+		out << ";\n";
+	}
+	out << body.str();
+	if (myType->getType() != "void" && !myBody->endsInReturn()){
+		doIndent(out, indent+4);
+		out << "return 0;\n";
+	}
+	doIndent(out, indent);
+	out << "}\n";
+}
+
+void FormalsListNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	if (myFormals->empty()){
+		out << "void";
+		return;
+	}
+	for (std::list<FormalDeclNode *>::iterator it = myFormals->begin();
+	  it != myFormals->end(); ++it){
+		if (it != myFormals->begin()) out << ", ";
+		(*it)->emitC(c, out, 0);
+	}
+}
+
+void FormalDeclNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	out << myType->getCType() << " v_" << myId->getId();
+}
+
+void FnBodyNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	myDeclList->emitC(c, out, indent);
+	myStmtList->emitC(c, out, indent);
+}
+
+// Statements
+
+void StmtListNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	for (StmtNode * stmt : *myStmts){
+		stmt->emitC(c, out, indent);
+	}
+}
+
+bool StmtListNode::endsInReturn(){
+	return !myStmts->empty()
+		&& dynamic_cast<ReturnStmtNode *>(myStmts->back()) != nullptr;
+}
+
+void AssignStmtNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	doIndent(out, indent);
+	myAssign->emitCAssign(c, out);
+	out << ";\n";
+}
+
+void PostIncStmtNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	doIndent(out, indent);
+	myExp->emitC(c, out);
+	out << " = lilc_rt_add(";
+	myExp->emitC(c, out);
+	out << ", 1);\n";
+}
+
+void PostDecStmtNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	doIndent(out, indent);
+	myExp->emitC(c, out);
+	out << " = lilc_rt_sub(";
+	myExp->emitC(c, out);
+	out << ", 1);\n";
+}
+
+/*
+* Input is always read as an integer; a bool takes whether it was
+* nonzero, which is what assigning an int to a C bool does.
+*/
+void ReadStmtNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	doIndent(out, indent);
+	myExp->emitC(c, out);
+	out << " = lilc_rt_read_int();\n";
+}
+
+/*
+* A bool is written as the int it converts to, 0 or 1.
+*/
+void WriteStmtNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	doIndent(out, indent);
+	out << (dynamic_cast<StrLitNode *>(myExp) != nullptr
+		? "lilc_rt_write_str(" : "lilc_rt_write_int(");
+	myExp->emitC(c, out);
+	out << ");\n";
+}
+
+void IfStmtNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	doIndent(out, indent);
+	out << "if (";
+	myExp->emitC(c, out);
+	out << "){\n";
+	myDecls->emitC(c, out, indent+4);
+	myStmts->emitC(c, out, indent+4);
+	doIndent(out, indent);
+	out << "}\n";
+}
+
+void IfElseStmtNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	doIndent(out, indent);
+	out << "if (";
+	myExp->emitC(c, out);
+	out << "){\n";
+	myDeclsT->emitC(c, out, indent+4);
+	myStmtsT->emitC(c, out, indent+4);
+	doIndent(out, indent);
+	out << "} else {\n";
+	myDeclsF->emitC(c, out, indent+4);
+	myStmtsF->emitC(c, out, indent+4);
+	doIndent(out, indent);
+	out << "}\n";
+}
+
+void WhileStmtNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	doIndent(out, indent);
+	out << "while (";
+	myExp->emitC(c, out);
+	out << "){\n";
+	myDecls->emitC(c, out, indent+4);
+	myStmts->emitC(c, out, indent+4);
+	doIndent(out, indent);
+	out << "}\n";
+}
+
+void CallStmtNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	doIndent(out, indent);
+	myCallExp->emitC(c, out);
+	out << ";\n";
+}
+
+void ReturnStmtNode::emitC(CEmitter * c, std::ostream& out, int indent){
+	doIndent(out, indent);
+	out << "return";
+	if (myExp != nullptr){
+		out << " ";
+		myExp->emitC(c, out);
+	}
+	out << ";\n";
+}
+
+// Expressions
+
+void IdNode::emitC(CEmitter * c, std::ostream& out){
+	out << "v_" << myStrVal;
+}
+
+void DotAccessNode::emitC(CEmitter * c, std::ostream& out){
+	myExp->emitC(c, out);
+	out << ".v_" << myId->getId();
+}
+
+/*
+* INT_MIN has no literal of its own in C.
+*/
+void IntLitNode::emitC(CEmitter * c, std::ostream& out){
+	if (myInt == INT_MIN){
+		out << "(-" << INT_MAX << " - 1)";
+	} else if (myInt < 0){
+		out << "(" << myInt << ")";
+	} else {
+		out << myInt;
+	}
+}
+
+void StrLitNode::emitC(CEmitter * c, std::ostream& out){
+	c->strings.insert(myIndex);
+	out << "lilc_s" << myIndex;
+}
+
+void TrueNode::emitC(CEmitter * c, std::ostream& out){
+	out << "true";
+}
+
+void FalseNode::emitC(CEmitter * c, std::ostream& out){
+	out << "false";
+}
+
+/*
+* The location assigned to has no side effects, so C's ordering of
+* an assignment, right-hand side first, gives the same result.
+*/
+void AssignNode::emitCAssign(CEmitter * c, std::ostream& out){
+	myExpLHS->emitC(c, out);
+	out << " = ";
+	myExpRHS->emitC(c, out);
+}
+
+void AssignNode::emitC(CEmitter * c, std::ostream& out){
+	out << "(";
+	emitCAssign(c, out);
+	out << ")";
+}
+
+void CallExpNode::emitC(CEmitter * c, std::ostream& out){
+	myExpList->emitC(c, out, "lilc_f_" + myId->getId());
+}
+
+/*
+* C evaluates the arguments of a call in no particular order. When
+* any of them has side effects they are all evaluated into
+* temporaries first, left to right, and the call takes those.
+*/
+void ExpListNode::emitC(CEmitter * c, std::ostream& out, const std::string& fn){
+	if (myExps.size() < 2 || !hasSideEffects()){
+		out << fn << "(";
+		for (std::list<ExpNode *>::iterator it = myExps.begin();
+		  it != myExps.end(); ++it){
+			if (it != myExps.begin()) out << ", ";
+			(*it)->emitC(c, out);
+		}
+		out << ")";
+		return;
+	}
+	// The actuals may take temporaries of their own after these
+	int first = c->temps;
+	int last = first + myExps.size();
+	c->temps = last;
+	out << "(";
+	int t = first;
+	for (ExpNode * exp : myExps){
+		out << "t" << t++ << " = ";
+		exp->emitC(c, out);
+		out << ", ";
+	}
+	out << fn << "(";
+	for (t = first; t < last; t++){
+		out << (t == first ? "" : ", ") << "t" << t;
+	}
+	out << "))";
+}
+
+void UnaryMinusNode::emitC(CEmitter * c, std::ostream& out){
+	out << "lilc_rt_neg(";
+	myExp->emitC(c, out);
+	out << ")";
+}
+
+void NotNode::emitC(CEmitter * c, std::ostream& out){
+	out << "(!";
+	myExp->emitC(c, out);
+	out << ")";
+}
+
+/*
+* Writes open exp1 sep exp2 close. C may evaluate exp2 before exp1,
+* so when either has side effects exp1 is saved in a temporary
+* first, as lowering pins it; a division that traps then also traps
+* before or after the side effects of the other operand exactly as
+* it does in the other backends.
+*/
+static void emitBinary(CEmitter * c, std::ostream& out, const char * open,
+  const char * sep, const char * close, ExpNode * exp1, ExpNode * exp2){
+	if (!exp1->hasSideEffects() && !exp2->hasSideEffects()){
+		out << open;
+		exp1->emitC(c, out);
+		out << sep;
+		exp2->emitC(c, out);
+		out << close;
+		return;
+	}
+	int temp = c->temps++;
+	out << "(t" << temp << " = ";
+	exp1->emitC(c, out);
+	out << ", " << open << "t" << temp << sep;
+	exp2->emitC(c, out);
+	out << close << ")";
+}
+
+void PlusNode::emitC(CEmitter * c, std::ostream& out){
+	emitBinary(c, out, "lilc_rt_add(", ", ", ")", myExp1, myExp2);
+}
+
+void MinusNode::emitC(CEmitter * c, std::ostream& out){
+	emitBinary(c, out, "lilc_rt_sub(", ", ", ")", myExp1, myExp2);
+}
+
+void TimesNode::emitC(CEmitter * c, std::ostream& out){
+	emitBinary(c, out, "lilc_rt_mul(", ", ", ")", myExp1, myExp2);
+}
+
+void DivideNode::emitC(CEmitter * c, std::ostream& out){
+	emitBinary(c, out, "lilc_rt_div(", ", ", ")", myExp1, myExp2);
+}
+
+/*
+* C's && and || already evaluate their right operand only when
+* needed and yield 0 or 1.
+*/
+void AndNode::emitC(CEmitter * c, std::ostream& out){
+	out << "(";
+	myExp1->emitC(c, out);
+	out << " && ";
+	myExp2->emitC(c, out);
+	out << ")";
+}
+
+void OrNode::emitC(CEmitter * c, std::ostream& out){
+	out << "(";
+	myExp1->emitC(c, out);
+	out << " || ";
+	myExp2->emitC(c, out);
+	out << ")";
+}
+
+void EqualsNode::emitC(CEmitter * c, std::ostream& out){
+	emitBinary(c, out, "(", " == ", ")", myExp1, myExp2);
+}
+
+void NotEqualsNode::emitC(CEmitter * c, std::ostream& out){
+	emitBinary(c, out, "(", " != ", ")", myExp1, myExp2);
+}
+
+void LessNode::emitC(CEmitter * c, std::ostream& out){
+	emitBinary(c, out, "(", " < ", ")", myExp1, myExp2);
+}
+
+void GreaterNode::emitC(CEmitter * c, std::ostream& out){
+	emitBinary(c, out, "(", " > ", ")", myExp1, myExp2);
+}
+
+void LessEqNode::emitC(CEmitter * c, std::ostream& out){
+	emitBinary(c, out, "(", " <= ", ")", myExp1, myExp2);
+}
+
+void GreaterEqNode::emitC(CEmitter * c, std::ostream& out){
+	emitBinary(c, out, "(", " >= ", ")", myExp1, myExp2);
+}
+
+} // End namespace LILC
@@ -0,0 +1,529 @@
+#include "ast.hpp"
+#include "callgraph.hpp"
+#include <climits>
+#include <vector>
+
+namespace LILC{
+
+/*
+* Compile-time evaluation of calls to pure functions, run under -O
+* right after type analysis so that dead function elimination drops
+* the helpers no call is left to. A function is pure when it does no
+* I/O, names no global and calls only pure functions; the call graph
+* is walked callees first, so each strongly connected component is
+* settled once every function it calls is. A call to a pure function
+* returning an int or a bool whose arguments are all constants, once
+* the calls among them have been evaluated, is run by an interpreter
+* over the typed AST and replaced by a literal of its result.
+*
+* The interpreter keeps to what the compiled program would do:
+* arithmetic wraps around, && and || short-circuit, locals start at
+* 0, and an int function falling off its end returns 0. It gives up,
+* leaving the call to run time, on a division that would trap, once
+* the call has taken more than fuel steps (a statement executed or a
+* loop test evaluated), or when calls nest deeper than MAX_DEPTH.
+*/
+
+static const int MAX_DEPTH = 1000;
+
+static int wrap(long long val){
+	return (int)(unsigned int)(unsigned long long)val;
+}
+
+// Runs a block, its locals starting over at 0
+static EvalStatus executeBlock(CallEvaluator * ev, EvalFrame * frame,
+  DeclListNode * decls, StmtListNode * stmts){
+	decls->enterBlock(frame);
+	return stmts->execute(ev, frame);
+}
+
+void ProgramNode::evalCalls(long fuel, std::ostream * report){
+	myDeclList->evalCalls(fuel, report);
+}
+
+void DeclListNode::evalCalls(long fuel, std::ostream * report){
+	CallGraph graph;
+	std::unordered_map<std::string, std::set<std::string>> uses;
+	buildCallGraph(&graph, &uses);
+
+	CallEvaluator ev(fuel);
+	std::set<std::string> globals;
+	for (DeclNode * decl : *myDecls){
+		if (decl->getType() == "fn"){
+			ev.functions[decl->getId()] = static_cast<FnDeclNode *>(decl);
+		} else if (dynamic_cast<VarDeclNode *>(decl) != nullptr){
+			globals.insert(decl->getId());
+		}
+	}
+
+	for (const std::vector<int> & component : graph.sccs()){
+		bool pure = true;
+		for (int fn : component){
+			const std::string & name = graph.name(fn);
+			if (ev.functions[name]->doesIO()) pure = false;
+			for (const std::string & used : uses[name]){
+				if (globals.count(used)) pure = false;
+			}
+			for (int callee : graph.callees(fn)){
+				if (graph.sccOf(callee) != graph.sccOf(fn)
+				  && !ev.pure.count(graph.name(callee))) pure = false;
+			}
+		}
+		if (!pure) continue;
+		for (int fn : component){
+			ev.pure.insert(graph.name(fn));
+		}
+	}
+
+	for (DeclNode * decl : *myDecls){
+		decl->evalCalls(&ev);
+	}
+	if (report != nullptr){
+		*report << "consteval: " << ev.pure.size() << " of " << graph.size()
+		  << " functions pure, " << ev.evaluated << " calls evaluated, "
+		  << ev.outOfFuel << " out of fuel" << std::endl;
+	}
+}
+
+void FnDeclNode::evalCalls(CallEvaluator * ev){
+	myBody->evalCalls(ev);
+}
+
+/*
+* Runs the function on args. Returns false if the interpreter gave
+* up, and otherwise sets val to the value returned.
+*/
+bool FnDeclNode::evalCall(CallEvaluator * ev, const std::vector<int>& args, int & val){
+	if (ev->depth >= MAX_DEPTH) return false;
+	EvalFrame frame;
+	myFormals->bind(args, &frame);
+	ev->depth++;
+	EvalStatus status = myBody->execute(ev, &frame);
+	ev->depth--;
+	if (status == EvalStatus::Fail) return false;
+	val = status == EvalStatus::Return ? ev->result : 0;
+	return true;
+}
+
+void FormalsListNode::bind(const std::vector<int>& args, EvalFrame * frame){
+	std::vector<int>::const_iterator arg = args.begin();
+	for (FormalDeclNode * formal : *myFormals){
+		(*frame)[formal->getId()] = *arg++;
+	}
+}
+
+// Rewriting: each expression is replaced by what evalCalls returns
+
+void StmtListNode::evalCalls(CallEvaluator * ev){
+	for (StmtNode * stmt : *myStmts){
+		stmt->evalCalls(ev);
+	}
+}
+
+void AssignStmtNode::evalCalls(CallEvaluator * ev){
+	myAssign->evalCalls(ev);
+}
+
+void WriteStmtNode::evalCalls(CallEvaluator * ev){
+	myExp = myExp->evalCalls(ev);
+}
+
+void IfStmtNode::evalCalls(CallEvaluator * ev){
+	myExp = myExp->evalCalls(ev);
+	myStmts->evalCalls(ev);
+}
+
+void IfElseStmtNode::evalCalls(CallEvaluator * ev){
+	myExp = myExp->evalCalls(ev);
+	myStmtsT->evalCalls(ev);
+	myStmtsF->evalCalls(ev);
+}
+
+void WhileStmtNode::evalCalls(CallEvaluator * ev){
+	myExp = myExp->evalCalls(ev);
+	myStmts->evalCalls(ev);
+}
+
+// The call itself is kept: a statement has no use for its result
+void CallStmtNode::evalCalls(CallEvaluator * ev){
+	myCallExp->evalArgs(ev);
+}
+
+void ReturnStmtNode::evalCalls(CallEvaluator * ev){
+	if (myExp != nullptr) myExp = myExp->evalCalls(ev);
+}
+
+void ExpListNode::evalCalls(CallEvaluator * ev){
+	for (ExpNode *& exp : myExps){
+		exp = exp->evalCalls(ev);
+	}
+}
+
+bool ExpListNode::constValues(std::vector<int> * vals){
+	for (ExpNode * exp : myExps){
+		int val;
+		if (!exp->constValue(val)) return false;
+		vals->push_back(val);
+	}
+	return true;
+}
+
+void CallExpNode::evalArgs(CallEvaluator * ev){
+	myExpList->evalCalls(ev);
+}
+
+ExpNode * CallExpNode::evalCalls(CallEvaluator * ev){
+	myExpList->evalCalls(ev);
+	std::string name = myId->getId();
+	std::vector<int> args;
+	if (!ev->pure.count(name) || !myExpList->constValues(&args)) return this;
+	FnDeclNode * fn = ev->functions[name];
+	std::string type = fn->getRetType();
+	if (type != "int" && type != "bool") return this;
+
+	ev->fuel = ev->fuelLimit;
+	ev->depth = 0;
+	int val;
+	if (!fn->evalCall(ev, args, val)){
+		if (ev->fuel < 0) ev->outOfFuel++;
+		return this;
+	}
+	ev->evaluated++;
+	if (type == "int") return new IntLitNode(val);
+	if (val) return new TrueNode();
+	return new FalseNode();
+}
+
+ExpNode * AssignNode::evalCalls(CallEvaluator * ev){
+	myExpRHS = myExpRHS->evalCalls(ev);
+	return this;
+}
+
+ExpNode * UnaryMinusNode::evalCalls(CallEvaluator * ev){
+	myExp = myExp->evalCalls(ev);
+	return this;
+}
+
+ExpNode * NotNode::evalCalls(CallEvaluator * ev){
+	myExp = myExp->evalCalls(ev);
+	return this;
+}
+
+ExpNode * PlusNode::evalCalls(CallEvaluator * ev){
+	myExp1 = myExp1->evalCalls(ev);
+	myExp2 = myExp2->evalCalls(ev);
+	return this;
+}
+
+ExpNode * MinusNode::evalCalls(CallEvaluator * ev){
+	myExp1 = myExp1->evalCalls(ev);
+	myExp2 = myExp2->evalCalls(ev);
+	return this;
+}
+
+ExpNode * TimesNode::evalCalls(CallEvaluator * ev){
+	myExp1 = myExp1->evalCalls(ev);
+	myExp2 = myExp2->evalCalls(ev);
+	return this;
+}
+
+ExpNode * DivideNode::evalCalls(CallEvaluator * ev){
+	myExp1 = myExp1->evalCalls(ev);
+	myExp2 = myExp2->evalCalls(ev);
+	return this;
+}
+
+ExpNode * AndNode::evalCalls(CallEvaluator * ev){
+	myExp1 = myExp1->evalCalls(ev);
+	myExp2 = myExp2->evalCalls(ev);
+	return this;
+}
+
+ExpNode * OrNode::evalCalls(CallEvaluator * ev){
+	myExp1 = myExp1->evalCalls(ev);
+	myExp2 = myExp2->evalCalls(ev);
+	return this;
+}
+
+ExpNode * EqualsNode::evalCalls(CallEvaluator * ev){
+	myExp1 = myExp1->evalCalls(ev);
+	myExp2 = myExp2->evalCalls(ev);
+	return this;
+}
+
+ExpNode * NotEqualsNode::evalCalls(CallEvaluator * ev){
+	myExp1 = myExp1->evalCalls(ev);
+	myExp2 = myExp2->evalCalls(ev);
+	return this;
+}
+
+ExpNode * LessNode::evalCalls(CallEvaluator * ev){
+	myExp1 = myExp1->evalCalls(ev);
+	myExp2 = myExp2->evalCalls(ev);
+	return this;
+}
+
+ExpNode * GreaterNode::evalCalls(CallEvaluator * ev){
+	myExp1 = myExp1->evalCalls(ev);
+	myExp2 = myExp2->evalCalls(ev);
+	return this;
+}
+
+ExpNode * LessEqNode::evalCalls(CallEvaluator * ev){
+	myExp1 = myExp1->evalCalls(ev);
+	myExp2 = myExp2->evalCalls(ev);
+	return this;
+}
+
+ExpNode * GreaterEqNode::evalCalls(CallEvaluator * ev){
+	myExp1 = myExp1->evalCalls(ev);
+	myExp2 = myExp2->evalCalls(ev);
+	return this;
+}
+
+// Statements
+
+/*
+* The locals a block declares start at 0 each time control enters it,
+* as the backends zero them; since a frame holds no entry for a
+* local still 0, the block's own are erased, struct fields included.
+* Nothing outside the block can see them, as the front end allows no
+* shadowing, so they need no clearing as it is left.
+*
+* The fields of name are the paths from name + "." up to name + "/":
+* '/' follows '.', and every character of an identifier sorts after
+* both, so no other variable's paths fall in between.
+*/
+void DeclListNode::enterBlock(EvalFrame * frame){
+	for (DeclNode * decl : *myDecls){
+		std::string name = decl->getId();
+		frame->erase(name);
+		frame->erase(frame->lower_bound(name + "."), frame->lower_bound(name + "/"));
+	}
+}
+
+bool StmtListNode::doesIO(){
+	for (StmtNode * stmt : *myStmts){
+		if (stmt->doesIO()) return true;
+	}
+	return false;
+}
+
+bool IfStmtNode::doesIO(){
+	return myStmts->doesIO();
+}
+
+bool IfElseStmtNode::doesIO(){
+	return myStmtsT->doesIO() || myStmtsF->doesIO();
+}
+
+bool WhileStmtNode::doesIO(){
+	return myStmts->doesIO();
+}
+
+EvalStatus StmtListNode::execute(CallEvaluator * ev, EvalFrame * frame){
+	for (StmtNode * stmt : *myStmts){
+		if (--ev->fuel < 0) return EvalStatus::Fail;
+		EvalStatus status = stmt->execute(ev, frame);
+		if (status != EvalStatus::Next) return status;
+	}
+	return EvalStatus::Next;
+}
+
+EvalStatus AssignStmtNode::execute(CallEvaluator * ev, EvalFrame * frame){
+	int val;
+	return myAssign->evaluate(ev, frame, val) ? EvalStatus::Next : EvalStatus::Fail;
+}
+
+EvalStatus PostIncStmtNode::execute(CallEvaluator * ev, EvalFrame * frame){
+	int & val = (*frame)[myExp->accessPath()];
+	val = wrap((long long)val + 1);
+	return EvalStatus::Next;
+}
+
+EvalStatus PostDecStmtNode::execute(CallEvaluator * ev, EvalFrame * frame){
+	int & val = (*frame)[myExp->accessPath()];
+	val = wrap((long long)val - 1);
+	return EvalStatus::Next;
+}
+
+EvalStatus IfStmtNode::execute(CallEvaluator * ev, EvalFrame * frame){
+	int cond;
+	if (!myExp->evaluate(ev, frame, cond)) return EvalStatus::Fail;
+	if (!cond) return EvalStatus::Next;
+	return executeBlock(ev, frame, myDecls, myStmts);
+}
+
+EvalStatus IfElseStmtNode::execute(CallEvaluator * ev, EvalFrame * frame){
+	int cond;
+	if (!myExp->evaluate(ev, frame, cond)) return EvalStatus::Fail;
+	return cond ? executeBlock(ev, frame, myDeclsT, myStmtsT)
+	  : executeBlock(ev, frame, myDeclsF, myStmtsF);
+}
+
+EvalStatus WhileStmtNode::execute(CallEvaluator * ev, EvalFrame * frame){
+	while (true){
+		int cond;
+		if (--ev->fuel < 0 || !myExp->evaluate(ev, frame, cond)) return EvalStatus::Fail;
+		if (!cond) return EvalStatus::Next;
+		EvalStatus status = executeBlock(ev, frame, myDecls, myStmts);
+		if (status != EvalStatus::Next) return status;
+	}
+}
+
+EvalStatus CallStmtNode::execute(CallEvaluator * ev, EvalFrame * frame){
+	int val;
+	return myCallExp->evaluate(ev, frame, val) ? EvalStatus::Next : EvalStatus::Fail;
+}
+
+EvalStatus ReturnStmtNode::execute(CallEvaluator * ev, EvalFrame * frame){
+	ev->result = 0;
+	if (myExp != nullptr && !myExp->evaluate(ev, frame, ev->result)) return EvalStatus::Fail;
+	return EvalStatus::Return;
+}
+
+// Expressions. Names a pure function has not assigned are locals still 0
+
+bool IdNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	EvalFrame::iterator found = frame->find(myStrVal);
+	val = found == frame->end() ? 0 : found->second;
+	return true;
+}
+
+bool DotAccessNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	EvalFrame::iterator found = frame->find(accessPath());
+	val = found == frame->end() ? 0 : found->second;
+	return true;
+}
+
+bool AssignNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	if (!myExpRHS->evaluate(ev, frame, val)) return false;
+	(*frame)[myExpLHS->accessPath()] = val;
+	return true;
+}
+
+bool ExpListNode::evaluate(CallEvaluator * ev, EvalFrame * frame, std::vector<int> * vals){
+	for (ExpNode * exp : myExps){
+		int val;
+		if (!exp->evaluate(ev, frame, val)) return false;
+		vals->push_back(val);
+	}
+	return true;
+}
+
+bool CallExpNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	std::vector<int> args;
+	if (!myExpList->evaluate(ev, frame, &args)) return false;
+	return ev->functions[myId->getId()]->evalCall(ev, args, val);
+}
+
+bool UnaryMinusNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	int v;
+	if (!myExp->evaluate(ev, frame, v)) return false;
+	val = wrap(-(long long)v);
+	return true;
+}
+
+bool NotNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	int v;
+	if (!myExp->evaluate(ev, frame, v)) return false;
+	val = !v;
+	return true;
+}
+
+bool PlusNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	int v1, v2;
+	if (!myExp1->evaluate(ev, frame, v1) || !myExp2->evaluate(ev, frame, v2)) return false;
+	val = wrap((long long)v1 + v2);
+	return true;
+}
+
+bool MinusNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	int v1, v2;
+	if (!myExp1->evaluate(ev, frame, v1) || !myExp2->evaluate(ev, frame, v2)) return false;
+	val = wrap((long long)v1 - v2);
+	return true;
+}
+
+bool TimesNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	int v1, v2;
+	if (!myExp1->evaluate(ev, frame, v1) || !myExp2->evaluate(ev, frame, v2)) return false;
+	val = wrap((long long)v1 * v2);
+	return true;
+}
+
+bool DivideNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	int v1, v2;
+	if (!myExp1->evaluate(ev, frame, v1) || !myExp2->evaluate(ev, frame, v2)) return false;
+	if (v2 == 0 || (v1 == INT_MIN && v2 == -1)) return false;
+	val = v1 / v2;
+	return true;
+}
+
+bool AndNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	int v1, v2;
+	if (!myExp1->evaluate(ev, frame, v1)) return false;
+	if (!v1){
+		val = 0;
+		return true;
+	}
+	if (!myExp2->evaluate(ev, frame, v2)) return false;
+	val = (v2 != 0);
+	return true;
+}
+
+bool OrNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	int v1, v2;
+	if (!myExp1->evaluate(ev, frame, v1)) return false;
+	if (v1){
+		val = 1;
+		return true;
+	}
+	if (!myExp2->evaluate(ev, frame, v2)) return false;
+	val = (v2 != 0);
+	return true;
+}
+
+bool EqualsNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	int v1, v2;
+	if (!myExp1->evaluate(ev, frame, v1) || !myExp2->evaluate(ev, frame, v2)) return false;
+	val = (v1 == v2);
+	return true;
+}
+
+bool NotEqualsNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	int v1, v2;
+	if (!myExp1->evaluate(ev, frame, v1) || !myExp2->evaluate(ev, frame, v2)) return false;
+	val = (v1 != v2);
+	return true;
+}
+
+bool LessNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	int v1, v2;
+	if (!myExp1->evaluate(ev, frame, v1) || !myExp2->evaluate(ev, frame, v2)) return false;
+	val = (v1 < v2);
+	return true;
+}
+
+bool GreaterNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	int v1, v2;
+	if (!myExp1->evaluate(ev, frame, v1) || !myExp2->evaluate(ev, frame, v2)) return false;
+	val = (v1 > v2);
+	return true;
+}
+
+bool LessEqNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	int v1, v2;
+	if (!myExp1->evaluate(ev, frame, v1) || !myExp2->evaluate(ev, frame, v2)) return false;
+	val = (v1 <= v2);
+	return true;
+}
+
+bool GreaterEqNode::evaluate(CallEvaluator * ev, EvalFrame * frame, int & val){
+	int v1, v2;
+	if (!myExp1->evaluate(ev, frame, v1) || !myExp2->evaluate(ev, frame, v2)) return false;
+	val = (v1 >= v2);
+	return true;
+}
+
+} // End namespace LILC
@@ -0,0 +1,233 @@
+#include "ssa.hpp"
+#include <unordered_map>
+#include <utility>
+
+namespace LILC{
+
+/*
+* Dominator-based global value numbering (Briggs, Cooper and
+* Simpson). Walking the dominator tree, every pure instruction is
+* hashed on its operator and the value numbers of its operands; an
+* instruction whose key is already in the table is computed again
+* by a dominating instruction and is removed, its uses renamed to
+* the earlier result. Entries are popped when the walk leaves the
+* subtree that can see them.
+*
+* In SSA form locals cannot change behind an expression's back, so
+* only memory needs care. Assignments to struct fields and globals
+* (Store, GStore) and calls (which may assign any global) bump a
+* version number of the slots they can write, and loads are keyed
+* on that version. A block only starts from its immediate
+* dominator's versions when that dominator is its sole predecessor;
+* otherwise every slot gets a fresh version, since a path around
+* the dominator may have stored to it. A store also records its
+* value as the result of a later load of the same slot.
+*/
+
+namespace {
+
+struct GVNKey{
+	IROp op;
+	int a;
+	int b;
+	int imm;
+	bool operator==(const GVNKey& other) const{
+		return op == other.op && a == other.a && b == other.b && imm == other.imm;
+	}
+};
+
+struct GVNKeyHash{
+	size_t operator()(const GVNKey& key) const{
+		size_t h = (size_t)key.op;
+		h = h * 31 + (size_t)key.a;
+		h = h * 31 + (size_t)key.b;
+		h = h * 31 + (size_t)key.imm;
+		return h;
+	}
+};
+
+class GVNWalker{
+public:
+	GVNWalker(IRFunction& fn, GVNStats& stats)
+	: myFn(fn), myDom(fn), myStats(stats){
+		myNumber.assign(fn.vals.size(), -1);
+		for (size_t v = 0; v < fn.vals.size(); v++){
+			myNumber[v] = v;
+		}
+		myExitSlots.assign(fn.blocks.size(), std::vector<int>());
+		myExitGlobals.assign(fn.blocks.size(), std::vector<int>());
+	}
+
+	void run(int numGlobals){
+		myNumGlobals = numGlobals;
+		walk(0);
+		std::vector<int> map(myNumber.size(), -1);
+		for (size_t v = 0; v < myNumber.size(); v++){
+			if (myNumber[v] != (int)v) map[v] = myNumber[v];
+		}
+		myFn.renameUses(map);
+	}
+private:
+	void walk(int b){
+		IRBlock & block = myFn.blocks[b];
+		std::vector<GVNKey> added;
+		std::vector<int> slotVers;
+		std::vector<int> globalVers;
+		int idom = myDom.idom(b);
+		if (idom >= 0 && block.preds.size() == 1 && block.preds[0] == idom){
+			slotVers = myExitSlots[idom];
+			globalVers = myExitGlobals[idom];
+		} else {
+			for (size_t s = 0; s < myFn.slots.size(); s++){
+				slotVers.push_back(++myVersion);
+			}
+			for (int g = 0; g < myNumGlobals; g++){
+				globalVers.push_back(++myVersion);
+			}
+		}
+
+		std::vector<IRPhi> phis;
+		for (IRPhi & phi : block.phis){
+			int same = phiDuplicate(phis, phi);
+			if (same >= 0){
+				myNumber[phi.dst] = same;
+				myStats.phis++;
+			} else {
+				phis.push_back(phi);
+			}
+		}
+		block.phis.swap(phis);
+
+		std::vector<IRInst> insts;
+		for (IRInst inst : block.insts){
+			if (inst.a >= 0) inst.a = myNumber[inst.a];
+			if (inst.b >= 0) inst.b = myNumber[inst.b];
+			switch (inst.op){
+				case IROp::Copy:
+					myNumber[inst.dst] = inst.a;
+					continue;
+				case IROp::Store:
+					slotVers[inst.imm] = ++myVersion;
+					remember(added, GVNKey{IROp::Load, inst.imm, slotVers[inst.imm], 0}, inst.a);
+					insts.push_back(inst);
+					continue;
+				case IROp::GStore:
+					globalVers[inst.imm] = ++myVersion;
+					remember(added, GVNKey{IROp::GLoad, inst.imm, globalVers[inst.imm], 0}, inst.a);
+					insts.push_back(inst);
+					continue;
+				case IROp::Call:
+					for (int & ver : globalVers) ver = ++myVersion;
+					insts.push_back(inst);
+					continue;
+				default:
+					break;
+			}
+			if (inst.dst < 0 || irHasSideEffects(inst.op)){
+				insts.push_back(inst);
+				continue;
+			}
+			GVNKey key = makeKey(inst, slotVers, globalVers);
+			std::unordered_map<GVNKey, int, GVNKeyHash>::iterator found = myTable.find(key);
+			if (found != myTable.end()){
+				myNumber[inst.dst] = found->second;
+				if (inst.op == IROp::Load || inst.op == IROp::GLoad) myStats.loads++;
+				else if (inst.op != IROp::Const) myStats.exprs++;
+				continue;
+			}
+			remember(added, key, inst.dst);
+			insts.push_back(inst);
+		}
+		block.insts.swap(insts);
+		if (block.term.val >= 0) block.term.val = myNumber[block.term.val];
+
+		myExitSlots[b] = slotVers;
+		myExitGlobals[b] = globalVers;
+		for (int child : myDom.children(b)){
+			walk(child);
+		}
+		myExitSlots[b].clear();
+		myExitGlobals[b].clear();
+		for (GVNKey & key : added){
+			myTable.erase(key);
+		}
+	}
+
+	GVNKey makeKey(const IRInst& inst, const std::vector<int>& slotVers,
+	  const std::vector<int>& globalVers){
+		GVNKey key{inst.op, inst.a, inst.b, 0};
+		switch (inst.op){
+			case IROp::Const:
+				key.imm = inst.imm;
+				break;
+			case IROp::Load:
+				key = GVNKey{IROp::Load, inst.imm, slotVers[inst.imm], 0};
+				break;
+			case IROp::GLoad:
+				key = GVNKey{IROp::GLoad, inst.imm, globalVers[inst.imm], 0};
+				break;
+			case IROp::Add:
+			case IROp::Mul:
+			case IROp::Eq:
+			case IROp::Ne:
+				if (key.a > key.b) std::swap(key.a, key.b);
+				break;
+			case IROp::Gt:
+				key = GVNKey{IROp::Lt, inst.b, inst.a, 0};
+				break;
+			case IROp::Ge:
+				key = GVNKey{IROp::Le, inst.b, inst.a, 0};
+				break;
+			default:
+				break;
+		}
+		return key;
+	}
+
+	void remember(std::vector<GVNKey>& added, const GVNKey& key, int val){
+		if (myTable.count(key)) return;
+		myTable[key] = val;
+		added.push_back(key);
+	}
+
+	/*
+	* Two phis of one block with the same value number coming in
+	* along every edge compute the same value.
+	*/
+	int phiDuplicate(std::vector<IRPhi>& kept, IRPhi& phi){
+		for (IRPhi & other : kept){
+			bool same = true;
+			for (size_t i = 0; i < phi.args.size() && same; i++){
+				int otherArg = -1;
+				for (size_t k = 0; k < other.blocks.size(); k++){
+					if (other.blocks[k] == phi.blocks[i]) otherArg = other.args[k];
+				}
+				same = otherArg >= 0
+				  && myNumber[otherArg] == myNumber[phi.args[i]];
+			}
+			if (same) return other.dst;
+		}
+		return -1;
+	}
+
+	IRFunction & myFn;
+	DomTree myDom;
+	GVNStats & myStats;
+	int myNumGlobals = 0;
+	int myVersion = 0;
+	std::vector<int> myNumber;
+	std::unordered_map<GVNKey, int, GVNKeyHash> myTable;
+	std::vector<std::vector<int>> myExitSlots;
+	std::vector<std::vector<int>> myExitGlobals;
+};
+
+} // End anonymous namespace
+
+GVNStats gvn(IRFunction& fn, int numGlobals){
+	GVNStats stats;
+	GVNWalker walker(fn, stats);
+	walker.run(numGlobals);
+	return stats;
+}
+
+} // End namespace LILC
@@ -0,0 +1,142 @@
+#include "ipo.hpp"
+
+namespace LILC{
+
+/*
+* Inlines every call in function fn that the cost model accepts,
+* including calls that came in with an inlined body. Returns the
+* number of calls inlined.
+*/
+int Inliner::inlineCalls(int fn){
+	int inlined = 0;
+	std::vector<int> work;
+	for (size_t b = 0; b < myModule.functions[fn].blocks.size(); b++){
+		work.push_back(b);
+	}
+	while (!work.empty()){
+		int b = work.back();
+		work.pop_back();
+		std::vector<IRInst> & insts = myModule.functions[fn].blocks[b].insts;
+		for (size_t i = 0; i < insts.size(); i++){
+			if (insts[i].op != IROp::Call || !decide(fn, insts[i].imm)) continue;
+			int entry = myModule.functions[fn].blocks.size();
+			int cont = inlineSite(fn, b, i);
+			for (int copied = entry; copied <= cont; copied++){
+				work.push_back(copied);
+			}
+			inlined++;
+			break;
+		}
+	}
+	return inlined;
+}
+
+bool Inliner::decide(int caller, int callee){
+	IRFunction & callerFn = myModule.functions[caller];
+	IRFunction & calleeFn = myModule.functions[callee];
+	int cost = irFunctionSize(calleeFn);
+	InlineDecision decision{callerFn.name, calleeFn.name, cost, false, ""};
+	int limit = myGraph.callersOf(callee) == 1 ? SINGLE_CALL_SITE : SMALL_FUNCTION;
+	bool hot = false;
+	bool cold = false;
+	if (myProfile != nullptr){
+		uint64_t calls;
+		hot = myProfile->callCount(callerFn.name, calleeFn.name, calls)
+		  && calls > 0 && calls * HOT_SHARE >= myTotalCalls;
+		std::map<std::string, FnProfile>::const_iterator counts = myProfile->functions.find(calleeFn.name);
+		cold = counts != myProfile->functions.end() && counts->second.entries == 0;
+	}
+	if (hot && limit < HOT_FUNCTION) limit = HOT_FUNCTION;
+	if (myGraph.isRecursive(callee) || myGraph.sccOf(caller) == myGraph.sccOf(callee)){
+		decision.reason = "recursive";
+	} else if (cold){
+		decision.reason = "callee never ran";
+	} else if (cost > limit){
+		decision.reason = "callee too large (limit " + std::to_string(limit) + ")";
+	} else if (irFunctionSize(callerFn) + cost > CALLER_LIMIT){
+		decision.reason = "caller too large";
+	} else {
+		decision.inlined = true;
+		decision.reason = hot ? "inlined, hot call site" : "inlined";
+	}
+	myDecisions.push_back(decision);
+	return decision.inlined;
+}
+
+/*
+* Inlines the call at insts[call] of the given block. The block is
+* cut after the call's arguments, which become copies into fresh
+* values standing for the callee's formals; every callee value and
+* frame slot likewise gets a fresh counterpart, so the callee's
+* locals cannot clash with the caller's. The copied blocks follow,
+* with each return turned into a copy into the call's result and a
+* jump to a new block holding the rest of the original one. Returns
+* that block, which is the last one in the function.
+*/
+int Inliner::inlineSite(int caller, int block, size_t call){
+	IRFunction & fn = myModule.functions[caller];
+	IRInst callInst = fn.blocks[block].insts[call];
+	const IRFunction & callee = myModule.functions[callInst.imm];
+
+	std::vector<int> valMap;
+	for (const IRValue & val : callee.vals){
+		std::string name = val.name.empty() ? "" : callee.name + "." + val.name;
+		valMap.push_back(fn.newValue(val.type, name));
+	}
+	int slotBase = fn.slots.size();
+	for (const IRSlot & slot : callee.slots){
+		fn.slots.push_back(IRSlot{callee.name + "." + slot.name, slot.type,
+		  slotBase + slot.first});
+	}
+	int blockBase = fn.blocks.size();
+	for (size_t b = 0; b < callee.blocks.size(); b++){
+		fn.newBlock();
+	}
+	int cont = fn.newBlock();
+
+	IRBlock & site = fn.blocks[block];
+	size_t firstArg = call - callee.numFormals;
+	fn.blocks[cont].insts.assign(site.insts.begin() + call + 1, site.insts.end());
+	fn.blocks[cont].term = site.term;
+	for (int f = 0; f < callee.numFormals; f++){
+		site.insts[firstArg + f] = IRInst{IROp::Copy, valMap[f], site.insts[firstArg + f].a, -1, 0,
+		  site.insts[firstArg + f].line};
+	}
+	site.insts.resize(firstArg + callee.numFormals);
+	site.term = IRTerm{IRTermKind::Jump, -1, {blockBase, -1}};
+
+	for (size_t b = 0; b < callee.blocks.size(); b++){
+		const IRBlock & from = callee.blocks[b];
+		IRBlock & to = fn.blocks[blockBase + b];
+		for (IRInst inst : from.insts){
+			if (inst.dst >= 0) inst.dst = valMap[inst.dst];
+			if (inst.a >= 0) inst.a = valMap[inst.a];
+			if (inst.b >= 0) inst.b = valMap[inst.b];
+			if (inst.op == IROp::Load || inst.op == IROp::Store) inst.imm += slotBase;
+			to.insts.push_back(inst);
+		}
+		to.term = from.term;
+		if (from.term.kind == IRTermKind::Return){
+			if (callInst.dst >= 0 && from.term.val >= 0){
+				to.insts.push_back(IRInst{IROp::Copy, callInst.dst, valMap[from.term.val], -1, 0,
+				  callInst.line});
+			}
+			to.term = IRTerm{IRTermKind::Jump, -1, {cont, -1}};
+			continue;
+		}
+		if (to.term.val >= 0) to.term.val = valMap[to.term.val];
+		for (int s = 0; s < from.numSuccs(); s++){
+			to.term.succ[s] += blockBase;
+		}
+	}
+	fn.computePreds();
+
+	for (const IRBlock & copied : callee.blocks){
+		for (const IRInst & inst : copied.insts){
+			if (inst.op == IROp::Call) myGraph.addCall(caller, inst.imm);
+		}
+	}
+	return cont;
+}
+
+} // End namespace LILC
@@ -0,0 +1,193 @@
+#include "ipo.hpp"
+#include "ssa.hpp"
+#include <map>
+#include <utility>
+
+namespace LILC{
+
+/*
+* Interprocedural constant propagation and function specialization.
+* Runs once over the whole module, before any function is optimized.
+*
+* An argument is a known constant when the value passed is defined
+* exactly once in the caller, by a const instruction; this is how
+* IntLitNode, TrueNode and FalseNode actuals lower. A formal that
+* receives the same constant at every call site of its function is
+* bound to that constant at the top of the function's body. Where
+* the sites disagree, sites passing the same tuple of constants are
+* grouped, and a group that is hot gets its own copy of the
+* function with those formals bound; with no profile to go on, a
+* group is hot when it has several sites or a site inside a loop.
+*
+* Specialized copies keep their formals, so that no call site has
+* to change beyond its callee; SCCP then folds the bound constants
+* through the copy's body and the branches that depend on them.
+*/
+
+namespace {
+
+struct CallSite{
+	int caller;
+	int block;
+	size_t call;
+	bool hot;
+};
+
+// The constant each argument is known to hold, if any
+typedef std::vector<std::pair<bool, int>> ArgTuple;
+
+/*
+* The constant held by each value of fn that is defined exactly
+* once, by a const instruction.
+*/
+std::vector<std::pair<bool, int>> singleConstants(const IRFunction& fn){
+	std::vector<int> defs(fn.vals.size(), 0);
+	std::vector<std::pair<bool, int>> consts(fn.vals.size(), {false, 0});
+	for (int f = 0; f < fn.numFormals; f++){
+		defs[f]++;
+	}
+	for (const IRBlock & block : fn.blocks){
+		for (const IRInst & inst : block.insts){
+			if (inst.dst < 0) continue;
+			defs[inst.dst]++;
+			if (inst.op == IROp::Const) consts[inst.dst] = {true, inst.imm};
+		}
+	}
+	for (size_t v = 0; v < fn.vals.size(); v++){
+		if (defs[v] != 1) consts[v].first = false;
+	}
+	return consts;
+}
+
+/*
+* Defines each formal with a known entry of tuple as that constant
+* on entry. Gives up if the entry block can be re-entered, where the
+* definitions would run again.
+*/
+int bindFormals(IRFunction& fn, const ArgTuple& tuple){
+	fn.computePreds();
+	if (!fn.blocks[0].preds.empty()) return 0;
+	std::vector<IRInst> binds;
+	for (int f = 0; f < fn.numFormals; f++){
+		if (tuple[f].first) binds.push_back(IRInst{IROp::Const, f, -1, -1, tuple[f].second});
+	}
+	std::vector<IRInst> & insts = fn.blocks[0].insts;
+	insts.insert(insts.begin(), binds.begin(), binds.end());
+	return binds.size();
+}
+
+std::string describe(const ArgTuple& tuple){
+	std::string text = "(";
+	for (size_t i = 0; i < tuple.size(); i++){
+		if (i > 0) text += ", ";
+		text += tuple[i].first ? std::to_string(tuple[i].second) : "_";
+	}
+	return text + ")";
+}
+
+} // End anonymous namespace
+
+int specializeCalls(IRModule& module, std::ostream * report){
+	size_t numFunctions = module.functions.size();
+	std::vector<std::vector<CallSite>> sites(numFunctions);
+	std::vector<std::vector<ArgTuple>> tuples(numFunctions);
+	for (size_t f = 0; f < numFunctions; f++){
+		IRFunction & fn = module.functions[f];
+		std::vector<std::pair<bool, int>> consts = singleConstants(fn);
+		std::vector<int> depth = loopDepths(fn);
+		for (size_t b = 0; b < fn.blocks.size(); b++){
+			std::vector<IRInst> & insts = fn.blocks[b].insts;
+			for (size_t i = 0; i < insts.size(); i++){
+				if (insts[i].op != IROp::Call) continue;
+				int callee = insts[i].imm;
+				int numArgs = module.functions[callee].numFormals;
+				ArgTuple tuple;
+				for (int a = 0; a < numArgs; a++){
+					tuple.push_back(consts[insts[i - numArgs + a].a]);
+				}
+				sites[callee].push_back(CallSite{(int)f, (int)b, i, depth[b] > 0});
+				tuples[callee].push_back(tuple);
+			}
+		}
+	}
+
+	// Calls are only retargeted here; formals are bound afterwards
+	// since that moves the instructions the call sites point at.
+	std::vector<std::pair<int, ArgTuple>> bindings;
+	int clones = 0;
+	for (size_t g = 0; g < numFunctions; g++){
+		int numFormals = module.functions[g].numFormals;
+		if (sites[g].empty() || numFormals == 0) continue;
+		std::string name = module.functions[g].name;
+
+		ArgTuple common = tuples[g][0];
+		for (ArgTuple & tuple : tuples[g]){
+			for (int f = 0; f < numFormals; f++){
+				if (!tuple[f].first || tuple[f].second != common[f].second){
+					common[f].first = false;
+				}
+			}
+		}
+		bindings.push_back({g, common});
+		if (report != nullptr){
+			for (int f = 0; f < numFormals; f++){
+				if (!common[f].first) continue;
+				*report << "ipcp " << name << ": " << module.functions[g].vals[f].name
+				  << " = " << common[f].second << " at all " << sites[g].size()
+				  << " calls" << std::endl;
+			}
+		}
+
+		std::map<ArgTuple, std::vector<int>> groups;
+		for (size_t s = 0; s < sites[g].size(); s++){
+			ArgTuple tuple = tuples[g][s];
+			bool known = false;
+			for (int f = 0; f < numFormals; f++){
+				if (common[f].first) tuple[f].first = false;
+				known = known || tuple[f].first;
+			}
+			if (known) groups[tuple].push_back(s);
+		}
+		if (groups.empty()) continue;
+		int size = irFunctionSize(module.functions[g]);
+		if ((int)groups.size() > MAX_SPECIALIZATIONS || size > SPECIALIZE_LIMIT){
+			if (report != nullptr){
+				*report << "specialize " << name << ": not cloned ("
+				  << groups.size() << " constant tuples, size " << size << ")" << std::endl;
+			}
+			continue;
+		}
+		for (std::pair<const ArgTuple, std::vector<int>> & group : groups){
+			bool hot = group.second.size() > 1;
+			for (int s : group.second){
+				hot = hot || sites[g][s].hot;
+			}
+			if (!hot) continue;
+			IRFunction clone = module.functions[g];
+			clone.name = name + ".spec" + std::to_string(++clones);
+			int index = module.functions.size();
+			ArgTuple bound = group.first;
+			for (int f = 0; f < numFormals; f++){
+				if (common[f].first) bound[f] = common[f];
+			}
+			bindings.push_back({index, bound});
+			for (int s : group.second){
+				CallSite & site = sites[g][s];
+				module.functions[site.caller].blocks[site.block].insts[site.call].imm = index;
+			}
+			if (report != nullptr){
+				*report << "specialize " << name << " as " << clone.name << " for "
+				  << describe(group.first) << ": " << group.second.size()
+				  << " calls" << std::endl;
+			}
+			module.functions.push_back(clone);
+		}
+	}
+
+	for (std::pair<int, ArgTuple> & binding : bindings){
+		bindFormals(module.functions[binding.first], binding.second);
+	}
+	return clones;
+}
+
+} // End namespace LILC
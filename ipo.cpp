@@ -0,0 +1,57 @@
+#include "ipo.hpp"
+
+namespace LILC{
+
+CallGraph buildCallGraph(IRModule& module){
+	CallGraph graph;
+	for (IRFunction & fn : module.functions){
+		graph.addFunction(fn.name);
+	}
+	for (size_t f = 0; f < module.functions.size(); f++){
+		for (IRBlock & block : module.functions[f].blocks){
+			for (IRInst & inst : block.insts){
+				if (inst.op == IROp::Call) graph.addCall(f, inst.imm);
+			}
+		}
+	}
+	return graph;
+}
+
+int irFunctionSize(const IRFunction& fn){
+	int size = 0;
+	for (const IRBlock & block : fn.blocks){
+		size += block.insts.size() + 1;
+	}
+	return size;
+}
+
+/*
+* Deletes the functions main can no longer reach, e.g. after every
+* call to them was inlined or sent to a specialized copy, and
+* renumbers the calls to the rest. Returns how many were deleted.
+*/
+int removeUnreachableFunctions(IRModule& module){
+	CallGraph graph = buildCallGraph(module);
+	int main = graph.find("main");
+	if (main < 0) return 0;
+	std::vector<char> reached = graph.reachableFrom(main);
+	std::vector<int> renumber(module.functions.size(), -1);
+	std::vector<IRFunction> kept;
+	for (size_t f = 0; f < module.functions.size(); f++){
+		if (!reached[f]) continue;
+		renumber[f] = kept.size();
+		kept.push_back(module.functions[f]);
+	}
+	int removed = module.functions.size() - kept.size();
+	for (IRFunction & fn : kept){
+		for (IRBlock & block : fn.blocks){
+			for (IRInst & inst : block.insts){
+				if (inst.op == IROp::Call) inst.imm = renumber[inst.imm];
+			}
+		}
+	}
+	module.functions.swap(kept);
+	return removed;
+}
+
+} // End namespace LILC
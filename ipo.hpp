@@ -0,0 +1,98 @@
+#ifndef LILC_IPO_HPP
+#define LILC_IPO_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ir.hpp"
+#include "callgraph.hpp"
+#include "profile.hpp"
+
+namespace LILC{
+
+/*
+* Interprocedural optimization over an IRModule. These passes work
+* on IR outside SSA form and see the whole program at once.
+*/
+
+/*
+* The call graph of a module; function i of the graph is
+* module.functions[i].
+*/
+CallGraph buildCallGraph(IRModule& module);
+
+// Instructions plus terminators: what inlining a function costs
+int irFunctionSize(const IRFunction& fn);
+
+/*
+* Removes the functions main cannot reach, such as originals whose
+* every call went to a specialized copy or was inlined, and
+* renumbers the calls to the rest. Returns how many were removed.
+*/
+int removeUnreachableFunctions(IRModule& module);
+
+/*
+* Binds formals that receive the same constant at every call, and
+* clones functions for hot call sites passing other constants; see
+* ipcp.cpp. A function is cloned only when it is at most
+* SPECIALIZE_LIMIT in size and its call sites pass at most
+* MAX_SPECIALIZATIONS distinct constant tuples. Decisions are
+* written to report unless it is null. Returns the number of clones.
+*/
+const int SPECIALIZE_LIMIT = 150;
+const int MAX_SPECIALIZATIONS = 4;
+int specializeCalls(IRModule& module, std::ostream * report);
+
+struct InlineDecision{
+	std::string caller;
+	std::string callee;
+	int cost;
+	bool inlined;
+	std::string reason;
+};
+
+/*
+* Replaces calls by a copy of the callee's body. Callers should be
+* handled callees first (in the order CallGraph::sccs gives), so
+* that a callee is inlined in its final, already optimized form.
+*
+* A call is inlined when the callee's size is at most
+* SMALL_FUNCTION, or at most SINGLE_CALL_SITE if this is the only
+* call to it in the program, and the caller stays under
+* CALLER_LIMIT. Recursive functions, and calls within one strongly
+* connected component of the call graph, are never inlined, which
+* keeps recursion from being unrolled forever.
+*
+* Given a profile, calls to functions that never ran when it was
+* taken are not inlined, and callees of at most HOT_FUNCTION are
+* when the caller's calls to them were at least 1 / HOT_SHARE of all
+* calls. Functions the profile does not cover, such as specialized
+* copies, are judged by size alone.
+*/
+class Inliner{
+public:
+	static const int SMALL_FUNCTION = 24;
+	static const int SINGLE_CALL_SITE = 120;
+	static const int HOT_FUNCTION = 96;
+	static const int HOT_SHARE = 20;
+	static const int CALLER_LIMIT = 2000;
+
+	Inliner(IRModule& module, CallGraph& graph, const Profile * profile = nullptr)
+	: myModule(module), myGraph(graph), myProfile(profile),
+	  myTotalCalls(profile == nullptr ? 0 : profile->totalCalls()) { }
+	int inlineCalls(int fn);
+	const std::vector<InlineDecision>& decisions() const { return myDecisions; }
+private:
+	bool decide(int caller, int callee);
+	int inlineSite(int caller, int block, size_t call);
+
+	IRModule & myModule;
+	CallGraph & myGraph;
+	const Profile * myProfile;
+	uint64_t myTotalCalls;
+	std::vector<InlineDecision> myDecisions;
+};
+
+} //End namespace LILC
+
+#endif
@@ -0,0 +1,578 @@
+#include "ir.hpp"
+#include <climits>
+
+namespace LILC{
+
+const char * irTypeName(IRType type){
+	switch (type){
+		case IRType::Int: return "int";
+		case IRType::Bool: return "bool";
+		case IRType::Void: return "void";
+	}
+	return "?";
+}
+
+const char * irOpName(IROp op){
+	switch (op){
+		case IROp::Const: return "const";
+		case IROp::Copy: return "copy";
+		case IROp::Neg: return "neg";
+		case IROp::Not: return "not";
+		case IROp::Add: return "add";
+		case IROp::Sub: return "sub";
+		case IROp::Mul: return "mul";
+		case IROp::Div: return "div";
+		case IROp::Shl: return "shl";
+		case IROp::Sar: return "sar";
+		case IROp::Shr: return "shr";
+		case IROp::Eq: return "eq";
+		case IROp::Ne: return "ne";
+		case IROp::Lt: return "lt";
+		case IROp::Gt: return "gt";
+		case IROp::Le: return "le";
+		case IROp::Ge: return "ge";
+		case IROp::Load: return "load";
+		case IROp::Store: return "store";
+		case IROp::GLoad: return "load";
+		case IROp::GStore: return "store";
+		case IROp::Arg: return "arg";
+		case IROp::Call: return "call";
+		case IROp::Read: return "read";
+		case IROp::Write: return "write";
+		case IROp::WriteStr: return "write";
+		case IROp::Probe: return "probe";
+	}
+	return "?";
+}
+
+/*
+* Instructions that must be kept even if their result is unused,
+* and that may not be reordered with one another.
+*/
+bool irHasSideEffects(IROp op){
+	switch (op){
+		case IROp::Store:
+		case IROp::GStore:
+		case IROp::Arg:
+		case IROp::Call:
+		case IROp::Read:
+		case IROp::Write:
+		case IROp::WriteStr:
+		case IROp::Probe:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+* Whether inst may stop the program, and so must be kept even if its
+* result is unused, and not be moved where it would run more often.
+* Only a division can, unless its divisor is a constant other than 0
+* and -1; isConst and constVal tell which values are constants.
+*/
+bool irCanTrap(const IRInst& inst, const std::vector<char>& isConst,
+  const std::vector<int>& constVal){
+	if (inst.op != IROp::Div) return false;
+	return !isConst[inst.b] || constVal[inst.b] == 0 || constVal[inst.b] == -1;
+}
+
+bool irIsTailCall(const IRFunction& fn, const IRBlock& block, size_t call){
+	const IRInst & inst = block.insts[call];
+	if (inst.op != IROp::Call || call + 1 != block.insts.size()) return false;
+	const IRTerm * term = &block.term;
+	if (term->kind == IRTermKind::Jump){
+		const IRBlock & next = fn.blocks[term->succ[0]];
+		if (!next.insts.empty() || !next.phis.empty()) return false;
+		term = &next.term;
+	}
+	return term->kind == IRTermKind::Return
+	  && (term->val == -1 || term->val == inst.dst);
+}
+
+bool irIsBinary(IROp op){
+	switch (op){
+		case IROp::Add:
+		case IROp::Sub:
+		case IROp::Mul:
+		case IROp::Div:
+		case IROp::Shl:
+		case IROp::Sar:
+		case IROp::Shr:
+		case IROp::Eq:
+		case IROp::Ne:
+		case IROp::Lt:
+		case IROp::Gt:
+		case IROp::Le:
+		case IROp::Ge:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+* Constant folding of a unary or binary operator applied to the
+* constants a (and b). Arithmetic wraps around at 32 bits; returns
+* false where the operation would trap (division by zero, or
+* INT_MIN / -1), leaving it for run time. Shift counts are taken
+* modulo 32.
+*/
+bool irFold(IROp op, int a, int b, int & result){
+	unsigned int ua = a;
+	unsigned int ub = b;
+	switch (op){
+		case IROp::Neg: result = (int)(0u - ua); return true;
+		case IROp::Not: result = !a; return true;
+		case IROp::Add: result = (int)(ua + ub); return true;
+		case IROp::Sub: result = (int)(ua - ub); return true;
+		case IROp::Mul: result = (int)(ua * ub); return true;
+		case IROp::Div:
+			if (b == 0 || (a == INT_MIN && b == -1)) return false;
+			result = a / b;
+			return true;
+		case IROp::Shl: result = (int)(ua << (ub & 31)); return true;
+		case IROp::Sar: result = a < 0 ? ~(~a >> (b & 31)) : a >> (b & 31); return true;
+		case IROp::Shr: result = (int)(ua >> (ub & 31)); return true;
+		case IROp::Eq: result = (a == b); return true;
+		case IROp::Ne: result = (a != b); return true;
+		case IROp::Lt: result = (a < b); return true;
+		case IROp::Gt: result = (a > b); return true;
+		case IROp::Le: result = (a <= b); return true;
+		case IROp::Ge: result = (a >= b); return true;
+		default: return false;
+	}
+}
+
+int IRBlock::numSuccs() const{
+	switch (term.kind){
+		case IRTermKind::Jump: return 1;
+		case IRTermKind::Branch: return 2;
+		case IRTermKind::Return: return 0;
+	}
+	return 0;
+}
+
+int IRFunction::newValue(IRType type, std::string name){
+	vals.push_back(IRValue{name, type});
+	return vals.size() - 1;
+}
+
+int IRFunction::newBlock(){
+	IRBlock block;
+	block.term = IRTerm{IRTermKind::Return, -1, {-1, -1}};
+	blocks.push_back(block);
+	return blocks.size() - 1;
+}
+
+void IRFunction::computePreds(){
+	for (IRBlock & block : blocks){
+		block.preds.clear();
+	}
+	for (size_t b = 0; b < blocks.size(); b++){
+		IRBlock & block = blocks[b];
+		for (int s = 0; s < block.numSuccs(); s++){
+			blocks[block.term.succ[s]].preds.push_back(b);
+		}
+	}
+}
+
+/*
+* Blocks reachable from the entry, each listed before its
+* successors except along back edges. The backends lay blocks out
+* close to this order (see layoutOrder), and the successor a block's
+* depth-first walk reaches last comes right after it when it was not
+* reached before; that is succ[1] of a branch unless the branch is
+* likely to go to succ[0].
+*/
+std::vector<int> IRFunction::reversePostorder(){
+	std::vector<int> order;
+	std::vector<char> seen(blocks.size(), 0);
+	std::vector<std::pair<int, int>> stack;
+	stack.push_back({0, 0});
+	seen[0] = 1;
+	while (!stack.empty()){
+		int b = stack.back().first;
+		int & next = stack.back().second;
+		if (next < blocks[b].numSuccs()){
+			const IRTerm & term = blocks[b].term;
+			int s = term.succ[term.likely == 0 ? 1 - next : next];
+			next++;
+			if (!seen[s]){
+				seen[s] = 1;
+				stack.push_back({s, 0});
+			}
+		} else {
+			order.push_back(b);
+			stack.pop_back();
+		}
+	}
+	return std::vector<int>(order.rbegin(), order.rend());
+}
+
+/*
+* The order the backends lay blocks out in: reverse postorder, with
+* the cold blocks moved after all others. A block is cold when it is
+* only reached through the unlikely arm of a branch, directly or from
+* other cold blocks; back edges are not counted, so a loop inside a
+* cold arm goes with it.
+*/
+std::vector<int> IRFunction::layoutOrder(){
+	std::vector<int> order = reversePostorder();
+	std::vector<int> position(blocks.size(), -1);
+	for (size_t i = 0; i < order.size(); i++){
+		position[order[i]] = i;
+	}
+	// Forward edges into each block, and how many of them are cold
+	std::vector<int> preds(blocks.size(), 0);
+	std::vector<int> coldPreds(blocks.size(), 0);
+	std::vector<char> cold(blocks.size(), 0);
+	bool any = false;
+	for (int b : order){
+		if (b != 0 && preds[b] > 0 && coldPreds[b] == preds[b]){
+			cold[b] = 1;
+			any = true;
+		}
+		const IRTerm & term = blocks[b].term;
+		for (int s = 0; s < blocks[b].numSuccs(); s++){
+			int succ = term.succ[s];
+			if (position[succ] <= position[b]) continue;
+			preds[succ]++;
+			bool unlikely = term.likely >= 0 && s != term.likely
+			  && term.succ[0] != term.succ[1];
+			if (cold[b] || unlikely) coldPreds[succ]++;
+		}
+	}
+	if (!any) return order;
+	std::vector<int> layout;
+	for (int b : order){
+		if (!cold[b]) layout.push_back(b);
+	}
+	for (int b : order){
+		if (cold[b]) layout.push_back(b);
+	}
+	return layout;
+}
+
+/*
+* Drops blocks that cannot be reached from the entry and renumbers
+* the rest, keeping their relative order. Phi inputs coming from
+* dropped blocks are dropped with them.
+*/
+void IRFunction::removeUnreachable(){
+	std::vector<int> order = reversePostorder();
+	std::vector<int> renumber(blocks.size(), -1);
+	std::vector<char> reachable(blocks.size(), 0);
+	for (int b : order){
+		reachable[b] = 1;
+	}
+	std::vector<IRBlock> kept;
+	for (size_t b = 0; b < blocks.size(); b++){
+		if (reachable[b]){
+			renumber[b] = kept.size();
+			kept.push_back(blocks[b]);
+		}
+	}
+	for (IRBlock & block : kept){
+		for (int s = 0; s < block.numSuccs(); s++){
+			block.term.succ[s] = renumber[block.term.succ[s]];
+		}
+		for (IRPhi & phi : block.phis){
+			size_t out = 0;
+			for (size_t i = 0; i < phi.args.size(); i++){
+				if (renumber[phi.blocks[i]] < 0) continue;
+				phi.args[out] = phi.args[i];
+				phi.blocks[out] = renumber[phi.blocks[i]];
+				out++;
+			}
+			phi.args.resize(out);
+			phi.blocks.resize(out);
+		}
+	}
+	blocks.swap(kept);
+	computePreds();
+}
+
+/*
+* Rewrites every use of value v into map[v]; entries of -1 leave
+* the use alone.
+*/
+void IRFunction::renameUses(const std::vector<int>& map){
+	auto rename = [&map](int & val){
+		if (val >= 0 && val < (int)map.size() && map[val] >= 0){
+			val = map[val];
+		}
+	};
+	for (IRBlock & block : blocks){
+		for (IRPhi & phi : block.phis){
+			for (int & arg : phi.args) rename(arg);
+		}
+		for (IRInst & inst : block.insts){
+			rename(inst.a);
+			rename(inst.b);
+		}
+		if (block.term.kind != IRTermKind::Jump){
+			rename(block.term.val);
+		}
+	}
+}
+
+/*
+* Redirects the edge block -> oldSucc to newSucc. Phis and
+* predecessor lists are left for the caller to fix up.
+*/
+void IRFunction::replaceSucc(int block, int oldSucc, int newSucc){
+	IRTerm & term = blocks[block].term;
+	for (int s = 0; s < blocks[block].numSuccs(); s++){
+		if (term.succ[s] == oldSucc) term.succ[s] = newSucc;
+	}
+}
+
+/*
+* Inserts an empty block on the edge from -> to and returns it,
+* keeping phis in to and the predecessor lists up to date.
+*/
+int IRFunction::splitEdge(int from, int to){
+	int mid = newBlock();
+	blocks[mid].term = IRTerm{IRTermKind::Jump, -1, {to, -1}};
+	replaceSucc(from, to, mid);
+	for (IRPhi & phi : blocks[to].phis){
+		for (int & pred : phi.blocks){
+			if (pred == from) pred = mid;
+		}
+	}
+	computePreds();
+	return mid;
+}
+
+/*
+* Straightens the CFG: a branch whose arms agree becomes a jump,
+* jumps through empty blocks go straight to their target, and a
+* block reached only by a jump from its sole predecessor is merged
+* into it. Returns true if anything changed.
+*/
+bool IRFunction::simplifyCFG(){
+	bool changed = false;
+	for (size_t b = 0; b < blocks.size(); b++){
+		IRTerm & term = blocks[b].term;
+		if (term.kind == IRTermKind::Branch && term.succ[0] == term.succ[1]){
+			term.kind = IRTermKind::Jump;
+			term.val = -1;
+			term.likely = -1;
+			for (IRPhi & phi : blocks[term.succ[0]].phis){
+				for (size_t i = 0; i < phi.blocks.size(); i++){
+					if (phi.blocks[i] != (int)b) continue;
+					phi.blocks.erase(phi.blocks.begin() + i);
+					phi.args.erase(phi.args.begin() + i);
+					break;
+				}
+			}
+			changed = true;
+		}
+	}
+	computePreds();
+	for (size_t b = 1; b < blocks.size(); b++){
+		IRBlock & block = blocks[b];
+		if (!block.phis.empty() || !block.insts.empty()) continue;
+		if (block.term.kind != IRTermKind::Jump) continue;
+		int target = block.term.succ[0];
+		if (target == (int)b || !blocks[target].phis.empty()) continue;
+		if (block.preds.empty()) continue;
+		std::vector<int> & targetPreds = blocks[target].preds;
+		for (size_t i = 0; i < targetPreds.size(); i++){
+			if (targetPreds[i] == (int)b){
+				targetPreds.erase(targetPreds.begin() + i);
+				break;
+			}
+		}
+		for (int pred : block.preds){
+			replaceSucc(pred, b, target);
+			targetPreds.push_back(pred);
+		}
+		block.preds.clear();
+		changed = true;
+	}
+	for (size_t b = 0; b < blocks.size(); b++){
+		while (blocks[b].term.kind == IRTermKind::Jump){
+			int next = blocks[b].term.succ[0];
+			IRBlock & succ = blocks[next];
+			if (next == (int)b || next == 0) break;
+			if (succ.preds.size() != 1 || succ.preds[0] != (int)b) break;
+			if (!succ.phis.empty()) break;
+			blocks[b].insts.insert(blocks[b].insts.end(),
+				succ.insts.begin(), succ.insts.end());
+			blocks[b].term = succ.term;
+			for (int s = 0; s < succ.numSuccs(); s++){
+				IRBlock & after = blocks[succ.term.succ[s]];
+				for (int & pred : after.preds){
+					if (pred == next) pred = b;
+				}
+				for (IRPhi & phi : after.phis){
+					for (int & pred : phi.blocks){
+						if (pred == next) pred = b;
+					}
+				}
+			}
+			succ.insts.clear();
+			succ.preds.clear();
+			succ.term = IRTerm{IRTermKind::Return, -1, {-1, -1}};
+			changed = true;
+		}
+	}
+	removeUnreachable();
+	return changed;
+}
+
+int IRModule::findFunction(const std::string& name){
+	for (size_t i = 0; i < functions.size(); i++){
+		if (functions[i].name == name) return i;
+	}
+	return -1;
+}
+
+const IRStructField * IRStructInfo::findField(const std::string& name) const{
+	for (const IRStructField & field : fields){
+		if (field.name == name) return &field;
+	}
+	return nullptr;
+}
+
+/*
+* Textual dump, meant to be stable enough to diff between runs.
+*/
+
+static void dumpValue(std::ostream& out, IRFunction& fn, int val){
+	if (fn.isTemp(val)){
+		out << "%t" << val;
+	} else {
+		out << "%" << fn.vals[val].name;
+	}
+}
+
+static void dumpInst(std::ostream& out, IRModule& module, IRFunction& fn, IRInst& inst){
+	out << "    ";
+	if (inst.dst >= 0){
+		dumpValue(out, fn, inst.dst);
+		out << " = ";
+	}
+	switch (inst.op){
+		case IROp::Const:
+			out << "const " << inst.imm;
+			break;
+		case IROp::Copy:
+			dumpValue(out, fn, inst.a);
+			break;
+		case IROp::Load:
+			out << "load [" << fn.slots[inst.imm].name << "]";
+			break;
+		case IROp::Store:
+			out << "store [" << fn.slots[inst.imm].name << "], ";
+			dumpValue(out, fn, inst.a);
+			break;
+		case IROp::GLoad:
+			out << "load @" << module.globals[inst.imm].name;
+			break;
+		case IROp::GStore:
+			out << "store @" << module.globals[inst.imm].name << ", ";
+			dumpValue(out, fn, inst.a);
+			break;
+		case IROp::Call:
+			out << "call " << module.functions[inst.imm].name;
+			break;
+		case IROp::Read:
+			out << "read";
+			break;
+		case IROp::WriteStr:
+			out << "write $" << inst.imm;
+			break;
+		case IROp::Probe:
+			out << "probe " << inst.imm;
+			break;
+		default:
+			out << irOpName(inst.op) << " ";
+			dumpValue(out, fn, inst.a);
+			if (inst.b >= 0){
+				out << ", ";
+				dumpValue(out, fn, inst.b);
+			}
+			break;
+	}
+	out << "\n";
+}
+
+static void dumpFunction(std::ostream& out, IRModule& module, IRFunction& fn){
+	out << "function " << irTypeName(fn.retType) << " " << fn.name << "(";
+	for (int i = 0; i < fn.numFormals; i++){
+		if (i > 0) out << ", ";
+		dumpValue(out, fn, i);
+		out << ":" << irTypeName(fn.vals[i].type);
+	}
+	out << ") {\n";
+	for (size_t s = 0; s < fn.slots.size(); s++){
+		out << "  slot [" << fn.slots[s].name << "] : "
+			<< irTypeName(fn.slots[s].type) << "\n";
+	}
+	for (size_t b = 0; b < fn.blocks.size(); b++){
+		IRBlock & block = fn.blocks[b];
+		out << "bb" << b << ":";
+		if (!block.preds.empty()){
+			out << "  ; preds";
+			for (int p : block.preds) out << " bb" << p;
+		}
+		out << "\n";
+		for (IRPhi & phi : block.phis){
+			out << "    ";
+			dumpValue(out, fn, phi.dst);
+			out << " = phi";
+			for (size_t i = 0; i < phi.args.size(); i++){
+				out << (i == 0 ? " [" : ", [");
+				dumpValue(out, fn, phi.args[i]);
+				out << ", bb" << phi.blocks[i] << "]";
+			}
+			out << "\n";
+		}
+		for (IRInst & inst : block.insts){
+			dumpInst(out, module, fn, inst);
+		}
+		out << "    ";
+		switch (block.term.kind){
+			case IRTermKind::Jump:
+				out << "jump bb" << block.term.succ[0];
+				break;
+			case IRTermKind::Branch:
+				out << "br ";
+				dumpValue(out, fn, block.term.val);
+				out << ", bb" << block.term.succ[0]
+					<< ", bb" << block.term.succ[1];
+				if (block.term.likely >= 0){
+					out << "  ; likely bb" << block.term.succ[block.term.likely];
+				}
+				break;
+			case IRTermKind::Return:
+				out << "ret";
+				if (block.term.val >= 0){
+					out << " ";
+					dumpValue(out, fn, block.term.val);
+				}
+				break;
+		}
+		out << "\n";
+	}
+	out << "}\n\n";
+}
+
+void IRModule::dump(std::ostream& out){
+	for (IRSlot & global : globals){
+		out << "global @" << global.name << " : "
+			<< irTypeName(global.type) << "\n";
+	}
+	for (size_t s = 0; s < strings.size(); s++){
+		out << "string $" << s << " = " << strings.literal(s) << "\n";
+	}
+	out << "\n";
+	for (IRFunction & fn : functions){
+		dumpFunction(out, *this, fn);
+	}
+}
+
+} // End namespace LILC
@@ -0,0 +1,267 @@
+#ifndef LILC_IR_HPP
+#define LILC_IR_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include "string_pool.hpp"
+
+namespace LILC{
+
+struct FnProfile;
+
+/*
+* Three-address intermediate representation. A module holds the
+* global storage, the string literals it writes, each once, and one
+* IRFunction per FnDeclNode. Each function is a control-flow graph of basic
+* blocks; a block is a contiguous array of instructions ended by a
+* single terminator naming its successors.
+*
+* Scalar locals, formals and temporaries live in numbered values
+* (virtual registers). Struct variables are flattened into scalar
+* slots, one per field, nested structs included: local structs use
+* the function's frame slots, globals (scalar or struct) use the
+* module's global slots. Field accesses therefore resolve to a fixed
+* slot number at lowering time.
+*/
+
+enum class IRType { Int, Bool, Void };
+
+enum class IROp {
+	Const,   // dst = imm
+	Copy,    // dst = a
+	Neg,     // dst = -a
+	Not,     // dst = !a
+	Add,     // dst = a + b
+	Sub,
+	Mul,
+	Div,
+	Shl,     // dst = a << b
+	Sar,     // dst = a >> b, shifting in copies of the sign bit
+	Shr,     // dst = a >> b, shifting in zeros
+	Eq,      // dst = a == b
+	Ne,
+	Lt,
+	Gt,
+	Le,
+	Ge,
+	Load,    // dst = frame slot imm
+	Store,   // frame slot imm = a
+	GLoad,   // dst = global slot imm
+	GStore,  // global slot imm = a
+	Arg,     // pass a as the next argument of the following call
+	Call,    // dst = call function imm (dst may be -1)
+	Read,    // dst = integer read from input
+	Write,   // write value a to output
+	WriteStr, // write string literal imm to output
+	Probe    // count one more for IRModule::probes[imm]
+};
+
+struct IRInst{
+	IROp op;
+	int dst;
+	int a;
+	int b;
+	int imm;
+	int line = 0; // source line of the statement it came from, 0 if unknown
+};
+
+enum class IRTermKind { Jump, Branch, Return };
+
+/*
+* Jump goes to succ[0]. Branch tests val and goes to succ[0] when it
+* is true and succ[1] otherwise. Return yields val, or nothing when
+* val is -1. A branch's likely is 0 or 1 when a profile showed it
+* usually going to that successor, which block layout then puts
+* right after it.
+*/
+struct IRTerm{
+	IRTermKind kind;
+	int val;
+	int succ[2];
+	int likely = -1;
+};
+
+/*
+* SSA phi at the top of a block: dst takes args[i] when control
+* arrives from block blocks[i].
+*/
+struct IRPhi{
+	int dst;
+	std::vector<int> args;
+	std::vector<int> blocks;
+};
+
+struct IRBlock{
+	std::vector<IRPhi> phis;
+	std::vector<IRInst> insts;
+	IRTerm term;
+	std::vector<int> preds;
+	int numSuccs() const;
+};
+
+struct IRValue{
+	std::string name; // empty for temporaries
+	IRType type;
+};
+
+struct IRSlot{
+	std::string name; // variable name plus field path, e.g. p.pos.x
+	IRType type;
+	int first = 0;    // first slot of the struct variable it belongs to
+};
+
+struct IRFunction{
+	std::string name;
+	IRType retType;
+	int numFormals;  // values 0..numFormals-1 hold the formals
+	int line = 0;    // of its FnDeclNode
+	std::vector<IRValue> vals;
+	std::vector<IRSlot> slots;
+	std::vector<IRBlock> blocks; // blocks[0] is the entry
+
+	int newValue(IRType type, std::string name = "");
+	int newBlock();
+	bool isTemp(int val) const { return vals[val].name.empty(); }
+	void computePreds();
+	std::vector<int> reversePostorder();
+	std::vector<int> layoutOrder();
+	void removeUnreachable();
+	void renameUses(const std::vector<int>& map);
+	void replaceSucc(int block, int oldSucc, int newSucc);
+	int splitEdge(int from, int to);
+	bool simplifyCFG();
+};
+
+/*
+* A counter of a profiling run: how often function fn was entered
+* (site -1), or took arm 0 or 1 of its branch site, or made the call
+* of its call site (arm 0). Sites are numbered as in profile.hpp.
+*/
+struct IRProbe{
+	std::string fn;
+	int site;
+	int arm;
+};
+
+struct IRModule{
+	std::vector<IRSlot> globals;
+	StringPool strings;
+	std::vector<IRFunction> functions;
+	std::vector<IRProbe> probes; // empty unless lowered for profiling
+
+	int findFunction(const std::string& name);
+	void dump(std::ostream& out);
+};
+
+bool irHasSideEffects(IROp op);
+bool irCanTrap(const IRInst& inst, const std::vector<char>& isConst,
+  const std::vector<int>& constVal);
+bool irIsBinary(IROp op);
+bool irFold(IROp op, int a, int b, int & result);
+const char * irOpName(IROp op);
+const char * irTypeName(IRType type);
+
+/*
+* Whether insts[call] of block is a tail call: a Call ending its
+* block, after which the function returns the call's result or
+* nothing, from the block itself or from an otherwise empty block
+* it jumps to. The backends turn these into jumps that reuse the
+* caller's frame.
+*/
+bool irIsTailCall(const IRFunction& fn, const IRBlock& block, size_t call);
+
+/*
+* Where a LIL'C location (an id or a chain of dot-accesses) lives:
+* in a value, a frame slot or a global slot. A struct-typed location
+* names the first slot of the struct and carries the struct name.
+*/
+struct IRLoc{
+	enum Kind { Value, Slot, Global } kind;
+	int index;
+	IRType type;
+	std::string structName; // empty unless the location is a struct
+};
+
+/*
+* Flattened layout of a struct type: each field's first slot
+* relative to the start of the struct.
+*/
+struct IRStructField{
+	std::string name;
+	int offset;
+	IRType type;
+	std::string structName;
+};
+
+struct IRStructInfo{
+	std::vector<IRStructField> fields;
+	int numSlots;
+	const IRStructField * findField(const std::string& name) const;
+};
+
+/*
+* State threaded through the AST while lowering it into an IRModule.
+* Names are resolved through a stack of scopes mirroring the one
+* name analysis builds; code is appended to the current block. When
+* probes is set, the code also counts its entries, branches and
+* calls for a profile.
+*/
+class IRLowering{
+public:
+	IRLowering(IRModule * module, bool probes = false)
+	: myModule(module), myProbes(probes) { }
+
+	IRModule * module() { return myModule; }
+	IRFunction * fn() { return myFn; }
+	void beginFunction(int fnIndex, const FnProfile * profile);
+	void endFunction();
+	bool probing() { return myProbes; }
+	void probe(int site, int arm);
+	void probeEntry();
+	void expect(int site, int ifTrue, int ifFalse);
+	// Instructions emitted from now on come from this source line
+	void setLine(int line) { if (line > 0) myLine = line; }
+
+	void pushScope();
+	void popScope();
+	void declareStruct(const std::string& name, IRStructInfo info);
+	const IRStructInfo * findStruct(const std::string& name);
+	void declareVar(const std::string& name, IRType type, const std::string& structName);
+	void declareFormal(const std::string& name, IRType type);
+	IRLoc lookup(const std::string& name);
+	int lookupFunction(const std::string& name);
+	int addString(const char * text, size_t length);
+
+	int current() { return myBlock; }
+	void setCurrent(int block) { myBlock = block; }
+	int newBlock() { return myFn->newBlock(); }
+	int emit(IROp op, int dst, int a = -1, int b = -1, int imm = 0);
+	int emitValue(IROp op, IRType type, int a = -1, int b = -1, int imm = 0);
+	void jump(int target);
+	void branch(int cond, int ifTrue, int ifFalse);
+	void ret(int val);
+	int pin(int val);
+	int load(const IRLoc& loc);
+	void store(const IRLoc& loc, int val);
+private:
+	void terminate(IRTermKind kind, int val, int succ0, int succ1);
+
+	IRModule * myModule;
+	bool myProbes;
+	IRFunction * myFn = nullptr;
+	const FnProfile * myProfile = nullptr;
+	int myBlock = -1;
+	int myLine = 0;
+	int myHot = -1;  // blocks the branches lowered now favor and avoid
+	int myCold = -1;
+	std::list<std::unordered_map<std::string, IRLoc>> myScopes;
+	std::unordered_map<std::string, IRStructInfo> myStructs;
+	std::unordered_map<std::string, int> myNameCounts;
+};
+
+} //End namespace LILC
+
+#endif
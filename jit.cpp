@@ -0,0 +1,735 @@
+#include "jit.hpp"
+#include "codegen.hpp"
+#include "regalloc.hpp"
+#include "sampler.hpp"
+#include "lilc_runtime.h"
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <sys/mman.h>
+
+namespace LILC{
+
+/*
+* Machine code follows the same frame layout, calling convention and
+* instruction selection as the assembly codegen.cpp writes, so the
+* two backends agree on every program; see there. What differs is
+* what code cannot name by symbol: functions are called indirectly
+* through the JIT's entry table, and globals, strings and the
+* runtime routines are reached by their absolute addresses.
+*
+* Code is built in a buffer, jumps within a function patched once
+* all its blocks are placed, and then copied into an mmap'd region
+* that is writable only while code is being copied in.
+*/
+
+namespace {
+
+// Hardware register numbers, as the instruction encoding has them
+const int HW_AX = 0;
+const int HW_CX = 1;
+const int HW_DX = 2;
+const int HW_SP = 4;
+const int HW_BP = 5;
+const int HW_SI = 6;
+const int HW_DI = 7;
+const int HW_R8 = 8;
+const int HW_R9 = 9;
+const int HW_R11 = 11;
+
+// The hardware register of each register allocateRegisters hands out
+const int HW_OF[NUM_X86_REGS] = {6, 7, 8, 9, 10, 3, 12, 13, 14, 15};
+
+const int ARG_REGS[] = {HW_DI, HW_SI, HW_DX, HW_CX, HW_R8, HW_R9};
+const int NUM_ARG_REGS = 6;
+
+const size_t REGION_SIZE = 1 << 20;
+
+// The condition codes of the jcc and setcc encodings
+enum Condition { CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF };
+
+int condition(IROp op){
+	switch (op){
+		case IROp::Eq: return CC_E;
+		case IROp::Ne: return CC_NE;
+		case IROp::Lt: return CC_L;
+		case IROp::Gt: return CC_G;
+		case IROp::Le: return CC_LE;
+		case IROp::Ge: return CC_GE;
+		default: break;
+	}
+	throw std::runtime_error("Internal Error: not a comparison");
+}
+
+bool isCompare(IROp op){
+	return op == IROp::Eq || op == IROp::Ne || op == IROp::Lt
+	  || op == IROp::Gt || op == IROp::Le || op == IROp::Ge;
+}
+
+// Conditions come in pairs differing in the low bit
+int negate(int cc){
+	return cc ^ 1;
+}
+
+struct Operand{
+	enum Kind { Reg, Mem, Imm } kind;
+	int reg;       // the register, or a memory operand's base
+	int32_t value; // a memory operand's displacement, or the immediate
+
+	bool operator==(const Operand& other) const {
+		return kind == other.kind && (kind == Imm || reg == other.reg)
+		  && (kind == Reg || value == other.value);
+	}
+	bool operator!=(const Operand& other) const { return !(*this == other); }
+};
+
+Operand reg(int r){ return Operand{Operand::Reg, r, 0}; }
+Operand mem(int base, int32_t disp){ return Operand{Operand::Mem, base, disp}; }
+Operand imm(int32_t value){ return Operand{Operand::Imm, -1, value}; }
+
+/*
+* Encodes the few instruction forms the JIT needs. Memory operands
+* are always a base register plus a 32-bit displacement, and never
+* based on %rsp or %r12, which would need a SIB byte.
+*/
+class Assembler{
+public:
+	std::vector<uint8_t> bytes;
+
+	size_t here() const { return bytes.size(); }
+
+	void byte(uint8_t b){ bytes.push_back(b); }
+
+	void imm32(int32_t value){
+		for (int i = 0; i < 4; i++){
+			byte((uint32_t)value >> (8 * i));
+		}
+	}
+
+	void imm64(uint64_t value){
+		for (int i = 0; i < 8; i++){
+			byte(value >> (8 * i));
+		}
+	}
+
+	// opcode with a ModRM byte: r in the reg field (a register or an
+	// opcode extension), rm a register or memory operand
+	void op(std::initializer_list<uint8_t> opcode, int r, const Operand& rm, bool wide = false){
+		uint8_t rex = 0x40 | (wide ? 8 : 0) | (r >= 8 ? 4 : 0) | (rm.reg >= 8 ? 1 : 0);
+		if (rex != 0x40) byte(rex);
+		for (uint8_t b : opcode){
+			byte(b);
+		}
+		if (rm.kind == Operand::Reg){
+			byte(0xC0 | (r & 7) << 3 | (rm.reg & 7));
+		} else {
+			byte(0x80 | (r & 7) << 3 | (rm.reg & 7));
+			imm32(rm.value);
+		}
+	}
+
+	void movabs(int r, uint64_t value){
+		byte(0x48 | (r >= 8 ? 1 : 0));
+		byte(0xB8 + (r & 7));
+		imm64(value);
+	}
+
+	void push(int r){
+		if (r >= 8) byte(0x41);
+		byte(0x50 + (r & 7));
+	}
+
+	void pop(int r){
+		if (r >= 8) byte(0x41);
+		byte(0x58 + (r & 7));
+	}
+
+	// A jump, conditional unless cc is -1, whose rel32 is at the result
+	size_t jump(int cc){
+		if (cc < 0){
+			byte(0xE9);
+		} else {
+			byte(0x0F);
+			byte(0x80 + cc);
+		}
+		imm32(0);
+		return here() - 4;
+	}
+
+	void patch(size_t at, size_t target){
+		int32_t rel = (int32_t)target - (int32_t)(at + 4);
+		memcpy(&bytes[at], &rel, 4);
+	}
+
+	void call(const void * routine){
+		movabs(HW_AX, (uint64_t)routine);
+		op({0xFF}, 2, reg(HW_AX));
+	}
+};
+
+enum class Arith { Add, Sub, Imul, Cmp, Xor };
+
+class FunctionCompiler{
+public:
+	FunctionCompiler(IRModule& module, int index, const RegAllocation& alloc,
+	  void * const * entries, uint8_t * globals, const std::vector<int>& globalOffsets,
+	  bool sampled)
+	: myModule(module), myFn(module.functions[index]), myAlloc(alloc),
+	  myEntries(entries), myGlobals(globals), myGlobalOffsets(globalOffsets),
+	  mySampled(sampled) {
+		myUses.assign(myFn.vals.size(), 0);
+		myConstants.assign(myFn.vals.size(), 0);
+		for (IRBlock & block : myFn.blocks){
+			for (IRInst & inst : block.insts){
+				if (inst.a >= 0) myUses[inst.a]++;
+				if (inst.b >= 0) myUses[inst.b]++;
+				if (inst.op == IROp::Const) myConstants[inst.dst] = inst.imm;
+			}
+			if (block.term.val >= 0) myUses[block.term.val]++;
+		}
+		mySlots = layoutSlots(myFn.slots, 0, myFn.slots.size());
+		mySpillBase = -8 * (int)alloc.calleeSaved.size();
+		mySlotBase = mySpillBase - 4 * alloc.numSpillSlots - mySlots.size;
+		myFrameSize = (-mySlotBase + 15) / 16 * 16;
+	}
+
+	std::vector<uint8_t> compile(){
+		markLine(myFn.line);
+		myAsm.push(HW_BP);
+		myAsm.op({0x89}, HW_SP, reg(HW_BP), true);
+		if (myFrameSize > 0){
+			myAsm.op({0x81}, 5, reg(HW_SP), true);
+			myAsm.imm32(myFrameSize);
+		}
+		for (size_t r = 0; r < myAlloc.calleeSaved.size(); r++){
+			myAsm.op({0x89}, HW_OF[myAlloc.calleeSaved[r]], mem(HW_BP, -8 * (int)(r + 1)), true);
+		}
+		std::vector<std::pair<Operand, Operand>> formals;
+		for (int i = 0; i < myFn.numFormals; i++){
+			if (!occurs(i)) continue;
+			if (i < NUM_ARG_REGS){
+				formals.push_back({value(i), reg(ARG_REGS[i])});
+			} else {
+				formals.push_back({value(i), incomingArg(i)});
+			}
+		}
+		parallelMove(formals);
+
+		std::vector<size_t> blockStart(myFn.blocks.size(), 0);
+		const std::vector<int> & order = myAlloc.order;
+		for (size_t k = 0; k < order.size(); k++){
+			blockStart[order[k]] = myAsm.here();
+			compileBlock(order[k], k + 1 < order.size() ? order[k + 1] : -1);
+		}
+
+		size_t ret = myAsm.here();
+		leave();
+		myAsm.byte(0xC3); // ret
+		size_t divZero = myAsm.here();
+		if (!myDivZeroJumps.empty()) myAsm.call((const void *)&lilc_rt_div_zero);
+
+		for (std::pair<size_t, int> & jump : myBlockJumps){
+			myAsm.patch(jump.first, blockStart[jump.second]);
+		}
+		for (size_t at : myRetJumps){
+			myAsm.patch(at, ret);
+		}
+		for (size_t at : myDivZeroJumps){
+			myAsm.patch(at, divZero);
+		}
+		return myAsm.bytes;
+	}
+
+	// The offsets at which code for another source line starts
+	const std::vector<std::pair<size_t, int>>& lines() const { return myLines; }
+private:
+	// Code from here on is for line; instructions passes made have none
+	void markLine(int line){
+		if (line > 0 && (myLines.empty() || myLines.back().second != line)){
+			myLines.push_back({myAsm.here(), line});
+		}
+	}
+
+	// Restores the callee-saved registers and pops the frame
+	void leave(){
+		for (size_t r = 0; r < myAlloc.calleeSaved.size(); r++){
+			myAsm.op({0x8B}, HW_OF[myAlloc.calleeSaved[r]], mem(HW_BP, -8 * (int)(r + 1)), true);
+		}
+		myAsm.byte(0xC9); // leave
+	}
+
+	// Where the callee of a call finds argument i
+	Operand incomingArg(int i){
+		return mem(HW_BP, 16 + 8 * (i - NUM_ARG_REGS));
+	}
+
+	bool occurs(int val){
+		return myAlloc.reg[val] >= 0 || myAlloc.spillSlot[val] >= 0
+		  || myAlloc.rematerialized[val];
+	}
+
+	Operand value(int val){
+		if (myAlloc.reg[val] >= 0) return reg(HW_OF[myAlloc.reg[val]]);
+		if (myAlloc.rematerialized[val]) return imm(myConstants[val]);
+		return mem(HW_BP, mySpillBase - 4 * (myAlloc.spillSlot[val] + 1));
+	}
+
+	void jumpTo(int cc, int block){
+		myBlockJumps.push_back({myAsm.jump(cc), block});
+	}
+
+	// r = src
+	void load(int r, const Operand& src){
+		if (src.kind == Operand::Imm){
+			if (r >= 8) myAsm.byte(0x41);
+			myAsm.byte(0xB8 + (r & 7));
+			myAsm.imm32(src.value);
+		} else if (src != reg(r)){
+			myAsm.op({0x8B}, r, src);
+		}
+	}
+
+	// A move between any two operands, through %r11d if both are memory
+	void move(const Operand& to, const Operand& from){
+		if (to == from) return;
+		if (to.kind == Operand::Reg){
+			load(to.reg, from);
+		} else if (from.kind == Operand::Reg){
+			myAsm.op({0x89}, from.reg, to);
+		} else if (from.kind == Operand::Imm){
+			myAsm.op({0xC7}, 0, to);
+			myAsm.imm32(from.value);
+		} else {
+			load(HW_R11, from);
+			myAsm.op({0x89}, HW_R11, to);
+		}
+	}
+
+	// As in codegen.cpp: cycles are broken through %eax
+	void parallelMove(std::vector<std::pair<Operand, Operand>> moves){
+		while (!moves.empty()){
+			bool progress = false;
+			for (size_t i = 0; i < moves.size(); i++){
+				bool read = false;
+				for (size_t j = 0; j < moves.size(); j++){
+					if (j != i && moves[j].second == moves[i].first) read = true;
+				}
+				if (read) continue;
+				move(moves[i].first, moves[i].second);
+				moves.erase(moves.begin() + i);
+				progress = true;
+				break;
+			}
+			if (progress) continue;
+			Operand parked = moves[0].first;
+			load(HW_AX, parked);
+			for (std::pair<Operand, Operand> & other : moves){
+				if (other.second == parked) other.second = reg(HW_AX);
+			}
+		}
+	}
+
+	// r = r op src, or a comparison of r with src
+	void arith(Arith kind, int r, const Operand& src){
+		if (src.kind == Operand::Imm){
+			if (kind == Arith::Imul){
+				myAsm.op({0x69}, r, reg(r));
+			} else {
+				int ext = kind == Arith::Add ? 0 : kind == Arith::Sub ? 5
+				  : kind == Arith::Cmp ? 7 : 6;
+				myAsm.op({0x81}, ext, reg(r));
+			}
+			myAsm.imm32(src.value);
+			return;
+		}
+		switch (kind){
+			case Arith::Add: myAsm.op({0x03}, r, src); return;
+			case Arith::Sub: myAsm.op({0x2B}, r, src); return;
+			case Arith::Imul: myAsm.op({0x0F, 0xAF}, r, src); return;
+			case Arith::Cmp: myAsm.op({0x3B}, r, src); return;
+			case Arith::Xor: myAsm.op({0x33}, r, src); return;
+		}
+	}
+
+	// %eax = the condition cc, as 0 or 1, after a comparison
+	void setFlag(int cc){
+		myAsm.op({0x0F, (uint8_t)(0x90 + cc)}, 0, reg(HW_AX));
+	}
+
+	void compileBlock(int b, int next){
+		IRBlock & block = myFn.blocks[b];
+		size_t numInsts = block.insts.size();
+		bool fuse = false;
+		if (block.term.kind == IRTermKind::Branch && numInsts > 0){
+			IRInst & last = block.insts.back();
+			fuse = isCompare(last.op) && last.dst == block.term.val && myUses[last.dst] == 1;
+		}
+		bool tail = numInsts > 0 && irIsTailCall(myFn, block, numInsts - 1)
+		  && fitsTailJump(myFn, myModule.functions[block.insts.back().imm]);
+		for (size_t i = 0; i < numInsts; i++){
+			markLine(block.insts[i].line);
+			if (fuse && i + 1 == numInsts) break;
+			if (tail && i + 1 == numInsts){
+				compileTailCall(block.insts[i]);
+				return;
+			}
+			compileInst(block.insts[i]);
+		}
+
+		IRTerm & term = block.term;
+		switch (term.kind){
+			case IRTermKind::Return:
+				if (term.val >= 0) load(HW_AX, value(term.val));
+				if (next != -1) myRetJumps.push_back(myAsm.jump(-1));
+				return;
+			case IRTermKind::Jump:
+				if (term.succ[0] != next) jumpTo(-1, term.succ[0]);
+				return;
+			case IRTermKind::Branch:
+				break;
+		}
+
+		int ifTrue = term.succ[0];
+		int ifFalse = term.succ[1];
+		bool invert = ifTrue == next;
+		int target = invert ? ifFalse : ifTrue;
+		int cc = CC_NE;
+		if (fuse){
+			IRInst & cmp = block.insts.back();
+			Operand a = value(cmp.a);
+			if (a.kind != Operand::Reg){
+				load(HW_AX, a);
+				a = reg(HW_AX);
+			}
+			arith(Arith::Cmp, a.reg, value(cmp.b));
+			cc = condition(cmp.op);
+		} else {
+			Operand val = value(term.val);
+			if (val.kind != Operand::Reg){
+				load(HW_AX, val);
+				val = reg(HW_AX);
+			}
+			myAsm.op({0x85}, val.reg, val); // test
+		}
+		if (invert) cc = negate(cc);
+		jumpTo(cc, target);
+		if (!invert && ifFalse != next) jumpTo(-1, ifFalse);
+	}
+
+	void compileInst(const IRInst& inst){
+		switch (inst.op){
+			case IROp::Const:
+				if (value(inst.dst).kind != Operand::Imm) move(value(inst.dst), imm(inst.imm));
+				return;
+			case IROp::Copy:
+				move(value(inst.dst), value(inst.a));
+				return;
+			case IROp::Neg:
+				load(HW_AX, value(inst.a));
+				myAsm.op({0xF7}, 3, reg(HW_AX));
+				move(value(inst.dst), reg(HW_AX));
+				return;
+			case IROp::Not:
+				load(HW_CX, value(inst.a));
+				myAsm.op({0x33}, HW_AX, reg(HW_AX));
+				myAsm.op({0x85}, HW_CX, reg(HW_CX));
+				setFlag(CC_E);
+				move(value(inst.dst), reg(HW_AX));
+				return;
+			case IROp::Add:
+			case IROp::Sub:
+			case IROp::Mul: {
+				Arith kind = inst.op == IROp::Add ? Arith::Add
+				  : inst.op == IROp::Sub ? Arith::Sub : Arith::Imul;
+				Operand dst = value(inst.dst);
+				if (dst.kind != Operand::Reg || dst == value(inst.b)) dst = reg(HW_AX);
+				load(dst.reg, value(inst.a));
+				arith(kind, dst.reg, value(inst.b));
+				move(value(inst.dst), dst);
+				return;
+			}
+			case IROp::Div: {
+				load(HW_CX, value(inst.b));
+				myAsm.op({0x85}, HW_CX, reg(HW_CX));
+				myDivZeroJumps.push_back(myAsm.jump(CC_E));
+				load(HW_AX, value(inst.a));
+				arith(Arith::Cmp, HW_CX, imm(-1));
+				size_t divide = myAsm.jump(CC_NE);
+				myAsm.op({0xF7}, 3, reg(HW_AX)); // neg
+				size_t done = myAsm.jump(-1);
+				myAsm.patch(divide, myAsm.here());
+				myAsm.byte(0x99); // cltd
+				myAsm.op({0xF7}, 7, reg(HW_CX)); // idiv
+				myAsm.patch(done, myAsm.here());
+				move(value(inst.dst), reg(HW_AX));
+				return;
+			}
+			case IROp::Shl:
+			case IROp::Sar:
+			case IROp::Shr: {
+				int ext = inst.op == IROp::Shl ? 4 : inst.op == IROp::Sar ? 7 : 5;
+				load(HW_CX, value(inst.b));
+				load(HW_AX, value(inst.a));
+				myAsm.op({0xD3}, ext, reg(HW_AX));
+				move(value(inst.dst), reg(HW_AX));
+				return;
+			}
+			case IROp::Eq:
+			case IROp::Ne:
+			case IROp::Lt:
+			case IROp::Gt:
+			case IROp::Le:
+			case IROp::Ge:
+				load(HW_CX, value(inst.a));
+				myAsm.op({0x33}, HW_AX, reg(HW_AX));
+				arith(Arith::Cmp, HW_CX, value(inst.b));
+				setFlag(condition(inst.op));
+				move(value(inst.dst), reg(HW_AX));
+				return;
+			case IROp::Load: {
+				Operand from = mem(HW_BP, mySlotBase + mySlots.offsets[inst.imm]);
+				loadTyped(myFn.slots[inst.imm].type, from);
+				move(value(inst.dst), reg(HW_AX));
+				return;
+			}
+			case IROp::Store: {
+				load(HW_AX, value(inst.a));
+				storeTyped(myFn.slots[inst.imm].type, mem(HW_BP, mySlotBase + mySlots.offsets[inst.imm]));
+				return;
+			}
+			case IROp::GLoad:
+				myAsm.movabs(HW_R11, (uint64_t)(myGlobals + myGlobalOffsets[inst.imm]));
+				loadTyped(myModule.globals[inst.imm].type, mem(HW_R11, 0));
+				move(value(inst.dst), reg(HW_AX));
+				return;
+			case IROp::GStore:
+				load(HW_AX, value(inst.a));
+				myAsm.movabs(HW_R11, (uint64_t)(myGlobals + myGlobalOffsets[inst.imm]));
+				storeTyped(myModule.globals[inst.imm].type, mem(HW_R11, 0));
+				return;
+			case IROp::Arg:
+				myArgs.push_back(inst.a);
+				return;
+			case IROp::Call:
+				compileCall(inst);
+				return;
+			case IROp::Read:
+				callRuntime((const void *)&lilc_rt_read_int);
+				move(value(inst.dst), reg(HW_AX));
+				return;
+			case IROp::Write:
+				load(HW_DI, value(inst.a));
+				callRuntime((const void *)&lilc_rt_write_int);
+				return;
+			case IROp::WriteStr:
+				myAsm.movabs(HW_DI, (uint64_t)myModule.strings.text(inst.imm));
+				callRuntime((const void *)&lilc_rt_write_str);
+				return;
+			case IROp::Probe: // only the VM takes profiles
+				return;
+		}
+	}
+
+	/*
+	* Calls an input or output routine. In a sampled run the stack
+	* and frame pointers are first left in Sampler::callOut, since
+	* the routine and the C library under it need not keep the
+	* frame-pointer chain the signal handler walks.
+	*/
+	void callRuntime(const void * routine){
+		if (mySampled){
+			myAsm.movabs(HW_R11, (uint64_t)Sampler::callOut);
+			myAsm.op({0x89}, HW_SP, mem(HW_R11, 0), true);
+			myAsm.op({0x89}, HW_BP, mem(HW_R11, 8), true);
+		}
+		myAsm.call(routine);
+		if (mySampled){
+			myAsm.movabs(HW_R11, (uint64_t)Sampler::callOut);
+			myAsm.op({0xC7}, 0, mem(HW_R11, 0), true);
+			myAsm.imm32(0);
+		}
+	}
+
+	// %eax = the slot at from; bools take a byte
+	void loadTyped(IRType type, const Operand& from){
+		if (type == IRType::Bool){
+			myAsm.op({0x0F, 0xB6}, HW_AX, from); // movzbl
+		} else {
+			myAsm.op({0x8B}, HW_AX, from);
+		}
+	}
+
+	void storeTyped(IRType type, const Operand& to){
+		myAsm.op({(uint8_t)(type == IRType::Bool ? 0x88 : 0x89)}, HW_AX, to);
+	}
+
+	void compileCall(const IRInst& call){
+		int numStack = (int)myArgs.size() - NUM_ARG_REGS;
+		int popped = 0;
+		if (numStack > 0){
+			if (numStack % 2 == 1){
+				myAsm.op({0x81}, 5, reg(HW_SP), true);
+				myAsm.imm32(8);
+				popped += 8;
+			}
+			for (int i = myArgs.size() - 1; i >= NUM_ARG_REGS; i--){
+				load(HW_AX, value(myArgs[i]));
+				myAsm.push(HW_AX);
+				popped += 8;
+			}
+		}
+		std::vector<std::pair<Operand, Operand>> moves;
+		for (int i = 0; i < (int)myArgs.size() && i < NUM_ARG_REGS; i++){
+			moves.push_back({reg(ARG_REGS[i]), value(myArgs[i])});
+		}
+		parallelMove(moves);
+		myArgs.clear();
+		myAsm.movabs(HW_AX, (uint64_t)&myEntries[call.imm]);
+		myAsm.op({0xFF}, 2, mem(HW_AX, 0));
+		if (popped > 0){
+			myAsm.op({0x81}, 0, reg(HW_SP), true);
+			myAsm.imm32(popped);
+		}
+		if (call.dst >= 0) move(value(call.dst), reg(HW_AX));
+	}
+
+	void compileTailCall(const IRInst& call){
+		std::vector<std::pair<Operand, Operand>> moves;
+		for (int i = 0; i < (int)myArgs.size(); i++){
+			moves.push_back({i < NUM_ARG_REGS ? reg(ARG_REGS[i]) : incomingArg(i), value(myArgs[i])});
+		}
+		parallelMove(moves);
+		myArgs.clear();
+		leave();
+		myAsm.movabs(HW_AX, (uint64_t)&myEntries[call.imm]);
+		myAsm.op({0xFF}, 4, mem(HW_AX, 0)); // jmp *(%rax)
+	}
+
+	IRModule & myModule;
+	IRFunction & myFn;
+	const RegAllocation & myAlloc;
+	void * const * myEntries;
+	uint8_t * myGlobals;
+	const std::vector<int> & myGlobalOffsets;
+	bool mySampled;
+	std::vector<int> myUses;
+	std::vector<int> myConstants;
+	SlotLayout mySlots;
+	int mySpillBase;
+	int mySlotBase;
+	int myFrameSize;
+	Assembler myAsm;
+	std::vector<int> myArgs;
+	std::vector<std::pair<size_t, int>> myBlockJumps; // (rel32, block)
+	std::vector<size_t> myRetJumps;
+	std::vector<size_t> myDivZeroJumps;
+	std::vector<std::pair<size_t, int>> myLines;
+};
+
+} // End anonymous namespace
+
+JIT::JIT(IRModule& module, bool sampled) : myModule(module), mySampled(sampled) {
+	SlotLayout layout = layoutSlots(module.globals, 0, module.globals.size());
+	myGlobals.assign(layout.size, 0);
+	myGlobalOffsets = layout.offsets;
+	myEntries.resize(module.functions.size());
+	for (size_t f = 0; f < module.functions.size(); f++){
+		myEntries[f] = install(stub(f));
+	}
+}
+
+JIT::~JIT(){
+	for (Region & region : myRegions){
+		munmap(region.base, region.size);
+	}
+}
+
+void JIT::run(){
+	int main = myModule.findFunction("main");
+	if (main < 0) throw std::runtime_error("Runtime Error: no main function");
+	void (*entry)() = (void (*)())myEntries[main];
+	entry();
+	lilc_rt_flush();
+}
+
+/*
+* The stub a function's entry points to until it is first called:
+* it saves the argument registers, asks the JIT for the function's
+* code, restores them and jumps there, so the call proceeds as if
+* it had gone to the code directly. Later calls find the code in
+* the entry table.
+*/
+std::vector<uint8_t> JIT::stub(int fn){
+	Assembler code;
+	for (int r : ARG_REGS){
+		code.push(r);
+	}
+	code.op({0x81}, 5, reg(HW_SP), true); // realign %rsp for the call
+	code.imm32(8);
+	code.movabs(HW_DI, (uint64_t)this);
+	code.byte(0xBE); // mov $fn, %esi
+	code.imm32(fn);
+	code.call((const void *)&JIT::compileOnCall);
+	code.op({0x81}, 0, reg(HW_SP), true);
+	code.imm32(8);
+	for (int i = NUM_ARG_REGS - 1; i >= 0; i--){
+		code.pop(ARG_REGS[i]);
+	}
+	code.op({0xFF}, 4, reg(HW_AX)); // jmp *%rax
+	return code.bytes;
+}
+
+void * JIT::compileOnCall(JIT * jit, int fn){
+	return jit->compile(fn);
+}
+
+void * JIT::compile(int fn){
+	RegAllocation alloc = allocateRegisters(myModule.functions[fn]);
+	FunctionCompiler compiler(myModule, fn, alloc, myEntries.data(),
+	  myGlobals.data(), myGlobalOffsets, mySampled);
+	std::vector<uint8_t> code = compiler.compile();
+	myEntries[fn] = install(code);
+	myMaps.push_back(CodeMap{(uintptr_t)myEntries[fn], code.size(), fn, compiler.lines()});
+	myCompiled++;
+	myCodeBytes += code.size();
+	return myEntries[fn];
+}
+
+bool JIT::locate(uintptr_t address, int & fn, int & line) const{
+	for (const CodeMap & map : myMaps){
+		if (address < map.start || address >= map.start + map.size) continue;
+		size_t offset = address - map.start;
+		fn = map.fn;
+		line = 0;
+		for (const std::pair<size_t, int> & mark : map.lines){
+			if (mark.first > offset) break;
+			line = mark.second;
+		}
+		return true;
+	}
+	return false;
+}
+
+/*
+* Copies code into executable memory, 16-byte aligned, mapping a
+* new region when the current one is full.
+*/
+void * JIT::install(const std::vector<uint8_t>& code){
+	if (myRegions.empty() || myRegions.back().used + code.size() > myRegions.back().size){
+		size_t size = std::max(REGION_SIZE, code.size());
+		void * base = mmap(nullptr, size, PROT_READ | PROT_EXEC,
+		  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (base == MAP_FAILED) throw std::runtime_error("Internal Error: cannot map code memory");
+		myRegions.push_back(Region{(uint8_t *)base, size, 0});
+	}
+	Region & region = myRegions.back();
+	uint8_t * at = region.base + region.used;
+	mprotect(region.base, region.size, PROT_READ | PROT_WRITE);
+	memcpy(at, code.data(), code.size());
+	mprotect(region.base, region.size, PROT_READ | PROT_EXEC);
+	region.used = (region.used + code.size() + 15) / 16 * 16;
+	return at;
+}
+
+} // End namespace LILC
@@ -0,0 +1,68 @@
+#ifndef LILC_JIT_HPP
+#define LILC_JIT_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ir.hpp"
+
+namespace LILC{
+
+/*
+* Runs a module in process by translating its functions, out of SSA
+* form, straight into x86-64 machine code in mmap'd pages; the
+* encoding follows the assembly codegen.cpp writes, registers
+* allocated the same way. A function is compiled the first time it
+* is called: until then its entry is a stub that calls back into
+* the JIT, installs the function and jumps to it. Every call goes
+* through the entry table, so only functions that run get compiled.
+*/
+class JIT{
+public:
+	// sampled compiles code a Sampler can follow into the runtime
+	JIT(IRModule& module, bool sampled = false);
+	~JIT();
+	// Compiles and calls main; output goes to stdout
+	void run();
+	/*
+	* Sets fn and line to the function and source line that address,
+	* in code compiled so far, belongs to. Returns false for addresses
+	* outside it, stubs included.
+	*/
+	bool locate(uintptr_t address, int & fn, int & line) const;
+	int functionsCompiled() const { return myCompiled; }
+	size_t codeBytes() const { return myCodeBytes; }
+private:
+	static void * compileOnCall(JIT * jit, int fn);
+	void * compile(int fn);
+	std::vector<uint8_t> stub(int fn);
+	void * install(const std::vector<uint8_t>& code);
+
+	struct Region{
+		uint8_t * base;
+		size_t size;
+		size_t used;
+	};
+
+	// Where a compiled function is, and the offsets its source lines start at
+	struct CodeMap{
+		uintptr_t start;
+		size_t size;
+		int fn;
+		std::vector<std::pair<size_t, int>> lines;
+	};
+
+	IRModule & myModule;
+	std::vector<void *> myEntries;     // per function, called through
+	std::vector<uint8_t> myGlobals;
+	std::vector<int> myGlobalOffsets;  // per global slot
+	std::vector<Region> myRegions;
+	std::vector<CodeMap> myMaps;
+	bool mySampled;
+	int myCompiled = 0;
+	size_t myCodeBytes = 0;
+};
+
+} //End namespace LILC
+
+#endif
@@ -0,0 +1,221 @@
+#include "ssa.hpp"
+#include <algorithm>
+
+namespace LILC{
+
+/*
+* Loop-invariant code motion over SSA form. Every while loop
+* lowers to a natural loop: a header that dominates the source of
+* an edge back into it, plus the blocks that reach that source
+* without passing through the header. Each loop gets a preheader,
+* a block on the only edge entering the header from outside, and
+* instructions computing the same value on every iteration are
+* moved there.
+*
+* An instruction is invariant when each operand is defined outside
+* the loop or by an instruction already hoisted. Locals (struct
+* fields included, once promoted) are SSA values, so a local that
+* the loop assigns is simply defined inside it. Loads need the
+* memory they read to be left alone: a frame slot must not be
+* stored to anywhere in the loop, and a global must neither be
+* stored to nor be reachable by a call made in the loop. Since the
+* hoisted code also runs when the loop body does not, only
+* instructions that cannot trap are moved; a division only when its
+* divisor is a constant other than 0 and -1.
+*
+* Loops are handled innermost first, so code hoisted out of an
+* inner loop can leave an enclosing one in turn.
+*/
+
+std::vector<Loop> findLoops(IRFunction& fn, const DomTree& dom){
+	std::vector<Loop> loops;
+	std::vector<int> loopOf(fn.blocks.size(), -1);
+	for (int b : dom.rpo()){
+		IRBlock & block = fn.blocks[b];
+		for (int s = 0; s < block.numSuccs(); s++){
+			int header = block.term.succ[s];
+			if (!dom.dominates(header, b)) continue;
+			if (loopOf[header] < 0){
+				loopOf[header] = loops.size();
+				Loop loop{header, std::vector<char>(fn.blocks.size(), 0), 1};
+				loop.body[header] = 1;
+				loops.push_back(loop);
+			}
+			Loop & loop = loops[loopOf[header]];
+			std::vector<int> work;
+			if (!loop.body[b]){
+				loop.body[b] = 1;
+				loop.size++;
+				work.push_back(b);
+			}
+			while (!work.empty()){
+				int w = work.back();
+				work.pop_back();
+				for (int pred : fn.blocks[w].preds){
+					if (loop.body[pred] || (dom.idom(pred) < 0 && pred != 0)) continue;
+					loop.body[pred] = 1;
+					loop.size++;
+					work.push_back(pred);
+				}
+			}
+		}
+	}
+	std::stable_sort(loops.begin(), loops.end(),
+	  [](const Loop& x, const Loop& y){ return x.size < y.size; });
+	return loops;
+}
+
+namespace {
+
+/*
+* Returns the block through which all entries into loop's header
+* from outside the loop pass, creating it if needed. Header phis
+* with several outside arguments get a phi in the new block merging
+* them.
+*/
+int makePreheader(IRFunction& fn, Loop& loop){
+	int header = loop.header;
+	std::vector<int> outside;
+	for (int pred : fn.blocks[header].preds){
+		if (!loop.body[pred]) outside.push_back(pred);
+	}
+	if (outside.size() == 1 && fn.blocks[outside[0]].numSuccs() == 1){
+		return outside[0];
+	}
+	int pre = fn.newBlock();
+	fn.blocks[pre].term = IRTerm{IRTermKind::Jump, -1, {header, -1}};
+	for (int pred : outside){
+		fn.replaceSucc(pred, header, pre);
+	}
+	for (IRPhi & phi : fn.blocks[header].phis){
+		IRPhi merged{-1, {}, {}};
+		IRPhi kept{phi.dst, {}, {}};
+		for (size_t i = 0; i < phi.args.size(); i++){
+			if (loop.body[phi.blocks[i]]){
+				kept.args.push_back(phi.args[i]);
+				kept.blocks.push_back(phi.blocks[i]);
+			} else {
+				merged.args.push_back(phi.args[i]);
+				merged.blocks.push_back(phi.blocks[i]);
+			}
+		}
+		int entering = merged.args.empty() ? -1 : merged.args[0];
+		if (merged.args.size() > 1){
+			entering = fn.newValue(fn.vals[phi.dst].type);
+			merged.dst = entering;
+			fn.blocks[pre].phis.push_back(merged);
+		}
+		if (entering >= 0){
+			kept.args.push_back(entering);
+			kept.blocks.push_back(pre);
+		}
+		phi = kept;
+	}
+	fn.computePreds();
+	return pre;
+}
+
+} // End anonymous namespace
+
+std::vector<int> loopDepths(IRFunction& fn){
+	DomTree dom(fn);
+	std::vector<Loop> loops = findLoops(fn, dom);
+	std::vector<int> depth(fn.blocks.size(), 0);
+	for (Loop & loop : loops){
+		for (size_t b = 0; b < fn.blocks.size(); b++){
+			if (loop.body[b]) depth[b]++;
+		}
+	}
+	return depth;
+}
+
+LICMStats licm(IRFunction& fn){
+	LICMStats stats;
+	DomTree dom(fn);
+	std::vector<Loop> loops = findLoops(fn, dom);
+	stats.loops = loops.size();
+
+	for (size_t l = 0; l < loops.size(); l++){
+		Loop & loop = loops[l];
+		if (loop.header == 0) continue;
+		size_t oldSize = fn.blocks.size();
+		int pre = makePreheader(fn, loop);
+		if (fn.blocks.size() != oldSize){
+			for (Loop & other : loops){
+				other.body.resize(fn.blocks.size(), 0);
+			}
+			for (size_t o = l + 1; o < loops.size(); o++){
+				if (loops[o].body[loop.header]) loops[o].body[pre] = 1;
+			}
+		}
+
+		std::vector<char> storedSlots(fn.slots.size(), 0);
+		std::vector<char> storedGlobals;
+		bool calls = false;
+		std::vector<char> inLoop(fn.vals.size(), 0);
+		std::vector<char> isConst(fn.vals.size(), 0);
+		std::vector<int> constVal(fn.vals.size(), 0);
+		for (size_t b = 0; b < fn.blocks.size(); b++){
+			for (IRInst & inst : fn.blocks[b].insts){
+				if (inst.op != IROp::Const) continue;
+				isConst[inst.dst] = 1;
+				constVal[inst.dst] = inst.imm;
+			}
+			if (!loop.body[b]) continue;
+			for (IRPhi & phi : fn.blocks[b].phis){
+				inLoop[phi.dst] = 1;
+			}
+			for (IRInst & inst : fn.blocks[b].insts){
+				if (inst.dst >= 0) inLoop[inst.dst] = 1;
+				if (inst.op == IROp::Store){
+					storedSlots[inst.imm] = 1;
+				} else if (inst.op == IROp::GStore){
+					if ((int)storedGlobals.size() <= inst.imm) storedGlobals.resize(inst.imm + 1, 0);
+					storedGlobals[inst.imm] = 1;
+				} else if (inst.op == IROp::Call){
+					calls = true;
+				}
+			}
+		}
+		auto invariant = [&](const IRInst& inst){
+			if (irHasSideEffects(inst.op)) return false;
+			if (inst.a >= 0 && inLoop[inst.a]) return false;
+			if (inst.b >= 0 && inLoop[inst.b]) return false;
+			if (inst.op == IROp::Load) return !storedSlots[inst.imm];
+			if (inst.op == IROp::GLoad){
+				bool stored = inst.imm < (int)storedGlobals.size() && storedGlobals[inst.imm];
+				return !stored && !calls;
+			}
+			return !irCanTrap(inst, isConst, constVal);
+		};
+
+		// Hoisted instructions land in the preheader in an order that
+		// keeps each definition ahead of its uses.
+		std::vector<IRInst> hoisted;
+		DomTree loopDom(fn);
+		bool changed = true;
+		while (changed){
+			changed = false;
+			for (int b : loopDom.rpo()){
+				if (!loop.body[b]) continue;
+				std::vector<IRInst> kept;
+				for (IRInst & inst : fn.blocks[b].insts){
+					if (inst.dst >= 0 && invariant(inst)){
+						inLoop[inst.dst] = 0;
+						hoisted.push_back(inst);
+						changed = true;
+					} else {
+						kept.push_back(inst);
+					}
+				}
+				fn.blocks[b].insts.swap(kept);
+			}
+		}
+		std::vector<IRInst> & preInsts = fn.blocks[pre].insts;
+		preInsts.insert(preInsts.end(), hoisted.begin(), hoisted.end());
+		stats.hoisted += hoisted.size();
+	}
+	return stats;
+}
+
+} // End namespace LILC
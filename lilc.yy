@@ -82,12 +82,12 @@ LILC::CallExpNode * callNode;
 %token               TRUE
 %token               FALSE
 %token               STRUCT
-%token               INPUT
-%token               OUTPUT
-%token               IF
+%token <tokenValue> INPUT
+%token <tokenValue> OUTPUT
+%token <tokenValue> IF
 %token               ELSE
-%token               WHILE
-%token               RETURN
+%token <tokenValue> WHILE
+%token <tokenValue> RETURN
 %token <idTokenValue> ID
 %token <intTokenValue>      INTLITERAL
 %token <strTokenValue>      STRINGLITERAL
@@ -261,14 +261,15 @@ stmtList : /* epsilon */
            $$ = $1;
            }
 
-stmt : assignExp SEMICOLON { $$ = new AssignStmtNode($1); }
-     | loc PLUSPLUS SEMICOLON { $$ = new PostIncStmtNode($1); }
-     | loc MINUSMINUS SEMICOLON { $$ = new PostDecStmtNode($1); }
-     | INPUT READ loc SEMICOLON { $$ = new ReadStmtNode($3); }
-     | OUTPUT WRITE exp SEMICOLON { $$ = new WriteStmtNode($3); }
+stmt : assignExp SEMICOLON { $$ = new AssignStmtNode($1); $$->setLine($1->line()); }
+     | loc PLUSPLUS SEMICOLON { $$ = new PostIncStmtNode($1); $$->setLine($1->line()); }
+     | loc MINUSMINUS SEMICOLON { $$ = new PostDecStmtNode($1); $$->setLine($1->line()); }
+     | INPUT READ loc SEMICOLON { $$ = new ReadStmtNode($3); $$->setLine($1->line); }
+     | OUTPUT WRITE exp SEMICOLON { $$ = new WriteStmtNode($3); $$->setLine($1->line); }
      | IF LPAREN exp RPAREN LCURLY varDeclList stmtList RCURLY 
         { 
         $$ = new IfStmtNode($3, new DeclListNode($6), new StmtListNode($7));
+        $$->setLine($1->line);
         }
      | IF LPAREN exp RPAREN LCURLY varDeclList stmtList RCURLY ELSE LCURLY varDeclList stmtList RCURLY
         { 
@@ -278,14 +279,16 @@ stmt : assignExp SEMICOLON { $$ = new AssignStmtNode($1); }
                 new StmtListNode($7), 
                 new DeclListNode($11), 
                 new StmtListNode($12)); 
+        $$->setLine($1->line);
         }
      | WHILE LPAREN exp RPAREN LCURLY varDeclList stmtList RCURLY
         { 
         $$ = new WhileStmtNode($3, new DeclListNode($6), new StmtListNode($7)); 
+        $$->setLine($1->line);
         }
-     | RETURN exp SEMICOLON { $$ = new ReturnStmtNode($2); }
-     | RETURN SEMICOLON { $$ = new ReturnStmtNode(nullptr); }
-     | fncall SEMICOLON { $$ = new CallStmtNode($1); }
+     | RETURN exp SEMICOLON { $$ = new ReturnStmtNode($2); $$->setLine($1->line); }
+     | RETURN SEMICOLON { $$ = new ReturnStmtNode(nullptr); $$->setLine($1->line); }
+     | fncall SEMICOLON { $$ = new CallStmtNode($1); $$->setLine($1->line()); }
 
 
 assignExp : loc ASSIGN exp { $$ = new AssignNode($1, $3); }
@@ -309,7 +312,7 @@ exp : assignExp { $$ = $1;}
 
 term : loc { $$ = $1; }
      | INTLITERAL { $$ = new IntLitNode($1); }
-     | STRINGLITERAL { $$ = new StrLitNode($1); }
+     | STRINGLITERAL { $$ = new StrLitNode(compiler.getStringPool(), $1); }
      | TRUE { $$ = new TrueNode(); }
      | FALSE { $$ = new FalseNode(); }
      | LPAREN exp RPAREN { $$ = $2; }
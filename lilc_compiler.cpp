@@ -1,8 +1,18 @@
 #include <cctype>
 #include <fstream>
 #include <cassert>
+#include <stdexcept>
+#include <chrono>
+#include <iostream>
 
 #include "lilc_compiler.hpp"
+#include "ssa.hpp"
+#include "ipo.hpp"
+#include "liveness.hpp"
+#include "codegen.hpp"
+#include "jit.hpp"
+#include "profile.hpp"
+#include "lilc_runtime.h"
 
 using TokenTag = LILC::LilC_Parser::token;
 using Lexeme = LILC::LilC_Parser::semantic_type;
@@ -15,6 +25,16 @@ LILC::LilC_Compiler::~LilC_Compiler()
    parser = nullptr;
    delete(astRoot);
    astRoot = nullptr;
+   delete(symbolTable);
+   symbolTable = nullptr;
+   delete(stringPool);
+   stringPool = nullptr;
+   delete(irModule);
+   irModule = nullptr;
+   delete(profileShape);
+   profileShape = nullptr;
+   delete(profileUsed);
+   profileUsed = nullptr;
 }
 
 void LILC::LilC_Compiler::scan( const char * const filename,
@@ -173,7 +193,11 @@ const char * outfile )
    }
 }
 
-void
+/*
+* Parses infile into astRoot. Returns false, leaving no tree, if the
+* parser or the scanner reported an error.
+*/
+bool
 LILC::LilC_Compiler::parse( const char * const infile) {
    assert( infile != nullptr );
    std::ifstream in_stream( infile );
@@ -186,6 +210,9 @@ LILC::LilC_Compiler::parse( const char * const infile) {
    scanner = new LILC::LilC_Scanner( &in_stream );
    delete(parser);
    delete(astRoot);
+   astRoot = nullptr;
+   delete(stringPool);
+   stringPool = new StringPool();
    try
    {
       parser = new LILC::LilC_Parser( (*scanner) /* scanner */,
@@ -201,25 +228,353 @@ LILC::LilC_Compiler::parse( const char * const infile) {
    if( parser->parse() != accept )
    {
       std::cerr << "Parse failed!!\n";
+      return false;
    }
+   return scanner->errorCount() == 0 && astRoot != nullptr;
 }
 
 void LILC::LilC_Compiler::nameAnalysis( const char * const infile, const char * const outfile ) {
-	this->parse(infile);
+	if (!this->parse(infile)) return;
+	delete( symbolTable);
+	symbolTable = new SymbolTable();
+	this->astRoot->nameAnalysis(symbolTable);
+
+	std::ofstream out(outfile);
+	this->astRoot->unparse(out, 0);
+}
+
+void LILC::LilC_Compiler::typeAnalysis( const char * const infile, const char * const outfile ) {
+	if (!this->parse(infile)) return;
 	delete( symbolTable);
 	symbolTable = new SymbolTable();
 	this->astRoot->nameAnalysis(symbolTable);
+	if (symbolTable->errorCount() > 0) return;
+	this->astRoot->typeAnalysis();
 
 	std::ofstream out(outfile);
 	this->astRoot->unparse(out, 0);
 }
 
-// void LILC::LilC_Compiler::typeAnalysis( const char * const infile, const char * const outfile ) {
-// 	this->parse(infile);
-// 	delete( symbolTable);
-// 	symbolTable = new SymbolTable();
-// 	this->astRoot->nameAnalysis(symbolTable);
-//
-// 	std::ofstream out(outfile);
-// 	this->astRoot->unparse(out, 0);
-// }
+/*
+* Runs the front end, and stops there, returning false, if the
+* scanner, the parser, name analysis or type analysis reports an
+* error. It then numbers the sites of a profile if one is taken or
+* used. Under -O it evaluates the calls to pure functions it can,
+* drops the functions and globals main cannot reach and runs the
+* optimization passes that work on the typed AST: dead code, then
+* dead stores and unused locals. Struct layout runs either way,
+* keeping source order without -O, and then under -O loops are
+* unrolled; without -O the program is otherwise translated as
+* written. The result is unparsed or translated to C, or lowered to
+* IR (optimized under -O) and then dumped, translated to x86-64
+* assembly, or compiled to bytecode that is listed or run on the VM.
+* Taking a profile runs the program on the VM even when -jit asks
+* otherwise.
+*/
+bool LILC::LilC_Compiler::compile( const char * const infile, const char * const outfile ) {
+	if (!this->parse(infile)) return false;
+	delete( symbolTable);
+	symbolTable = new SymbolTable();
+	this->astRoot->nameAnalysis(symbolTable);
+	if (symbolTable->errorCount() > 0) return false;
+	if (!this->astRoot->typeAnalysis()) return false;
+	if (!profileGenPath.empty() || !profileUsePath.empty()){
+		this->numberSites();
+	}
+	if (optimizeOn){
+		this->astRoot->evalCalls(evalFuel, report);
+		this->astRoot->elimDeadFunctions(report);
+		this->astRoot->elimDeadCode();
+		this->astRoot->elimDeadStores(report);
+	}
+	this->astRoot->layoutStructs(optimizeOn ? layoutMode : LayoutMode::Declared, report);
+	if (optimizeOn){
+		this->astRoot->unrollLoops(unrollFactor, report);
+	}
+
+	std::ofstream out(outfile);
+	if (emitKind == EmitKind::AST || emitKind == EmitKind::C){
+		if (emitKind == EmitKind::AST){
+			this->astRoot->unparse(out, 0);
+		} else {
+			this->astRoot->emitC(out, *stringPool);
+		}
+		if (!runOn && !benchOn && !jitOn) return true;
+	}
+	delete( irModule);
+	irModule = new IRModule();
+	this->astRoot->lower(irModule, !profileGenPath.empty());
+	if (optimizeOn){
+		this->optimizeIR();
+	}
+	if (report != nullptr && (emitKind == EmitKind::Bytecode || emitKind == EmitKind::Asm
+	  || runOn || benchOn || jitOn)){
+		this->reportTailCalls();
+	}
+	if (emitKind == EmitKind::IR){
+		irModule->dump(out);
+	} else if (emitKind == EmitKind::Asm){
+		emitAssembly(*irModule, out, report);
+	}
+	if (jitOn && profileGenPath.empty()){
+		out.flush();
+		this->runJIT();
+		return true;
+	}
+	if (emitKind != EmitKind::Bytecode && !runOn && !benchOn) return true;
+	BCModule bytecode = compileBytecode(*irModule);
+	if (emitKind == EmitKind::Bytecode){
+		bytecode.dump(out);
+	}
+	if (runOn || benchOn){
+		out.flush();
+		this->runBytecode(bytecode);
+	}
+	return true;
+}
+
+/*
+* Numbers the sites of every function for the profile taken or
+* used. The profile used must be well formed; the counts it holds
+* for functions whose source has changed since are ignored.
+*/
+void LILC::LilC_Compiler::numberSites() {
+	delete(profileShape);
+	profileShape = new Profile();
+	delete(profileUsed);
+	profileUsed = nullptr;
+	if (!profileUsePath.empty()){
+		std::ifstream in(profileUsePath);
+		profileUsed = new Profile();
+		if (!in.good() || !profileUsed->read(in)){
+			std::cerr << "Bad profile: " << profileUsePath << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+	this->astRoot->numberSites(profileShape, profileUsed, report);
+}
+
+/*
+* Adds the counters of a profiling run to the sites they count and
+* writes the profile out. A profile already at the path, of the
+* same source, is added to, so that several runs accumulate.
+*/
+void LILC::LilC_Compiler::writeProfile(const std::vector<uint64_t>& counters) {
+	for (size_t i = 0; i < counters.size(); i++){
+		const IRProbe & probe = irModule->probes[i];
+		FnProfile & fn = profileShape->functions[probe.fn];
+		if (probe.site < 0){
+			fn.entries += counters[i];
+		} else {
+			fn.sites[probe.site].count[probe.arm] += counters[i];
+		}
+	}
+	Profile earlier;
+	std::ifstream in(profileGenPath);
+	if (in.good() && earlier.read(in)) profileShape->merge(earlier);
+	in.close();
+	std::ofstream out(profileGenPath);
+	profileShape->write(out);
+}
+
+/*
+* Writes the folded stacks of a sampled run to the path given, and
+* the flat report on cerr.
+*/
+void LILC::LilC_Compiler::writeSamples(const Sampler& sampler) {
+	std::ofstream out(samplePath);
+	sampler.writeFolded(out);
+	sampler.writeReport(std::cerr);
+}
+
+/*
+* Lists the tail calls left after optimization, which the backends
+* about to run turn into jumps. Native code keeps a call when the
+* callee's stack arguments would not fit where the caller's arrived.
+*/
+void LILC::LilC_Compiler::reportTailCalls() {
+	for (IRFunction & fn : irModule->functions){
+		for (IRBlock & block : fn.blocks){
+			if (block.insts.empty() || !irIsTailCall(fn, block, block.insts.size() - 1)) continue;
+			IRFunction & callee = irModule->functions[block.insts.back().imm];
+			*report << "tailcall " << fn.name << " -> " << callee.name << ": jump";
+			if (!fitsTailJump(fn, callee)) *report << " in bytecode only, too many stack arguments";
+			*report << std::endl;
+		}
+	}
+}
+
+/*
+* Runs the program as machine code. Functions are compiled as they
+* are first called; -report says how many were, -bench how long the
+* whole run took. The frames sampling walks are those below this
+* function's.
+*/
+void LILC::LilC_Compiler::runJIT() {
+	std::cout.flush();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	JIT jit(*irModule, !samplePath.empty());
+	std::vector<std::string> names;
+	std::vector<int> lines;
+	for (IRFunction & fn : irModule->functions){
+		names.push_back(fn.name);
+		lines.push_back(fn.line);
+	}
+	Sampler sampler(names, lines);
+	if (!samplePath.empty()){
+		sampler.start(__builtin_frame_address(0));
+	}
+	bool failed = false;
+	try {
+		jit.run();
+	} catch (std::runtime_error & e){
+		std::cout.flush();
+		std::cerr << e.what() << std::endl;
+		failed = true;
+	}
+	sampler.stop();
+	if (!samplePath.empty()){
+		sampler.resolve([&](uintptr_t address, SampleFrame & frame){
+			return jit.locate(address, frame.fn, frame.line);
+		});
+		this->writeSamples(sampler);
+	}
+	if (failed) exit(EXIT_FAILURE);
+	if (report != nullptr){
+		*report << "jit: " << jit.functionsCompiled() << " of "
+		  << irModule->functions.size() << " functions compiled, "
+		  << jit.codeBytes() << " bytes of code" << std::endl;
+	}
+	if (benchOn){
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::cerr << "jit: ran in " << elapsed.count() << " s" << std::endl;
+	}
+}
+
+/*
+* Runs the program on the VM, reading stdin and writing stdout. A bench
+* run counts the instructions dispatched, which costs a little, and
+* reports the rate on cerr. A sampled run has the VM take samples
+* as the sampler's timer asks for them.
+*/
+void LILC::LilC_Compiler::runBytecode(const BCModule& module) {
+	std::cout.flush();
+	VM vm(module);
+	std::vector<std::string> names;
+	std::vector<int> lines;
+	for (const BCFunction & fn : module.functions){
+		names.push_back(fn.name);
+		lines.push_back(fn.line);
+	}
+	Sampler sampler(names, lines);
+	if (!samplePath.empty()){
+		vm.setSampler(&sampler);
+		sampler.start();
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	try {
+		vm.run(benchOn);
+	} catch (std::runtime_error & e){
+		sampler.stop();
+		lilc_rt_flush();
+		std::cerr << e.what() << std::endl;
+		if (!samplePath.empty()) this->writeSamples(sampler);
+		exit(EXIT_FAILURE);
+	}
+	sampler.stop();
+	if (!profileGenPath.empty()){
+		this->writeProfile(vm.counters());
+	}
+	if (!samplePath.empty()){
+		this->writeSamples(sampler);
+	}
+	if (!benchOn) return;
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	double seconds = elapsed.count();
+	uint64_t count = vm.instructionsExecuted();
+	std::cerr << "vm: " << count << " instructions in " << seconds << " s ("
+	  << (seconds > 0 ? count / seconds / 1e6 : 0) << " M instructions/s)" << std::endl;
+}
+
+/*
+* The IR optimization pipeline. Constant arguments are first bound
+* into their callees, or into specialized copies of them. Functions
+* are then visited callees first, so each has its calls inlined and
+* is then optimized on its own before any caller inlines it in turn.
+*/
+void LILC::LilC_Compiler::optimizeIR() {
+	specializeCalls(*irModule, report);
+	CallGraph graph = buildCallGraph(*irModule);
+	Inliner inliner(*irModule, graph, profileUsed);
+	for (std::vector<int> & component : graph.sccs()){
+		for (int fn : component){
+			inliner.inlineCalls(fn);
+			this->optimizeFunction(irModule->functions[fn]);
+		}
+	}
+	if (report != nullptr){
+		for (const InlineDecision & decision : inliner.decisions()){
+			*report << "inline " << decision.callee << " into "
+			  << decision.caller << " (size " << decision.cost << "): "
+			  << decision.reason << std::endl;
+		}
+	}
+	int removed = removeUnreachableFunctions(*irModule);
+	if (report != nullptr){
+		*report << "ipo: " << removed << " unreachable functions removed" << std::endl;
+	}
+}
+
+/*
+* Each function has its local structs split into scalars, is taken
+* into SSA form, has redundant computations removed, constants
+* propagated, loop invariants hoisted and arithmetic
+* strength-reduced, and is taken back out. The result is checked
+* to define every value before any use of it.
+*/
+void LILC::LilC_Compiler::optimizeFunction(IRFunction& fn) {
+	int numGlobals = irModule->globals.size();
+	int tailCalls = eliminateTailRecursion(fn, irModule->findFunction(fn.name));
+	if (report != nullptr && tailCalls > 0){
+		*report << "tailcall " << fn.name << ": " << tailCalls
+		  << " self tail calls made loops" << std::endl;
+	}
+	SRAStats sra = scalarReplace(fn);
+	if (report != nullptr && sra.structs + sra.unused > 0){
+		*report << "sra " << fn.name << ": " << sra.structs
+		  << " structs split into " << sra.fields << " fields, "
+		  << sra.unused << " unused fields dropped" << std::endl;
+	}
+	buildSSA(fn);
+	GVNStats stats = gvn(fn, numGlobals);
+	if (report != nullptr){
+		*report << "gvn " << fn.name << ": " << stats.exprs
+		  << " expressions, " << stats.loads << " loads, "
+		  << stats.phis << " phis eliminated" << std::endl;
+	}
+	sccp(fn);
+	cleanupSSA(fn);
+	LICMStats loops = licm(fn);
+	if (report != nullptr){
+		*report << "licm " << fn.name << ": " << loops.hoisted
+		  << " instructions hoisted out of " << loops.loops
+		  << " loops" << std::endl;
+	}
+	StrengthStats strength = strengthReduce(fn);
+	if (report != nullptr){
+		*report << "strength " << fn.name << ": " << strength.ivs
+		  << " induction variables, " << strength.recurrences
+		  << " multiplications made additive, " << strength.shifts
+		  << " multiplications and " << strength.divisions
+		  << " divisions made shifts" << std::endl;
+	}
+	cleanupSSA(fn);
+	destroySSA(fn);
+	fn.simplifyCFG();
+	int undefined = undefinedUse(fn);
+	if (undefined >= 0){
+		throw std::runtime_error("Internal Error: " + fn.name + " uses "
+		  + fn.vals[undefined].name + " (value " + std::to_string(undefined)
+		  + ") before defining it");
+	}
+}
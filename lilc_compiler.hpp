@@ -4,15 +4,22 @@
 #include <string>
 #include <cstddef>
 #include <istream>
+#include <ostream>
 
 #include "lilc_scanner.hpp"
 #include "tokens.hpp"
 #include "ast.hpp"
 #include "grammar.hh"
 #include "symbol_table.hpp"
+#include "ir.hpp"
+#include "bytecode.hpp"
+#include "sampler.hpp"
 
 namespace LILC{
 
+// What LilC_Compiler::compile writes to its output file
+enum class EmitKind { AST, C, IR, Bytecode, Asm };
+
 class LilC_Compiler{
 public:
    LilC_Compiler() = default;
@@ -21,16 +28,66 @@ public:
 
    void setASTRoot(ProgramNode * root){ this->astRoot = root; }
    ProgramNode * getASTRoot(){ return this->astRoot; }
+   // The string literals of the program being parsed
+   StringPool * getStringPool(){ return this->stringPool; }
+   void setEmit(EmitKind kind){ this->emitKind = kind; }
+   void setOptimize(bool on){ this->optimizeOn = on; }
+   // Copies of the body per iteration of a partially unrolled loop
+   void setUnroll(int factor){ this->unrollFactor = factor; }
+   // Steps a call to a pure function may take to be evaluated at compile time
+   void setFuel(long fuel){ this->evalFuel = fuel; }
+   // How -O orders struct fields
+   void setLayout(LayoutMode mode){ this->layoutMode = mode; }
+   void setReport(std::ostream * out){ this->report = out; }
+   // Runs the program on the bytecode VM once compiled
+   void setRun(bool on){ this->runOn = on; }
+   // As setRun, also timing the run and counting its instructions
+   void setBench(bool on){ this->benchOn = on; }
+   // Runs the program compiled to machine code in process instead
+   void setJIT(bool on){ this->jitOn = on; }
+   // Runs the program on the VM, counting what it does into a profile at path
+   void setProfileGen(const std::string& path){ this->profileGenPath = path; }
+   // Optimizes by the profile at path, for the functions it still matches
+   void setProfileUse(const std::string& path){ this->profileUsePath = path; }
+   // Samples where the run spends its time, writing folded stacks to path
+   void setSample(const std::string& path){ this->samplePath = path; }
 
    void scan( const char * const filename, const char * outfile);
-   void parse( const char * const filename );
+   bool parse( const char * const filename );
    void nameAnalysis( const char * const filename, const char * outfile );
    void typeAnalysis( const char * const filename, const char * outfile );
+   // Returns false if the front end rejected the program
+   bool compile( const char * const filename, const char * outfile );
 private:
+   void optimizeIR();
+   void optimizeFunction(IRFunction& fn);
+   void reportTailCalls();
+   void numberSites();
+   void writeProfile(const std::vector<uint64_t>& counters);
+   void runBytecode(const BCModule& module);
+   void runJIT();
+   void writeSamples(const Sampler& sampler);
+
    LILC::LilC_Parser  *parser  = nullptr;
    LILC::LilC_Scanner *scanner = nullptr;
    ProgramNode * astRoot = nullptr;
+   StringPool * stringPool = nullptr;
    SymbolTable * symbolTable = nullptr;
+   IRModule * irModule = nullptr;
+   EmitKind emitKind = EmitKind::AST;
+   bool optimizeOn = false;
+   int unrollFactor = 4;
+   long evalFuel = 100000;
+   LayoutMode layoutMode = LayoutMode::Packed;
+   bool runOn = false;
+   bool benchOn = false;
+   bool jitOn = false;
+   std::string profileGenPath;
+   std::string profileUsePath;
+   std::string samplePath;
+   Profile * profileShape = nullptr; // the program's sites, counted by -profile-gen
+   Profile * profileUsed = nullptr;  // the counts of -profile-use that apply
+   std::ostream * report = nullptr; // where passes describe what they did
 };
 
 } /* end namespace */
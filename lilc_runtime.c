@@ -0,0 +1,263 @@
+/*
+* Runtime support for LIL'C programs: the program entry point and
+* the input and output that ReadStmtNode and WriteStmtNode compile
+* to. Link it with the assembly P5 -S writes, or with the C P5 -c
+* writes:
+*
+*     P5 prog.lilc prog.s -S && cc prog.s lilc_runtime.c -o prog
+*     P5 prog.lilc prog.c -c && cc -O2 prog.c lilc_runtime.c -o prog
+*
+* P5 links it too, built with LILC_RT_NO_MAIN, and the VM and the
+* JIT do their input and output through it, so every backend reads
+* and writes the same way.
+*
+* Input is read a buffer at a time and integers are parsed straight
+* from the buffer. Output collects in a buffer that is written out
+* when it fills, when the program ends or stops on a runtime error,
+* and before input is read that is not a regular file, so that a
+* prompt shows before the program waits for its answer.
+*
+* When the environment names a file in LILC_OUTPUT_MMAP, output goes
+* there instead of to stdout, written through a shared mapping of
+* the file one window at a time rather than by write calls.
+*/
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "lilc_runtime.h"
+
+#define BUFFER_SIZE (1 << 16)  /* bytes of input or output buffered */
+#define MMAP_WINDOW (1 << 24)  /* bytes of the output file mapped at a time */
+#define INT_DIGITS 11          /* characters of the longest int, sign included */
+
+static char inBuffer[BUFFER_SIZE];
+static size_t inPos = 0;
+static size_t inEnd = 0;
+static int inDone = 0;
+static int inChecked = 0;
+static int inRegular = 0;
+
+/*
+* Output goes to outBase, which has room for outRoom bytes, outPos
+* of them used: outBuffer, or the window of the output file mapped.
+*/
+static char outBuffer[BUFFER_SIZE];
+static char * outBase = outBuffer;
+static size_t outPos = 0;
+static size_t outRoom = 0;
+static int outOpened = 0;
+static int outFile = -1;      /* the LILC_OUTPUT_MMAP file, -1 for stdout */
+static char * outMap = NULL;  /* the window mapped, NULL if none */
+static off_t outMapStart = 0; /* its offset in the file */
+static off_t outWritten = 0;  /* bytes of the file written before outBase */
+
+static const char digitPairs[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static void fail(const char * what){
+	fprintf(stderr, "Runtime Error: %s: %s\n", what, strerror(errno));
+	exit(EXIT_FAILURE);
+}
+
+static void writeAll(const char * bytes, size_t size){
+	while (size > 0){
+		ssize_t written = write(STDOUT_FILENO, bytes, size);
+		if (written < 0){
+			if (errno == EINTR) continue;
+			fail("cannot write output");
+		}
+		bytes += written;
+		size -= written;
+	}
+}
+
+/*
+* Sets up where output goes, on the first write. The output is
+* flushed at exit however the program ends.
+*/
+static void openOutput(void){
+	const char * path = getenv("LILC_OUTPUT_MMAP");
+	if (path != NULL && path[0] != '\0'){
+		outFile = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+		if (outFile < 0) fail(path);
+	}
+	atexit(lilc_rt_flush);
+	outOpened = 1;
+}
+
+/*
+* Makes room for more output: maps the window of the output file
+* that holds its end, or starts over in outBuffer.
+*/
+static void moreRoom(void){
+	if (!outOpened) openOutput();
+	if (outFile < 0){
+		outBase = outBuffer;
+		outRoom = BUFFER_SIZE;
+		return;
+	}
+	outMapStart = outWritten - outWritten % sysconf(_SC_PAGESIZE);
+	if (ftruncate(outFile, outMapStart + MMAP_WINDOW) != 0) fail("cannot grow output file");
+	void * map = mmap(NULL, MMAP_WINDOW, PROT_READ | PROT_WRITE, MAP_SHARED, outFile, outMapStart);
+	if (map == MAP_FAILED) fail("cannot map output file");
+	outMap = (char *)map;
+	outBase = outMap + (outWritten - outMapStart);
+	outRoom = MMAP_WINDOW - (outWritten - outMapStart);
+}
+
+static void put(const char * bytes, size_t size){
+	if (outRoom - outPos >= size){
+		memcpy(outBase + outPos, bytes, size);
+		outPos += size;
+		return;
+	}
+	while (size > 0){
+		if (outPos == outRoom){
+			lilc_rt_flush();
+			moreRoom();
+		}
+		size_t chunk = outRoom - outPos < size ? outRoom - outPos : size;
+		memcpy(outBase + outPos, bytes, chunk);
+		outPos += chunk;
+		bytes += chunk;
+		size -= chunk;
+	}
+}
+
+/*
+* Writes out the output collected so far. A window of the output
+* file is unmapped and the file cut back to the bytes written; the
+* next write maps it again.
+*/
+void lilc_rt_flush(void){
+	if (outFile < 0){
+		writeAll(outBuffer, outPos);
+		outPos = 0;
+		return;
+	}
+	if (outMap == NULL) return;
+	outWritten += outPos;
+	munmap(outMap, MMAP_WINDOW);
+	if (ftruncate(outFile, outWritten) != 0) fail("cannot write output file");
+	outMap = NULL;
+	outBase = outBuffer;
+	outPos = 0;
+	outRoom = 0;
+}
+
+// Refills the input buffer; returns 0 at the end of input
+static int moreInput(void){
+	if (inDone) return 0;
+	if (!inChecked){
+		struct stat info;
+		inRegular = fstat(STDIN_FILENO, &info) == 0 && S_ISREG(info.st_mode);
+		inChecked = 1;
+	}
+	if (!inRegular) lilc_rt_flush();
+	ssize_t got;
+	do {
+		got = read(STDIN_FILENO, inBuffer, BUFFER_SIZE);
+	} while (got < 0 && errno == EINTR);
+	if (got <= 0){
+		inDone = 1;
+		return 0;
+	}
+	inPos = 0;
+	inEnd = got;
+	return 1;
+}
+
+static int peek(void){
+	if (inPos == inEnd && !moreInput()) return -1;
+	return (unsigned char)inBuffer[inPos];
+}
+
+static int isSpace(int c){
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/*
+* Reads a decimal integer after any white space, with an optional
+* sign. The end of input reads as 0. So does a word that is not a
+* number, which is skipped up to the next white space, so that the
+* next read goes on past it. Reading stops at the first character
+* after the digits. Values out of range are clamped to INT_MIN or
+* INT_MAX.
+*/
+int lilc_rt_read_int(void){
+	int c = peek();
+	while (isSpace(c)){
+		inPos++;
+		c = peek();
+	}
+	int negative = 0;
+	if (c == '-' || c == '+'){
+		negative = c == '-';
+		inPos++;
+		c = peek();
+	}
+	if (c < '0' || c > '9'){
+		while (c >= 0 && !isSpace(c)){
+			inPos++;
+			c = peek();
+		}
+		return 0;
+	}
+	long long value = 0;
+	do {
+		if (value <= (long long)INT_MAX + 1) value = value * 10 + (c - '0');
+		inPos++;
+		c = peek();
+	} while (c >= '0' && c <= '9');
+	if (negative) return value > (long long)INT_MAX + 1 ? INT_MIN : (int)-value;
+	return value > INT_MAX ? INT_MAX : (int)value;
+}
+
+void lilc_rt_write_int(int value){
+	char text[INT_DIGITS];
+	char * end = text + INT_DIGITS;
+	char * at = end;
+	unsigned rest = value < 0 ? 0u - (unsigned)value : (unsigned)value;
+	while (rest >= 100){
+		unsigned pair = rest % 100;
+		rest /= 100;
+		at -= 2;
+		memcpy(at, digitPairs + 2 * pair, 2);
+	}
+	if (rest >= 10){
+		at -= 2;
+		memcpy(at, digitPairs + 2 * rest, 2);
+	} else {
+		*--at = (char)('0' + rest);
+	}
+	if (value < 0) *--at = '-';
+	put(at, end - at);
+}
+
+void lilc_rt_write_str(const char * text){
+	put(text, strlen(text));
+}
+
+void lilc_rt_div_zero(void){
+	lilc_rt_flush();
+	fputs("Runtime Error: division by zero\n", stderr);
+	exit(EXIT_FAILURE);
+}
+
+#ifndef LILC_RT_NO_MAIN
+void lilc_f_main(void);
+
+int main(void){
+	lilc_f_main();
+	return 0;
+}
+#endif
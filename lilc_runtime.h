@@ -0,0 +1,66 @@
+/*
+* Interface to the LIL'C runtime for the C that P5 -c writes and for
+* the VM and the JIT: the input and output entry points
+* lilc_runtime.c defines, and the integer operations whose LIL'C
+* meaning C leaves undefined. They are inline so that the C compiler
+* sees through them.
+*/
+#ifndef LILC_RUNTIME_H
+#define LILC_RUNTIME_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+* Reads the next integer from stdin. The end of input reads as 0, as
+* does a word that is not a number, which is skipped.
+*/
+int lilc_rt_read_int(void);
+void lilc_rt_write_int(int value);
+void lilc_rt_write_str(const char * text);
+// Writes out the output buffered so far; done at exit in any case
+void lilc_rt_flush(void);
+void lilc_rt_div_zero(void);
+
+/*
+* Arithmetic wraps around in two's complement. It is done on
+* unsigned operands, where C defines wrapping, and converted back,
+* which the C compilers P5 targets define as wrapping too.
+*/
+static inline int lilc_rt_add(int a, int b){
+	return (int)((unsigned)a + (unsigned)b);
+}
+
+static inline int lilc_rt_sub(int a, int b){
+	return (int)((unsigned)a - (unsigned)b);
+}
+
+static inline int lilc_rt_mul(int a, int b){
+	return (int)((unsigned)a * (unsigned)b);
+}
+
+static inline int lilc_rt_neg(int a){
+	return (int)(0u - (unsigned)a);
+}
+
+/*
+* Division by zero stops the program; the most negative int
+* divided by -1 wraps around to itself.
+*/
+static inline int lilc_rt_div(int a, int b){
+	if (b == 0){
+		lilc_rt_div_zero();
+		return 0;
+	}
+	if (b == -1) return lilc_rt_neg(a);
+	return a / b;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -31,8 +31,12 @@ public:
 
    void error(int lineNum, int charNum, std::string msg){
 	std::cerr << lineNum << ":" << charNum << " ***ERROR*** " << msg << std::endl;
+	errors++;
    }
 
+   // Errors reported so far
+   int errorCount() const { return errors; }
+
    int produceNullaryToken(int tag){
 	this->yylval->tokenValue = new NullaryToken(lineNum, charNum, tag);
 	charNum += yyleng;
@@ -42,8 +46,9 @@ public:
 private:
    /* yyval ptr */
    LILC::LilC_Parser::semantic_type *yylval = nullptr;
-   size_t lineNum;
-   size_t charNum;
+   size_t lineNum = 1;
+   size_t charNum = 1;
+   int errors = 0;
 };
 
 } /* end namespace */
@@ -0,0 +1,102 @@
+#include "liveness.hpp"
+#include "dataflow.hpp"
+
+namespace LILC{
+
+namespace {
+
+/*
+* Backward, meeting by union: a block's gen set holds the values it
+* reads before writing them, its kill set the values it writes.
+*/
+class LivenessProblem : public DataflowProblem{
+public:
+	LivenessProblem(IRFunction& fn)
+	: DataflowProblem(Direction::Backward, Meet::Union, fn.vals.size(), fn.blocks.size()),
+	  myFn(fn){
+		for (size_t b = 0; b < fn.blocks.size(); b++){
+			IRBlock & block = fn.blocks[b];
+			for (IRPhi & phi : block.phis){
+				kill[b].set(phi.dst);
+			}
+			auto use = [&](int val){
+				if (val >= 0 && !kill[b].test(val)) gen[b].set(val);
+			};
+			for (IRInst & inst : block.insts){
+				use(inst.a);
+				use(inst.b);
+				if (inst.dst >= 0) kill[b].set(inst.dst);
+			}
+			if (block.term.kind != IRTermKind::Jump) use(block.term.val);
+		}
+	}
+
+	// The phis of to read their arguments for from at from's end
+	void edge(int from, int to, BitVector& fact){
+		for (IRPhi & phi : myFn.blocks[to].phis){
+			fact.reset(phi.dst);
+			for (size_t i = 0; i < phi.args.size(); i++){
+				if (phi.blocks[i] == from) fact.set(phi.args[i]);
+			}
+		}
+	}
+private:
+	IRFunction & myFn;
+};
+
+/*
+* Forward, meeting by intersection: a value is defined at a point
+* when every path from the entry to it defines the value first.
+*/
+class DefinedProblem : public DataflowProblem{
+public:
+	DefinedProblem(IRFunction& fn)
+	: DataflowProblem(Direction::Forward, Meet::Intersection, fn.vals.size(), fn.blocks.size()){
+		for (int f = 0; f < fn.numFormals; f++){
+			boundary.set(f);
+		}
+		for (size_t b = 0; b < fn.blocks.size(); b++){
+			IRBlock & block = fn.blocks[b];
+			for (IRPhi & phi : block.phis){
+				gen[b].set(phi.dst);
+			}
+			for (IRInst & inst : block.insts){
+				if (inst.dst >= 0) gen[b].set(inst.dst);
+			}
+		}
+	}
+};
+
+} // End anonymous namespace
+
+IRLiveness::IRLiveness(IRFunction& fn){
+	LivenessProblem problem(fn);
+	DataflowResult result = solveDataflow(fn, problem);
+	myLiveIn.swap(result.atStart);
+	myLiveOut.swap(result.atEnd);
+}
+
+int undefinedUse(IRFunction& fn){
+	DefinedProblem problem(fn);
+	DataflowResult result = solveDataflow(fn, problem);
+	std::vector<int> order = fn.reversePostorder();
+	for (int b : order){
+		IRBlock & block = fn.blocks[b];
+		BitVector defined = result.atStart[b];
+		for (IRPhi & phi : block.phis){
+			for (size_t i = 0; i < phi.args.size(); i++){
+				if (!result.atEnd[phi.blocks[i]].test(phi.args[i])) return phi.args[i];
+			}
+		}
+		for (IRInst & inst : block.insts){
+			if (inst.a >= 0 && !defined.test(inst.a)) return inst.a;
+			if (inst.b >= 0 && !defined.test(inst.b)) return inst.b;
+			if (inst.dst >= 0) defined.set(inst.dst);
+		}
+		int val = block.term.kind == IRTermKind::Jump ? -1 : block.term.val;
+		if (val >= 0 && !defined.test(val)) return val;
+	}
+	return -1;
+}
+
+} // End namespace LILC
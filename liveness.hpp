@@ -0,0 +1,37 @@
+#ifndef LILC_LIVENESS_HPP
+#define LILC_LIVENESS_HPP
+
+#include <vector>
+#include "bitvector.hpp"
+#include "ir.hpp"
+
+namespace LILC{
+
+/*
+* The values live on entry to and exit from each block of an
+* IRFunction, for register allocation; value numbers index the
+* sets. Works in or out of SSA form: a phi's result is defined on
+* entry to its block, and each phi argument is used on exit from
+* the predecessor it comes from.
+*/
+class IRLiveness{
+public:
+	IRLiveness(IRFunction& fn);
+	const BitVector& liveIn(int block) const { return myLiveIn[block]; }
+	const BitVector& liveOut(int block) const { return myLiveOut[block]; }
+	bool isLiveOut(int block, int val) const { return myLiveOut[block].test(val); }
+private:
+	std::vector<BitVector> myLiveIn;
+	std::vector<BitVector> myLiveOut;
+};
+
+/*
+* A value that some path from the entry of fn uses before defining,
+* or -1 if there is none; the formals are defined on entry. Every
+* pass must leave fn free of such uses.
+*/
+int undefinedUse(IRFunction& fn);
+
+} //End namespace LILC
+
+#endif
@@ -0,0 +1,802 @@
+#include "ast.hpp"
+#include "ir.hpp"
+#include "profile.hpp"
+#include <stdexcept>
+
+namespace LILC{
+
+/*
+* Lowering from the typed AST into the three-address IR. Each
+* FnDeclNode becomes an IRFunction; if/if-else/while statements and
+* the short-circuit operators become explicit branches between basic
+* blocks, and every nested expression result gets its own temporary.
+*/
+
+static IRType irTypeOf(std::string type){
+	if (type == "int") return IRType::Int;
+	if (type == "bool") return IRType::Bool;
+	return IRType::Void;
+}
+
+// IRLowering
+
+void IRLowering::beginFunction(int fnIndex, const FnProfile * profile){
+	myFn = &myModule->functions[fnIndex];
+	myProfile = profile;
+	myHot = myCold = -1;
+	myLine = myFn->line;
+	myFn->vals.clear();
+	myFn->slots.clear();
+	myFn->blocks.clear();
+	myNameCounts.clear();
+	myBlock = myFn->newBlock();
+	pushScope();
+}
+
+/*
+* Control reaching the end of a function body returns; a function
+* with a result returns 0 in that case so that every backend agrees.
+*/
+void IRLowering::endFunction(){
+	if (myFn->retType == IRType::Void){
+		ret(-1);
+	} else {
+		ret(emitValue(IROp::Const, myFn->retType, -1, -1, 0));
+	}
+	popScope();
+	myFn->removeUnreachable();
+	myFn = nullptr;
+}
+
+void IRLowering::pushScope(){
+	myScopes.push_back(std::unordered_map<std::string, IRLoc>());
+}
+
+void IRLowering::popScope(){
+	myScopes.pop_back();
+}
+
+void IRLowering::declareStruct(const std::string& name, IRStructInfo info){
+	myStructs[name] = info;
+}
+
+const IRStructInfo * IRLowering::findStruct(const std::string& name){
+	std::unordered_map<std::string, IRStructInfo>::const_iterator got = myStructs.find(name);
+	if (got == myStructs.end()) return nullptr;
+	return &got->second;
+}
+
+/*
+* Appends one slot per scalar field of the struct, in layout order,
+* named after the path used to reach it.
+*/
+static void flattenStruct(IRLowering * ir, const std::string& path,
+  const std::string& structName, std::vector<IRSlot> * slots){
+	const IRStructInfo * info = ir->findStruct(structName);
+	for (const IRStructField & field : info->fields){
+		std::string fieldPath = path + "." + field.name;
+		if (field.structName.empty()){
+			slots->push_back(IRSlot{fieldPath, field.type});
+		} else {
+			flattenStruct(ir, fieldPath, field.structName, slots);
+		}
+	}
+}
+
+/*
+* Globals live in global slots and start out zeroed. Scalar locals
+* get a value, struct locals a run of frame slots; both are zeroed
+* at the point of declaration.
+*/
+void IRLowering::declareVar(const std::string& name, IRType type, const std::string& structName){
+	IRLoc loc;
+	loc.type = type;
+	loc.structName = structName;
+	if (myFn == nullptr){
+		loc.kind = IRLoc::Global;
+		loc.index = myModule->globals.size();
+		if (structName.empty()){
+			myModule->globals.push_back(IRSlot{name, type});
+		} else {
+			flattenStruct(this, name, structName, &myModule->globals);
+		}
+	} else if (structName.empty()){
+		std::string unique = name;
+		int count = myNameCounts[name]++;
+		if (count > 0) unique += "." + std::to_string(count);
+		loc.kind = IRLoc::Value;
+		loc.index = myFn->newValue(type, unique);
+		emit(IROp::Const, loc.index, -1, -1, 0);
+	} else {
+		loc.kind = IRLoc::Slot;
+		loc.index = myFn->slots.size();
+		flattenStruct(this, name, structName, &myFn->slots);
+		int zero = emitValue(IROp::Const, IRType::Int, -1, -1, 0);
+		for (size_t s = loc.index; s < myFn->slots.size(); s++){
+			myFn->slots[s].first = loc.index;
+			emit(IROp::Store, -1, zero, -1, s);
+		}
+	}
+	myScopes.back()[name] = loc;
+}
+
+void IRLowering::declareFormal(const std::string& name, IRType type){
+	myNameCounts[name]++;
+	IRLoc loc;
+	loc.kind = IRLoc::Value;
+	loc.index = myFn->newValue(type, name);
+	loc.type = type;
+	myScopes.back()[name] = loc;
+}
+
+IRLoc IRLowering::lookup(const std::string& name){
+	for (auto scope = myScopes.rbegin(); scope != myScopes.rend(); ++scope){
+		std::unordered_map<std::string, IRLoc>::const_iterator got = scope->find(name);
+		if (got != scope->end()) return got->second;
+	}
+	throw std::runtime_error("Internal Error: undeclared identifier "
+		+ name + " reached IR lowering");
+}
+
+int IRLowering::lookupFunction(const std::string& name){
+	int fn = myModule->findFunction(name);
+	if (fn < 0){
+		throw std::runtime_error("Internal Error: call to unknown"
+			" function " + name + " reached IR lowering");
+	}
+	return fn;
+}
+
+int IRLowering::addString(const char * text, size_t length){
+	return myModule->strings.add(text, length);
+}
+
+int IRLowering::emit(IROp op, int dst, int a, int b, int imm){
+	myFn->blocks[myBlock].insts.push_back(IRInst{op, dst, a, b, imm, myLine});
+	return dst;
+}
+
+int IRLowering::emitValue(IROp op, IRType type, int a, int b, int imm){
+	return emit(op, myFn->newValue(type), a, b, imm);
+}
+
+void IRLowering::terminate(IRTermKind kind, int val, int succ0, int succ1){
+	myFn->blocks[myBlock].term = IRTerm{kind, val, {succ0, succ1}};
+}
+
+void IRLowering::jump(int target){
+	terminate(IRTermKind::Jump, -1, target, -1);
+}
+
+void IRLowering::branch(int cond, int ifTrue, int ifFalse){
+	terminate(IRTermKind::Branch, cond, ifTrue, ifFalse);
+	IRTerm & term = myFn->blocks[myBlock].term;
+	if (ifTrue == myHot || ifFalse == myCold){
+		term.likely = 0;
+	} else if (ifFalse == myHot || ifTrue == myCold){
+		term.likely = 1;
+	}
+}
+
+/*
+* When lowering for a profiling run, counts arm of the given site.
+* Statements passes made after sites were numbered have site -1 and
+* are not counted.
+*/
+void IRLowering::probe(int site, int arm){
+	if (!myProbes || site < 0) return;
+	emit(IROp::Probe, -1, -1, -1, myModule->probes.size());
+	myModule->probes.push_back(IRProbe{myFn->name, site, arm});
+}
+
+// As probe, counting the entries of the function
+void IRLowering::probeEntry(){
+	if (!myProbes) return;
+	emit(IROp::Probe, -1, -1, -1, myModule->probes.size());
+	myModule->probes.push_back(IRProbe{myFn->name, -1, 0});
+}
+
+/*
+* Until the next call, the branches lowered favor ifTrue, the block
+* of a statement its test leads to, if the profile shows the test of
+* the statement's site holding more often than failing, and ifFalse
+* if the other way round: a branch straight to the hot block, or
+* else away from the cold one, gets it as its likely successor. The
+* branches of && and || in the test thereby lay the hot path out
+* straight. expect(-1, -1, -1) ends it.
+*/
+void IRLowering::expect(int site, int ifTrue, int ifFalse){
+	myHot = myCold = -1;
+	if (myProfile == nullptr || site < 0) return;
+	const ProfileSite & counts = myProfile->sites[site];
+	if (counts.count[0] > counts.count[1]){
+		myHot = ifTrue;
+		myCold = ifFalse;
+	} else if (counts.count[1] > counts.count[0]){
+		myHot = ifFalse;
+		myCold = ifTrue;
+	}
+}
+
+/*
+* Anything emitted after a return lands in a fresh block with no
+* predecessors, which is dropped once the function is complete.
+*/
+void IRLowering::ret(int val){
+	terminate(IRTermKind::Return, val, -1, -1);
+	myBlock = newBlock();
+}
+
+/*
+* A variable's value may change while the rest of an expression is
+* evaluated (x + (x = 1)); copy it into a temporary first.
+*/
+int IRLowering::pin(int val){
+	if (val < 0 || myFn->isTemp(val)) return val;
+	return emitValue(IROp::Copy, myFn->vals[val].type, val);
+}
+
+int IRLowering::load(const IRLoc& loc){
+	if (!loc.structName.empty()){
+		throw std::runtime_error("Internal Error: struct variable"
+			" used as a value reached IR lowering");
+	}
+	switch (loc.kind){
+		case IRLoc::Value:
+			return loc.index;
+		case IRLoc::Slot:
+			return emitValue(IROp::Load, loc.type, -1, -1, loc.index);
+		case IRLoc::Global:
+			return emitValue(IROp::GLoad, loc.type, -1, -1, loc.index);
+	}
+	return -1;
+}
+
+void IRLowering::store(const IRLoc& loc, int val){
+	if (!loc.structName.empty() || val < 0){
+		throw std::runtime_error("Internal Error: invalid assignment"
+			" reached IR lowering");
+	}
+	switch (loc.kind){
+		case IRLoc::Value:
+			emit(IROp::Copy, loc.index, val);
+			break;
+		case IRLoc::Slot:
+			emit(IROp::Store, -1, val, -1, loc.index);
+			break;
+		case IRLoc::Global:
+			emit(IROp::GStore, -1, val, -1, loc.index);
+			break;
+	}
+}
+
+// Declarations
+
+/*
+* Every function is entered in the module before any body is
+* lowered so that calls can refer to it by index.
+*/
+void ProgramNode::lower(IRModule * module, bool probes){
+	IRLowering ir(module, probes);
+	ir.pushScope();
+	myDeclList->declareFunctions(&ir);
+	myDeclList->lower(&ir);
+	ir.popScope();
+}
+
+void DeclListNode::declareFunctions(IRLowering * ir){
+	for (DeclNode * decl : *myDecls){
+		decl->declareFunction(ir);
+	}
+}
+
+void DeclListNode::lower(IRLowering * ir){
+	for (DeclNode * decl : *myDecls){
+		decl->lower(ir);
+	}
+}
+
+void DeclListNode::lowerFields(IRLowering * ir, IRStructInfo * info){
+	for (DeclNode * decl : *myDecls){
+		decl->lowerField(ir, info);
+	}
+}
+
+void FnDeclNode::declareFunction(IRLowering * ir){
+	IRFunction fn;
+	fn.name = myId->getId();
+	fn.retType = irTypeOf(myType->getType());
+	fn.numFormals = myFormals->size();
+	fn.line = line();
+	ir->module()->functions.push_back(fn);
+}
+
+void FnDeclNode::lower(IRLowering * ir){
+	ir->beginFunction(ir->lookupFunction(myId->getId()), myProfile);
+	ir->probeEntry();
+	myFormals->lower(ir);
+	myBody->lower(ir);
+	ir->endFunction();
+}
+
+void FormalsListNode::lower(IRLowering * ir){
+	for (FormalDeclNode * formal : *myFormals){
+		formal->lower(ir);
+	}
+}
+
+void FormalDeclNode::lower(IRLowering * ir){
+	ir->declareFormal(myId->getId(), irTypeOf(myType->getType()));
+}
+
+void FnBodyNode::lower(IRLowering * ir){
+	myDeclList->lower(ir);
+	myStmtList->lower(ir);
+}
+
+void VarDeclNode::lower(IRLowering * ir){
+	std::string structName;
+	if (myType->getType() == "struct"){
+		structName = myType->getId();
+	}
+	ir->declareVar(myId->getId(), irTypeOf(myType->getType()), structName);
+}
+
+void VarDeclNode::lowerField(IRLowering * ir, IRStructInfo * info){
+	IRStructField field;
+	field.name = myId->getId();
+	field.offset = info->numSlots;
+	field.type = irTypeOf(myType->getType());
+	if (myType->getType() == "struct"){
+		field.structName = myType->getId();
+		info->numSlots += ir->findStruct(field.structName)->numSlots;
+	} else {
+		info->numSlots += 1;
+	}
+	info->fields.push_back(field);
+}
+
+void StructDeclNode::lower(IRLowering * ir){
+	IRStructInfo info;
+	info.numSlots = 0;
+	myDeclList->lowerFields(ir, &info);
+	ir->declareStruct(myId->getId(), info);
+}
+
+// Statements
+
+void StmtListNode::lower(IRLowering * ir){
+	for (StmtNode * stmt : *myStmts){
+		ir->setLine(stmt->line());
+		stmt->lower(ir);
+	}
+}
+
+void AssignStmtNode::lower(IRLowering * ir){
+	myAssign->lower(ir);
+}
+
+void PostIncStmtNode::lower(IRLowering * ir){
+	IRLoc loc = myExp->lowerLoc(ir);
+	int old = ir->load(loc);
+	int one = ir->emitValue(IROp::Const, IRType::Int, -1, -1, 1);
+	ir->store(loc, ir->emitValue(IROp::Add, IRType::Int, old, one));
+}
+
+void PostDecStmtNode::lower(IRLowering * ir){
+	IRLoc loc = myExp->lowerLoc(ir);
+	int old = ir->load(loc);
+	int one = ir->emitValue(IROp::Const, IRType::Int, -1, -1, 1);
+	ir->store(loc, ir->emitValue(IROp::Sub, IRType::Int, old, one));
+}
+
+/*
+* Input is always read as an integer; reading into a bool stores
+* whether the integer was nonzero.
+*/
+void ReadStmtNode::lower(IRLowering * ir){
+	IRLoc loc = myExp->lowerLoc(ir);
+	int val = ir->emitValue(IROp::Read, IRType::Int);
+	if (loc.type == IRType::Bool){
+		int zero = ir->emitValue(IROp::Const, IRType::Int, -1, -1, 0);
+		val = ir->emitValue(IROp::Ne, IRType::Bool, val, zero);
+	}
+	ir->store(loc, val);
+}
+
+void WriteStmtNode::lower(IRLowering * ir){
+	int str = myExp->lowerString(ir);
+	if (str >= 0){
+		ir->emit(IROp::WriteStr, -1, -1, -1, str);
+	} else {
+		ir->emit(IROp::Write, -1, myExp->lower(ir));
+	}
+}
+
+/*
+* A profiling run counts the times the test fails in a block of its
+* own on the way to the join.
+*/
+void IfStmtNode::lower(IRLowering * ir){
+	int thenBlock = ir->newBlock();
+	int joinBlock = ir->newBlock();
+	int skipBlock = ir->probing() && mySite >= 0 ? ir->newBlock() : joinBlock;
+	ir->expect(mySite, thenBlock, skipBlock);
+	myExp->lowerCond(ir, thenBlock, skipBlock);
+	ir->expect(-1, -1, -1);
+	if (skipBlock != joinBlock){
+		ir->setCurrent(skipBlock);
+		ir->probe(mySite, 1);
+		ir->jump(joinBlock);
+	}
+	ir->setCurrent(thenBlock);
+	ir->probe(mySite, 0);
+	ir->pushScope();
+	myDecls->lower(ir);
+	myStmts->lower(ir);
+	ir->popScope();
+	ir->jump(joinBlock);
+	ir->setCurrent(joinBlock);
+}
+
+void IfElseStmtNode::lower(IRLowering * ir){
+	int thenBlock = ir->newBlock();
+	int elseBlock = ir->newBlock();
+	int joinBlock = ir->newBlock();
+	ir->expect(mySite, thenBlock, elseBlock);
+	myExp->lowerCond(ir, thenBlock, elseBlock);
+	ir->expect(-1, -1, -1);
+	ir->setCurrent(thenBlock);
+	ir->probe(mySite, 0);
+	ir->pushScope();
+	myDeclsT->lower(ir);
+	myStmtsT->lower(ir);
+	ir->popScope();
+	ir->jump(joinBlock);
+	ir->setCurrent(elseBlock);
+	ir->probe(mySite, 1);
+	ir->pushScope();
+	myDeclsF->lower(ir);
+	myStmtsF->lower(ir);
+	ir->popScope();
+	ir->jump(joinBlock);
+	ir->setCurrent(joinBlock);
+}
+
+void WhileStmtNode::lower(IRLowering * ir){
+	int headBlock = ir->newBlock();
+	int bodyBlock = ir->newBlock();
+	int exitBlock = ir->newBlock();
+	ir->jump(headBlock);
+	ir->setCurrent(headBlock);
+	ir->expect(mySite, bodyBlock, exitBlock);
+	myExp->lowerCond(ir, bodyBlock, exitBlock);
+	ir->expect(-1, -1, -1);
+	ir->setCurrent(bodyBlock);
+	ir->probe(mySite, 0);
+	ir->pushScope();
+	myDecls->lower(ir);
+	myStmts->lower(ir);
+	ir->popScope();
+	ir->jump(headBlock);
+	ir->setCurrent(exitBlock);
+	ir->probe(mySite, 1);
+}
+
+void CallStmtNode::lower(IRLowering * ir){
+	myCallExp->lower(ir);
+}
+
+void ReturnStmtNode::lower(IRLowering * ir){
+	int val = -1;
+	if (myExp != nullptr){
+		val = myExp->lower(ir);
+	}
+	ir->ret(val);
+}
+
+// Expressions
+
+IRLoc ExpNode::lowerLoc(IRLowering * ir){
+	throw std::runtime_error("Internal Error: assignment to a"
+		" non-location reached IR lowering");
+}
+
+/*
+* By default a condition is computed as a value and tested; the
+* boolean operators override this to branch directly.
+*/
+void ExpNode::lowerCond(IRLowering * ir, int ifTrue, int ifFalse){
+	ir->branch(lower(ir), ifTrue, ifFalse);
+}
+
+IRLoc IdNode::lowerLoc(IRLowering * ir){
+	return ir->lookup(myStrVal);
+}
+
+int IdNode::lower(IRLowering * ir){
+	return ir->load(lowerLoc(ir));
+}
+
+IRLoc DotAccessNode::lowerLoc(IRLowering * ir){
+	IRLoc base = myExp->lowerLoc(ir);
+	const IRStructInfo * info = ir->findStruct(base.structName);
+	const IRStructField * field = nullptr;
+	if (info != nullptr){
+		field = info->findField(myId->getId());
+	}
+	if (field == nullptr){
+		throw std::runtime_error("Internal Error: invalid field access ."
+			+ myId->getId() + " reached IR lowering");
+	}
+	IRLoc loc;
+	loc.kind = base.kind;
+	loc.index = base.index + field->offset;
+	loc.type = field->type;
+	loc.structName = field->structName;
+	return loc;
+}
+
+int DotAccessNode::lower(IRLowering * ir){
+	return ir->load(lowerLoc(ir));
+}
+
+int IntLitNode::lower(IRLowering * ir){
+	return ir->emitValue(IROp::Const, IRType::Int, -1, -1, myInt);
+}
+
+/*
+* Strings can only be written; a write of a string literal refers
+* to it by its index in the module's string pool, which holds the
+* literals the module writes, each once.
+*/
+int ExpNode::lowerString(IRLowering * ir){
+	return -1;
+}
+
+int StrLitNode::lowerString(IRLowering * ir){
+	return ir->addString(myPool->text(myIndex), myPool->length(myIndex));
+}
+
+int StrLitNode::lower(IRLowering * ir){
+	throw std::runtime_error("Internal Error: string literal used"
+		" as a value reached IR lowering");
+}
+
+int TrueNode::lower(IRLowering * ir){
+	return ir->emitValue(IROp::Const, IRType::Bool, -1, -1, 1);
+}
+
+int FalseNode::lower(IRLowering * ir){
+	return ir->emitValue(IROp::Const, IRType::Bool, -1, -1, 0);
+}
+
+void TrueNode::lowerCond(IRLowering * ir, int ifTrue, int ifFalse){
+	ir->jump(ifTrue);
+}
+
+void FalseNode::lowerCond(IRLowering * ir, int ifTrue, int ifFalse){
+	ir->jump(ifFalse);
+}
+
+/*
+* An assignment's value is the value assigned.
+*/
+int AssignNode::lower(IRLowering * ir){
+	IRLoc loc = myExpLHS->lowerLoc(ir);
+	int val = myExpRHS->lower(ir);
+	ir->store(loc, val);
+	return val;
+}
+
+bool ExpListNode::hasSideEffects(){
+	for (ExpNode * exp : myExps){
+		if (exp->hasSideEffects()) return true;
+	}
+	return false;
+}
+
+/*
+* Evaluates the actuals left to right. An actual that is a variable
+* is pinned when a later actual could assign to it.
+*/
+void ExpListNode::lower(IRLowering * ir, std::list<int> * vals){
+	for (std::list<ExpNode *>::iterator it = myExps.begin();
+	  it != myExps.end(); ++it){
+		int val = (*it)->lower(ir);
+		for (std::list<ExpNode *>::iterator rest = std::next(it);
+		  rest != myExps.end(); ++rest){
+			if ((*rest)->hasSideEffects()){
+				val = ir->pin(val);
+				break;
+			}
+		}
+		vals->push_back(val);
+	}
+}
+
+/*
+* Arguments are evaluated first and then passed by a run of arg
+* instructions directly in front of the call.
+*/
+int CallExpNode::lower(IRLowering * ir){
+	ir->probe(mySite, 0);
+	int callee = ir->lookupFunction(myId->getId());
+	IRFunction & fn = ir->module()->functions[callee];
+	std::list<int> args;
+	myExpList->lower(ir, &args);
+	if ((int)args.size() != fn.numFormals){
+		throw std::runtime_error("Internal Error: call to " + fn.name
+			+ " with the wrong number of arguments reached IR lowering");
+	}
+	for (int arg : args){
+		ir->emit(IROp::Arg, -1, arg);
+	}
+	if (fn.retType == IRType::Void){
+		ir->emit(IROp::Call, -1, -1, -1, callee);
+		return -1;
+	}
+	return ir->emitValue(IROp::Call, fn.retType, -1, -1, callee);
+}
+
+bool UnaryMinusNode::hasSideEffects(){
+	return myExp->hasSideEffects();
+}
+
+int UnaryMinusNode::lower(IRLowering * ir){
+	return ir->emitValue(IROp::Neg, IRType::Int, myExp->lower(ir));
+}
+
+bool NotNode::hasSideEffects(){
+	return myExp->hasSideEffects();
+}
+
+int NotNode::lower(IRLowering * ir){
+	return ir->emitValue(IROp::Not, IRType::Bool, myExp->lower(ir));
+}
+
+void NotNode::lowerCond(IRLowering * ir, int ifTrue, int ifFalse){
+	myExp->lowerCond(ir, ifFalse, ifTrue);
+}
+
+static int lowerBinary(IRLowering * ir, IROp op, IRType type,
+  ExpNode * exp1, ExpNode * exp2){
+	int val1 = exp1->lower(ir);
+	if (exp2->hasSideEffects()){
+		val1 = ir->pin(val1);
+	}
+	int val2 = exp2->lower(ir);
+	return ir->emitValue(op, type, val1, val2);
+}
+
+/*
+* && and || produce their value through the same branches used
+* when they appear as conditions.
+*/
+static int lowerShortCircuit(IRLowering * ir, ExpNode * exp){
+	int result = ir->fn()->newValue(IRType::Bool);
+	int trueBlock = ir->newBlock();
+	int falseBlock = ir->newBlock();
+	int joinBlock = ir->newBlock();
+	exp->lowerCond(ir, trueBlock, falseBlock);
+	ir->setCurrent(trueBlock);
+	ir->emit(IROp::Const, result, -1, -1, 1);
+	ir->jump(joinBlock);
+	ir->setCurrent(falseBlock);
+	ir->emit(IROp::Const, result, -1, -1, 0);
+	ir->jump(joinBlock);
+	ir->setCurrent(joinBlock);
+	return result;
+}
+
+bool PlusNode::hasSideEffects(){
+	return myExp1->hasSideEffects() || myExp2->hasSideEffects();
+}
+
+int PlusNode::lower(IRLowering * ir){
+	return lowerBinary(ir, IROp::Add, IRType::Int, myExp1, myExp2);
+}
+
+bool MinusNode::hasSideEffects(){
+	return myExp1->hasSideEffects() || myExp2->hasSideEffects();
+}
+
+int MinusNode::lower(IRLowering * ir){
+	return lowerBinary(ir, IROp::Sub, IRType::Int, myExp1, myExp2);
+}
+
+bool TimesNode::hasSideEffects(){
+	return myExp1->hasSideEffects() || myExp2->hasSideEffects();
+}
+
+int TimesNode::lower(IRLowering * ir){
+	return lowerBinary(ir, IROp::Mul, IRType::Int, myExp1, myExp2);
+}
+
+bool DivideNode::hasSideEffects(){
+	return myExp1->hasSideEffects() || myExp2->hasSideEffects();
+}
+
+int DivideNode::lower(IRLowering * ir){
+	return lowerBinary(ir, IROp::Div, IRType::Int, myExp1, myExp2);
+}
+
+bool AndNode::hasSideEffects(){
+	return myExp1->hasSideEffects() || myExp2->hasSideEffects();
+}
+
+int AndNode::lower(IRLowering * ir){
+	return lowerShortCircuit(ir, this);
+}
+
+void AndNode::lowerCond(IRLowering * ir, int ifTrue, int ifFalse){
+	int rhsBlock = ir->newBlock();
+	myExp1->lowerCond(ir, rhsBlock, ifFalse);
+	ir->setCurrent(rhsBlock);
+	myExp2->lowerCond(ir, ifTrue, ifFalse);
+}
+
+bool OrNode::hasSideEffects(){
+	return myExp1->hasSideEffects() || myExp2->hasSideEffects();
+}
+
+int OrNode::lower(IRLowering * ir){
+	return lowerShortCircuit(ir, this);
+}
+
+void OrNode::lowerCond(IRLowering * ir, int ifTrue, int ifFalse){
+	int rhsBlock = ir->newBlock();
+	myExp1->lowerCond(ir, ifTrue, rhsBlock);
+	ir->setCurrent(rhsBlock);
+	myExp2->lowerCond(ir, ifTrue, ifFalse);
+}
+
+bool EqualsNode::hasSideEffects(){
+	return myExp1->hasSideEffects() || myExp2->hasSideEffects();
+}
+
+int EqualsNode::lower(IRLowering * ir){
+	return lowerBinary(ir, IROp::Eq, IRType::Bool, myExp1, myExp2);
+}
+
+bool NotEqualsNode::hasSideEffects(){
+	return myExp1->hasSideEffects() || myExp2->hasSideEffects();
+}
+
+int NotEqualsNode::lower(IRLowering * ir){
+	return lowerBinary(ir, IROp::Ne, IRType::Bool, myExp1, myExp2);
+}
+
+bool LessNode::hasSideEffects(){
+	return myExp1->hasSideEffects() || myExp2->hasSideEffects();
+}
+
+int LessNode::lower(IRLowering * ir){
+	return lowerBinary(ir, IROp::Lt, IRType::Bool, myExp1, myExp2);
+}
+
+bool GreaterNode::hasSideEffects(){
+	return myExp1->hasSideEffects() || myExp2->hasSideEffects();
+}
+
+int GreaterNode::lower(IRLowering * ir){
+	return lowerBinary(ir, IROp::Gt, IRType::Bool, myExp1, myExp2);
+}
+
+bool LessEqNode::hasSideEffects(){
+	return myExp1->hasSideEffects() || myExp2->hasSideEffects();
+}
+
+int LessEqNode::lower(IRLowering * ir){
+	return lowerBinary(ir, IROp::Le, IRType::Bool, myExp1, myExp2);
+}
+
+bool GreaterEqNode::hasSideEffects(){
+	return myExp1->hasSideEffects() || myExp2->hasSideEffects();
+}
+
+int GreaterEqNode::lower(IRLowering * ir){
+	return lowerBinary(ir, IROp::Ge, IRType::Bool, myExp1, myExp2);
+}
+
+} // End namespace LILC
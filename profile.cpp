@@ -0,0 +1,298 @@
+#include "ast.hpp"
+#include "profile.hpp"
+#include <sstream>
+
+namespace LILC{
+
+/*
+* Profiles are text: a header line, then per function a line
+* "function name hash entries" followed by one line per site in
+* order, "branch true false" or "call count callee". The hash is in
+* hex.
+*/
+
+static const char * const PROFILE_HEADER = "lilc-profile";
+static const int PROFILE_VERSION = 1;
+
+uint64_t profileHash(const std::string& text){
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : text){
+		hash ^= (unsigned char)c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool FnProfile::sameShape(const FnProfile& other) const{
+	if (hash != other.hash || sites.size() != other.sites.size()) return false;
+	for (size_t s = 0; s < sites.size(); s++){
+		if (sites[s].kind != other.sites[s].kind) return false;
+		if (sites[s].callee != other.sites[s].callee) return false;
+	}
+	return true;
+}
+
+bool Profile::read(std::istream& in){
+	std::string word;
+	int version;
+	if (!(in >> word >> version) || word != PROFILE_HEADER || version != PROFILE_VERSION){
+		return false;
+	}
+	FnProfile * fn = nullptr;
+	while (in >> word){
+		ProfileSite site{ProfileSite::Branch, "", {0, 0}};
+		if (word == "function"){
+			std::string name;
+			FnProfile counts;
+			if (!(in >> name >> std::hex >> counts.hash >> std::dec >> counts.entries)) return false;
+			fn = &(functions[name] = counts);
+		} else if (word == "branch" && fn != nullptr){
+			if (!(in >> site.count[0] >> site.count[1])) return false;
+			fn->sites.push_back(site);
+		} else if (word == "call" && fn != nullptr){
+			site.kind = ProfileSite::Call;
+			if (!(in >> site.count[0] >> site.callee)) return false;
+			fn->sites.push_back(site);
+		} else {
+			return false;
+		}
+	}
+	return in.eof();
+}
+
+void Profile::write(std::ostream& out) const{
+	out << PROFILE_HEADER << " " << PROFILE_VERSION << "\n";
+	for (const std::pair<const std::string, FnProfile> & fn : functions){
+		out << "function " << fn.first << " " << std::hex << fn.second.hash
+		  << std::dec << " " << fn.second.entries << "\n";
+		for (const ProfileSite & site : fn.second.sites){
+			if (site.kind == ProfileSite::Branch){
+				out << "branch " << site.count[0] << " " << site.count[1] << "\n";
+			} else {
+				out << "call " << site.count[0] << " " << site.callee << "\n";
+			}
+		}
+	}
+}
+
+FnProfile * Profile::match(const std::string& name, const FnProfile& shape){
+	std::map<std::string, FnProfile>::iterator found = functions.find(name);
+	if (found == functions.end() || !found->second.sameShape(shape)) return nullptr;
+	return &found->second;
+}
+
+void Profile::merge(const Profile& other){
+	for (const std::pair<const std::string, FnProfile> & fn : other.functions){
+		FnProfile * counts = match(fn.first, fn.second);
+		if (counts == nullptr) continue;
+		counts->entries += fn.second.entries;
+		for (size_t s = 0; s < counts->sites.size(); s++){
+			counts->sites[s].count[0] += fn.second.sites[s].count[0];
+			counts->sites[s].count[1] += fn.second.sites[s].count[1];
+		}
+	}
+}
+
+bool Profile::callCount(const std::string& caller, const std::string& callee, uint64_t & count) const{
+	std::map<std::string, FnProfile>::const_iterator found = functions.find(caller);
+	if (found == functions.end()) return false;
+	count = 0;
+	for (const ProfileSite & site : found->second.sites){
+		if (site.kind == ProfileSite::Call && site.callee == callee) count += site.count[0];
+	}
+	return true;
+}
+
+uint64_t Profile::totalCalls() const{
+	uint64_t total = 0;
+	for (const std::pair<const std::string, FnProfile> & fn : functions){
+		for (const ProfileSite & site : fn.second.sites){
+			if (site.kind == ProfileSite::Call) total += site.count[0];
+		}
+	}
+	return total;
+}
+
+/*
+* Numbering the sites of the AST. Runs right after type analysis,
+* before any pass rewrites a function, so that a profiling run and
+* the build using its profile number the same source alike; nodes
+* passes create later have no site. A function's hash is taken over
+* its unparsed source.
+*
+* Under -profile-use, each function whose counts in used still match
+* its source gets them. The counts of the others, stale or of
+* functions since removed, are then dropped from used, which keeps
+* only counts that apply.
+*/
+void ProgramNode::numberSites(Profile * shape, Profile * used, std::ostream * report){
+	myDeclList->numberSites(shape, used);
+	if (used == nullptr) return;
+	int stale = 0;
+	std::map<std::string, FnProfile>::iterator fn = used->functions.begin();
+	while (fn != used->functions.end()){
+		std::map<std::string, FnProfile>::iterator source = shape->functions.find(fn->first);
+		if (source != shape->functions.end() && fn->second.sameShape(source->second)){
+			++fn;
+			continue;
+		}
+		if (source != shape->functions.end()) stale++;
+		fn = used->functions.erase(fn);
+	}
+	if (report != nullptr){
+		*report << "profile: " << used->functions.size() << " of "
+		  << shape->functions.size() << " functions matched, "
+		  << stale << " stale" << std::endl;
+	}
+}
+
+void DeclListNode::numberSites(Profile * shape, Profile * used){
+	for (DeclNode * decl : *myDecls){
+		decl->numberSites(shape, used);
+	}
+}
+
+void FnDeclNode::numberSites(Profile * shape, Profile * used){
+	std::ostringstream source;
+	unparse(source, 0);
+	FnProfile & fn = shape->functions[getId()];
+	fn.hash = profileHash(source.str());
+	myBody->numberSites(&fn);
+	myProfile = used == nullptr ? nullptr : used->match(getId(), fn);
+}
+
+static int addSite(FnProfile * fn, ProfileSite::Kind kind, const std::string& callee){
+	fn->sites.push_back(ProfileSite{kind, callee, {0, 0}});
+	return fn->sites.size() - 1;
+}
+
+void FnBodyNode::numberSites(FnProfile * fn){
+	myStmtList->numberSites(fn);
+}
+
+void StmtListNode::numberSites(FnProfile * fn){
+	for (StmtNode * stmt : *myStmts){
+		stmt->numberSites(fn);
+	}
+}
+
+void AssignStmtNode::numberSites(FnProfile * fn){
+	myAssign->numberSites(fn);
+}
+
+void WriteStmtNode::numberSites(FnProfile * fn){
+	myExp->numberSites(fn);
+}
+
+void IfStmtNode::numberSites(FnProfile * fn){
+	mySite = addSite(fn, ProfileSite::Branch, "");
+	myExp->numberSites(fn);
+	myStmts->numberSites(fn);
+}
+
+void IfElseStmtNode::numberSites(FnProfile * fn){
+	mySite = addSite(fn, ProfileSite::Branch, "");
+	myExp->numberSites(fn);
+	myStmtsT->numberSites(fn);
+	myStmtsF->numberSites(fn);
+}
+
+void WhileStmtNode::numberSites(FnProfile * fn){
+	mySite = addSite(fn, ProfileSite::Branch, "");
+	myExp->numberSites(fn);
+	myStmts->numberSites(fn);
+}
+
+void CallStmtNode::numberSites(FnProfile * fn){
+	myCallExp->numberSites(fn);
+}
+
+void ReturnStmtNode::numberSites(FnProfile * fn){
+	if (myExp != nullptr) myExp->numberSites(fn);
+}
+
+void AssignNode::numberSites(FnProfile * fn){
+	myExpLHS->numberSites(fn);
+	myExpRHS->numberSites(fn);
+}
+
+void CallExpNode::numberSites(FnProfile * fn){
+	mySite = addSite(fn, ProfileSite::Call, myId->getId());
+	myExpList->numberSites(fn);
+}
+
+void ExpListNode::numberSites(FnProfile * fn){
+	for (ExpNode * exp : myExps){
+		exp->numberSites(fn);
+	}
+}
+
+void UnaryMinusNode::numberSites(FnProfile * fn){
+	myExp->numberSites(fn);
+}
+
+void NotNode::numberSites(FnProfile * fn){
+	myExp->numberSites(fn);
+}
+
+void PlusNode::numberSites(FnProfile * fn){
+	myExp1->numberSites(fn);
+	myExp2->numberSites(fn);
+}
+
+void MinusNode::numberSites(FnProfile * fn){
+	myExp1->numberSites(fn);
+	myExp2->numberSites(fn);
+}
+
+void TimesNode::numberSites(FnProfile * fn){
+	myExp1->numberSites(fn);
+	myExp2->numberSites(fn);
+}
+
+void DivideNode::numberSites(FnProfile * fn){
+	myExp1->numberSites(fn);
+	myExp2->numberSites(fn);
+}
+
+void AndNode::numberSites(FnProfile * fn){
+	myExp1->numberSites(fn);
+	myExp2->numberSites(fn);
+}
+
+void OrNode::numberSites(FnProfile * fn){
+	myExp1->numberSites(fn);
+	myExp2->numberSites(fn);
+}
+
+void EqualsNode::numberSites(FnProfile * fn){
+	myExp1->numberSites(fn);
+	myExp2->numberSites(fn);
+}
+
+void NotEqualsNode::numberSites(FnProfile * fn){
+	myExp1->numberSites(fn);
+	myExp2->numberSites(fn);
+}
+
+void LessNode::numberSites(FnProfile * fn){
+	myExp1->numberSites(fn);
+	myExp2->numberSites(fn);
+}
+
+void GreaterNode::numberSites(FnProfile * fn){
+	myExp1->numberSites(fn);
+	myExp2->numberSites(fn);
+}
+
+void LessEqNode::numberSites(FnProfile * fn){
+	myExp1->numberSites(fn);
+	myExp2->numberSites(fn);
+}
+
+void GreaterEqNode::numberSites(FnProfile * fn){
+	myExp1->numberSites(fn);
+	myExp2->numberSites(fn);
+}
+
+} // End namespace LILC
@@ -0,0 +1,66 @@
+#ifndef LILC_PROFILE_HPP
+#define LILC_PROFILE_HPP
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace LILC{
+
+/*
+* An execution profile, as a run on the VM under -profile-gen writes
+* it and -profile-use reads it back. Counts are kept per function:
+* how often it was entered, and for each of its sites, the if,
+* if-else and while statements and the calls in its body, numbered
+* in source order. A branch site counts how often its test held and
+* how often it failed, which is also how often each block of the
+* statement ran; a call site counts the calls made there.
+*
+* A function is known by its name and a hash of its source, so its
+* counts survive edits to the rest of the program and are dropped
+* once it changes itself.
+*/
+struct ProfileSite{
+	enum Kind { Branch, Call } kind;
+	std::string callee;  // for a call site
+	uint64_t count[2];   // true and false for a branch, calls in count[0]
+};
+
+struct FnProfile{
+	uint64_t hash = 0;
+	uint64_t entries = 0;
+	std::vector<ProfileSite> sites;
+
+	// Whether other describes the same source, counts aside
+	bool sameShape(const FnProfile& other) const;
+};
+
+class Profile{
+public:
+	// Returns false if in does not hold a well-formed profile
+	bool read(std::istream& in);
+	void write(std::ostream& out) const;
+
+	// The counts of function name if they were taken from source shaped like shape
+	FnProfile * match(const std::string& name, const FnProfile& shape);
+	// Adds the counts of every function of other shaped as here
+	void merge(const Profile& other);
+	/*
+	* Sets count to the calls caller made to callee, at all of its
+	* call sites. Returns false if caller has no counts.
+	*/
+	bool callCount(const std::string& caller, const std::string& callee, uint64_t & count) const;
+	uint64_t totalCalls() const;
+
+	std::map<std::string, FnProfile> functions;
+};
+
+// 64-bit FNV-1a, what a function's source is hashed with
+uint64_t profileHash(const std::string& text);
+
+} //End namespace LILC
+
+#endif
@@ -0,0 +1,295 @@
+#include "regalloc.hpp"
+#include "liveness.hpp"
+#include "ssa.hpp"
+#include <algorithm>
+
+namespace LILC{
+
+/*
+* Linear-scan register allocation (Poletto and Sarkar). Blocks are
+* laid out as IRFunction::layoutOrder has them and every
+* instruction, terminators included, gets two positions: operands are
+* read at the first and the result written at the second, so a value
+* dying at an instruction can hand its register to the one defined
+* there.
+* Formals are written at position 0, before the first block. A
+* value's live interval runs from the first to the last position
+* where it is live, taken from IRLiveness at block boundaries.
+*
+* Intervals are visited by start. An interval spanning a call (one
+* that is live both before and after it) may only take a
+* callee-saved register, since calls clobber the rest; any other
+* tries the caller-saved ones first, which cost nothing to use. A
+* copy's result prefers its operand's register, and a formal the
+* register it arrives in, so the move disappears (coalescing).
+*
+* With no register free, the interval spilled is the one, among the
+* current interval and the active ones holding a register it could
+* use, with the lowest spill cost: the number of its definitions and
+* uses, each weighted by 10 to the depth of the loops (the
+* WhileStmtNode bodies) it sits in, so values of inner loops keep
+* their registers. A constant, a value whose only definition is a
+* Const, costs nothing to spill: its uses become immediates and its
+* definition goes away (rematerialization). That matters once LICM
+* has hoisted the constants of a loop body out in front of it. Other
+* spilled values then share stack slots, a slot being free once the
+* interval of the value in it has ended.
+*/
+
+namespace {
+
+const char * const NAMES32[] = {
+	"%esi", "%edi", "%r8d", "%r9d", "%r10d", "%ebx", "%r12d", "%r13d", "%r14d", "%r15d"
+};
+const char * const NAMES64[] = {
+	"%rsi", "%rdi", "%r8", "%r9", "%r10", "%rbx", "%r12", "%r13", "%r14", "%r15"
+};
+
+// The registers formals arrive in, where the allocator has them
+const int ARG_REGS[] = {RDI, RSI, -1, -1, R8, R9};
+const int NUM_ARG_REGS = 6;
+
+bool isCall(IROp op){
+	return op == IROp::Call || op == IROp::Read || op == IROp::Write
+	  || op == IROp::WriteStr;
+}
+
+struct Interval{
+	int val;
+	int start = -1;
+	int end = -1;
+	double cost = 0;
+	bool crossesCall = false;
+	int hint = -1;  // value whose register this one would like
+	int defs = 0;
+	bool constant = false;
+};
+
+class LinearScan{
+public:
+	LinearScan(IRFunction& fn, RegAllocation& result)
+	: myFn(fn), myResult(result) {
+		myIntervals.resize(fn.vals.size());
+		for (size_t v = 0; v < fn.vals.size(); v++){
+			myIntervals[v].val = v;
+		}
+		result.reg.assign(fn.vals.size(), -1);
+		result.spillSlot.assign(fn.vals.size(), -1);
+		result.rematerialized.assign(fn.vals.size(), 0);
+	}
+
+	void buildIntervals(){
+		IRLiveness liveness(myFn);
+		std::vector<int> depth = loopDepths(myFn);
+		std::vector<int> calls;
+		for (int f = 0; f < myFn.numFormals; f++){
+			extend(f, 0);
+		}
+		int n = 1;
+		for (int b : myResult.order){
+			IRBlock & block = myFn.blocks[b];
+			double weight = 1;
+			for (int d = 0; d < depth[b]; d++){
+				weight *= 10;
+			}
+			int from = 2 * n;
+			int to = 2 * (n + block.insts.size()) + 1;
+			liveness.liveIn(b).forEach([&](size_t v){ extend(v, from); });
+			liveness.liveOut(b).forEach([&](size_t v){ extend(v, to); });
+			for (IRInst & inst : block.insts){
+				if (inst.a >= 0) use(inst.a, 2 * n, weight);
+				if (inst.b >= 0) use(inst.b, 2 * n, weight);
+				if (inst.dst >= 0){
+					use(inst.dst, 2 * n + 1, weight);
+					myIntervals[inst.dst].defs++;
+					if (inst.op == IROp::Copy) myIntervals[inst.dst].hint = inst.a;
+					if (inst.op == IROp::Const) myIntervals[inst.dst].constant = true;
+				}
+				if (isCall(inst.op)) calls.push_back(n);
+				n++;
+			}
+			if (block.term.val >= 0) use(block.term.val, 2 * n, weight);
+			n++;
+		}
+
+		// Only the first call after an interval's start can be spanned if any is
+		for (Interval & interval : myIntervals){
+			if (interval.start < 0) continue;
+			if (interval.val < myFn.numFormals || interval.defs != 1) interval.constant = false;
+			if (interval.constant) interval.cost = 0;
+			std::vector<int>::iterator call = std::upper_bound(calls.begin(),
+			  calls.end(), interval.start / 2);
+			if (call != calls.end() && interval.end > 2 * *call + 1){
+				interval.crossesCall = true;
+			}
+		}
+	}
+
+	void allocate(){
+		std::vector<Interval*> sorted;
+		for (Interval & interval : myIntervals){
+			if (interval.start >= 0) sorted.push_back(&interval);
+		}
+		std::stable_sort(sorted.begin(), sorted.end(),
+		  [](const Interval * x, const Interval * y){ return x->start < y->start; });
+
+		std::vector<Interval*> active;
+		std::vector<Interval*> spilled;
+		std::vector<char> free(NUM_X86_REGS, 1);
+		std::vector<char> used(NUM_X86_REGS, 0);
+		for (Interval * current : sorted){
+			for (size_t i = 0; i < active.size(); ){
+				if (active[i]->end < current->start){
+					free[myResult.reg[active[i]->val]] = 1;
+					active.erase(active.begin() + i);
+				} else {
+					i++;
+				}
+			}
+
+			int reg = chooseRegister(*current, free);
+			if (reg < 0){
+				Interval * victim = current;
+				for (Interval * other : active){
+					int otherReg = myResult.reg[other->val];
+					if (current->crossesCall && !isCalleeSaved(otherReg)) continue;
+					if (other->cost < victim->cost) victim = other;
+				}
+				if (victim->constant){
+					myResult.rematerialized[victim->val] = 1;
+				} else {
+					spilled.push_back(victim);
+				}
+				if (victim == current) continue;
+				reg = myResult.reg[victim->val];
+				myResult.reg[victim->val] = -1;
+				active.erase(std::find(active.begin(), active.end(), victim));
+			}
+			myResult.reg[current->val] = reg;
+			free[reg] = 0;
+			used[reg] = 1;
+			active.push_back(current);
+		}
+
+		for (int r = 0; r < NUM_X86_REGS; r++){
+			if (used[r] && isCalleeSaved(r)) myResult.calleeSaved.push_back(r);
+		}
+		assignSpillSlots(spilled);
+	}
+
+	void count(){
+		RegAllocStats & stats = myResult.stats;
+		for (Interval & interval : myIntervals){
+			if (interval.start < 0) continue;
+			if (myResult.reg[interval.val] >= 0){
+				stats.inRegisters++;
+			} else if (myResult.rematerialized[interval.val]){
+				stats.rematerialized++;
+			} else {
+				stats.spilled++;
+			}
+		}
+		auto spilled = [&](int val){ return val >= 0 && myResult.spillSlot[val] >= 0; };
+		for (IRBlock & block : myFn.blocks){
+			for (IRInst & inst : block.insts){
+				if (spilled(inst.a)) stats.reloads++;
+				if (spilled(inst.b)) stats.reloads++;
+				if (spilled(inst.dst)) stats.spillStores++;
+				if (inst.op == IROp::Copy && myResult.reg[inst.dst] >= 0
+				  && myResult.reg[inst.dst] == myResult.reg[inst.a]){
+					stats.coalesced++;
+				}
+			}
+			if (spilled(block.term.val)) stats.reloads++;
+		}
+		for (int f = 0; f < myFn.numFormals && f < NUM_ARG_REGS; f++){
+			if (myResult.reg[f] >= 0 && myResult.reg[f] == ARG_REGS[f]) stats.coalesced++;
+		}
+	}
+private:
+	void extend(int val, int pos){
+		Interval & interval = myIntervals[val];
+		if (interval.start < 0 || pos < interval.start) interval.start = pos;
+		if (pos > interval.end) interval.end = pos;
+	}
+
+	void use(int val, int pos, double weight){
+		extend(val, pos);
+		myIntervals[val].cost += weight;
+	}
+
+	/*
+	* A free register current may take: the one its hint has, if any,
+	* else a caller-saved one unless it spans a call, else a
+	* callee-saved one. -1 if there is none.
+	*/
+	int chooseRegister(const Interval& current, const std::vector<char>& free){
+		int hint = -1;
+		if (current.hint >= 0){
+			hint = myResult.reg[current.hint];
+		} else if (current.val < myFn.numFormals && current.val < NUM_ARG_REGS){
+			hint = ARG_REGS[current.val];
+		}
+		if (hint >= 0 && free[hint] && (!current.crossesCall || isCalleeSaved(hint))){
+			return hint;
+		}
+		for (int r = 0; r < NUM_X86_REGS; r++){
+			if (!free[r]) continue;
+			if (current.crossesCall && !isCalleeSaved(r)) continue;
+			return r;
+		}
+		return -1;
+	}
+
+	void assignSpillSlots(std::vector<Interval*>& spilled){
+		std::sort(spilled.begin(), spilled.end(),
+		  [](const Interval * x, const Interval * y){ return x->start < y->start; });
+		std::vector<int> slotEnd; // where the value in each slot dies
+		for (Interval * interval : spilled){
+			int slot = -1;
+			for (size_t s = 0; s < slotEnd.size(); s++){
+				if (slotEnd[s] < interval->start){
+					slot = s;
+					break;
+				}
+			}
+			if (slot < 0){
+				slot = slotEnd.size();
+				slotEnd.push_back(0);
+			}
+			slotEnd[slot] = interval->end;
+			myResult.spillSlot[interval->val] = slot;
+		}
+		myResult.numSpillSlots = slotEnd.size();
+	}
+
+	IRFunction & myFn;
+	RegAllocation & myResult;
+	std::vector<Interval> myIntervals;
+};
+
+} // End anonymous namespace
+
+const char * reg32Name(int reg){
+	return NAMES32[reg];
+}
+
+const char * reg64Name(int reg){
+	return NAMES64[reg];
+}
+
+bool isCalleeSaved(int reg){
+	return reg >= RBX;
+}
+
+RegAllocation allocateRegisters(IRFunction& fn){
+	RegAllocation result;
+	result.order = fn.layoutOrder();
+	LinearScan scan(fn, result);
+	scan.buildIntervals();
+	scan.allocate();
+	scan.count();
+	return result;
+}
+
+} // End namespace LILC
@@ -0,0 +1,58 @@
+#ifndef LILC_REGALLOC_HPP
+#define LILC_REGALLOC_HPP
+
+#include <vector>
+#include "ir.hpp"
+
+namespace LILC{
+
+/*
+* The x86-64 registers the allocator hands out. %rax, %rcx and %rdx
+* stay free for the code generator's own use (division and shifts
+* need them), as does %r11 for moving between two stack locations.
+* A value living across a call must go in a callee-saved register,
+* which the function then saves on entry and restores on return.
+*/
+enum X86Reg { RSI, RDI, R8, R9, R10, RBX, R12, R13, R14, R15, NUM_X86_REGS };
+
+const char * reg32Name(int reg);
+const char * reg64Name(int reg);
+bool isCalleeSaved(int reg);
+
+struct RegAllocStats{
+	int inRegisters = 0;    // values given a register
+	int spilled = 0;        // values kept on the stack
+	int rematerialized = 0; // constants used as immediates instead
+	int spillStores = 0;    // definitions of spilled values
+	int reloads = 0;        // uses of spilled values
+	int coalesced = 0;      // copies between values sharing a register
+};
+
+/*
+* Where each value of a function lives: in a register, in one of
+* numSpillSlots 4-byte stack slots, which spilled values whose live
+* intervals do not overlap share, or nowhere for a constant that is
+* rematerialized, its one Const written into each use as an
+* immediate. Values that never occur get none of these. order is
+* the block layout the intervals were numbered in, which the code
+* generator must follow.
+*/
+struct RegAllocation{
+	std::vector<int> reg;        // per value, -1 if not in a register
+	std::vector<int> spillSlot;  // per value, -1 if not spilled
+	std::vector<char> rematerialized; // per value
+	int numSpillSlots = 0;
+	std::vector<int> calleeSaved; // callee-saved registers used
+	std::vector<int> order;
+	RegAllocStats stats;
+};
+
+/*
+* Linear-scan register allocation over a function out of SSA form;
+* see regalloc.cpp.
+*/
+RegAllocation allocateRegisters(IRFunction& fn);
+
+} //End namespace LILC
+
+#endif
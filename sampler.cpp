@@ -0,0 +1,229 @@
+#include "sampler.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <sys/time.h>
+#include <ucontext.h>
+
+namespace LILC{
+
+namespace {
+
+// Words of the address buffer: over 30000 samples even at MAX_DEPTH
+const size_t ADDRESS_BUFFER = 1 << 22;
+
+// Lines listed in the report
+const size_t HOT_LINES = 20;
+
+// The sampler the timer is running for; there is one timer
+Sampler * running = nullptr;
+
+void setTimer(int interval){
+	struct itimerval timer;
+	timer.it_interval.tv_sec = interval / 1000000;
+	timer.it_interval.tv_usec = interval % 1000000;
+	timer.it_value = timer.it_interval;
+	setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+void writeCount(std::ostream& out, size_t count, size_t total){
+	std::ostringstream percent;
+	percent << std::fixed << std::setprecision(1) << (total == 0 ? 0.0 : 100.0 * count / total);
+	out << std::setw(8) << count << " " << std::setw(5) << percent.str() << "%";
+}
+
+} // End anonymous namespace
+
+volatile sig_atomic_t Sampler::due = 0;
+const void * volatile Sampler::at = nullptr;
+const void * volatile Sampler::dueAt = nullptr;
+volatile uintptr_t Sampler::callOut[2] = {0, 0};
+
+Sampler::Sampler(const std::vector<std::string>& names, const std::vector<int>& lines, int interval)
+: myNames(names), myLines(lines), myInterval(interval) {
+}
+
+Sampler::~Sampler(){
+	stop();
+}
+
+void Sampler::start(const void * stackTop){
+	if (running != nullptr) throw std::runtime_error("Internal Error: a sampler is already running");
+	myStackTop = (uintptr_t)stackTop;
+	if (myStackTop != 0 && !myAddresses){
+		myAddresses.reset(new uintptr_t[ADDRESS_BUFFER]);
+	}
+	due = 0;
+	running = this;
+	myRunning = true;
+	struct sigaction action;
+	action.sa_sigaction = &Sampler::onSignal;
+	action.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGPROF, &action, &myOldAction);
+	myStart = std::clock();
+	setTimer(myInterval);
+}
+
+void Sampler::stop(){
+	if (!myRunning) return;
+	setTimer(0);
+	mySeconds += (double)(std::clock() - myStart) / CLOCKS_PER_SEC;
+	sigaction(SIGPROF, &myOldAction, nullptr);
+	running = nullptr;
+	myRunning = false;
+	due = 0;
+}
+
+/*
+* Runs in the signal handler: may only touch memory set aside
+* before the timer started, and may only read the stack between the
+* interrupted code's stack pointer and the top it was given.
+*/
+void Sampler::onSignal(int sig, siginfo_t * info, void * context){
+	Sampler * sampler = running;
+	if (sampler == nullptr) return;
+	if (sampler->myStackTop == 0){
+		dueAt = at;
+		due = 1;
+	} else {
+		sampler->takeAddresses(context);
+	}
+}
+
+void Sampler::takeAddresses(void * context){
+	if (myAddressesUsed + 1 + MAX_DEPTH > ADDRESS_BUFFER){
+		myDropped++;
+		return;
+	}
+	const mcontext_t & regs = ((ucontext_t *)context)->uc_mcontext;
+	uintptr_t sp = regs.gregs[REG_RSP];
+	uintptr_t fp = regs.gregs[REG_RBP];
+	uintptr_t * sample = &myAddresses[myAddressesUsed];
+	size_t depth = 0;
+	sample[1 + depth++] = regs.gregs[REG_RIP];
+	uintptr_t callSp = callOut[0];
+	if (callSp != 0 && callSp - 8 >= sp && callSp <= myStackTop){
+		sample[1 + depth++] = *(const uintptr_t *)(callSp - 8);
+		fp = callOut[1];
+	}
+	while (depth < MAX_DEPTH && fp >= sp && fp + 16 <= myStackTop && fp % 8 == 0){
+		const uintptr_t * frame = (const uintptr_t *)fp;
+		sample[1 + depth++] = frame[1];
+		if (frame[0] <= fp) break;
+		fp = frame[0];
+	}
+	sample[0] = depth;
+	myAddressesUsed += 1 + depth;
+}
+
+void Sampler::add(const std::vector<SampleFrame>& stack){
+	mySamples.push_back(stack);
+}
+
+/*
+* A return address is the instruction after the call, so the call's
+* line is that of the address before it. Addresses outside compiled
+* code are dropped, except the innermost: the program was then in
+* the runtime, its input and output routines or the JIT compiling.
+*/
+void Sampler::resolve(const std::function<bool(uintptr_t, SampleFrame&)>& locate){
+	size_t at = 0;
+	while (at < myAddressesUsed){
+		size_t depth = myAddresses[at];
+		std::vector<SampleFrame> stack;
+		for (size_t i = depth; i > 0; i--){
+			uintptr_t address = myAddresses[at + i];
+			SampleFrame frame{-1, 0};
+			if (locate(i == 1 ? address : address - 1, frame)){
+				stack.push_back(frame);
+			} else if (i == 1){
+				stack.push_back(SampleFrame{-1, 0});
+			}
+		}
+		mySamples.push_back(stack);
+		at += 1 + depth;
+	}
+	myAddressesUsed = 0;
+}
+
+std::string Sampler::frameName(const SampleFrame& frame) const{
+	return frame.fn < 0 ? "(runtime)" : myNames[frame.fn];
+}
+
+void Sampler::writeReport(std::ostream& out) const{
+	size_t total = mySamples.size();
+	std::vector<size_t> self(myNames.size() + 1, 0);
+	std::vector<size_t> under(myNames.size() + 1, 0);
+	std::map<std::pair<int, int>, size_t> lines;
+	for (const std::vector<SampleFrame> & stack : mySamples){
+		if (stack.empty()) continue;
+		const SampleFrame & leaf = stack.back();
+		self[leaf.fn + 1]++;
+		// Time in the runtime is the line's that called it
+		const SampleFrame & at = leaf.fn < 0 && stack.size() > 1 ? stack[stack.size() - 2] : leaf;
+		lines[{at.fn, at.line}]++;
+		std::vector<char> seen(myNames.size() + 1, 0);
+		for (const SampleFrame & frame : stack){
+			if (!seen[frame.fn + 1]) under[frame.fn + 1]++;
+			seen[frame.fn + 1] = 1;
+		}
+	}
+
+	// The kernel may deliver the timer less often than asked
+	std::ostringstream seconds;
+	seconds << std::fixed << std::setprecision(2) << mySeconds;
+	out << "samples: " << total << " in " << seconds.str() << " s of CPU time, asked for every "
+	  << myInterval << " us";
+	if (myDropped > 0) out << ", " << myDropped << " dropped";
+	out << "\n\n";
+	std::vector<int> fns;
+	for (int fn = -1; fn < (int)myNames.size(); fn++){
+		if (under[fn + 1] > 0) fns.push_back(fn);
+	}
+	std::stable_sort(fns.begin(), fns.end(), [&](int x, int y){
+		return self[x + 1] != self[y + 1] ? self[x + 1] > self[y + 1] : under[x + 1] > under[y + 1];
+	});
+	out << "            self           total  function\n";
+	for (int fn : fns){
+		writeCount(out, self[fn + 1], total);
+		writeCount(out, under[fn + 1], total);
+		out << "  " << frameName(SampleFrame{fn, 0});
+		if (fn >= 0 && myLines[fn] > 0) out << " (line " << myLines[fn] << ")";
+		out << "\n";
+	}
+
+	std::vector<std::pair<std::pair<int, int>, size_t>> hot(lines.begin(), lines.end());
+	std::stable_sort(hot.begin(), hot.end(),
+	  [](const std::pair<std::pair<int, int>, size_t>& x, const std::pair<std::pair<int, int>, size_t>& y){
+		return x.second > y.second;
+	});
+	if (hot.size() > HOT_LINES) hot.resize(HOT_LINES);
+	out << "\n            self  source line\n";
+	for (const std::pair<std::pair<int, int>, size_t> & line : hot){
+		writeCount(out, line.second, total);
+		out << "  ";
+		if (line.first.second > 0) out << "line " << line.first.second << " in ";
+		out << frameName(SampleFrame{line.first.first, 0}) << "\n";
+	}
+}
+
+void Sampler::writeFolded(std::ostream& out) const{
+	std::map<std::string, size_t> stacks;
+	for (const std::vector<SampleFrame> & stack : mySamples){
+		if (stack.empty()) continue;
+		std::string folded;
+		for (const SampleFrame & frame : stack){
+			if (!folded.empty()) folded += ";";
+			folded += frameName(frame);
+		}
+		stacks[folded]++;
+	}
+	for (const std::pair<const std::string, size_t> & stack : stacks){
+		out << stack.first << " " << stack.second << "\n";
+	}
+}
+
+} // End namespace LILC
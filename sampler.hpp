@@ -0,0 +1,105 @@
+#ifndef LILC_SAMPLER_HPP
+#define LILC_SAMPLER_HPP
+
+#include <csignal>
+#include <ctime>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace LILC{
+
+/*
+* A sampling profiler for a running program. Every interval of CPU
+* time the program uses, SIGPROF interrupts it and the stack of calls
+* active then is taken, each frame as a function and the source line
+* it is at. On the VM the signal handler only notes that a sample is
+* due, and the VM takes it from its own frames soon after. For
+* machine code the JIT runs, the handler
+* copies the program counter and the return addresses along the
+* frame-pointer chain into a buffer set aside beforehand, and these
+* are resolved to functions and lines once the run is over.
+*
+* The samples are written as a flat report, functions by the samples
+* taken in them (self) and with them on the stack (total) and then
+* the hottest lines, and as folded stacks: one line per distinct
+* stack, outermost function first, with its count, as flame graph
+* tools read them.
+*/
+struct SampleFrame{
+	int fn;   // index into the Sampler's functions, -1 for the runtime
+	int line; // 0 if unknown
+};
+
+class Sampler{
+public:
+	// Functions by name and the line they are declared on
+	Sampler(const std::vector<std::string>& names, const std::vector<int>& lines,
+	  int interval = DEFAULT_INTERVAL);
+	~Sampler();
+	/*
+	* Starts the timer. For machine code, stackTop bounds the frames
+	* the handler walks: those of compiled code all lie below it.
+	*/
+	void start(const void * stackTop = nullptr);
+	void stop();
+
+	/*
+	* The VM stores in at where it is before each instruction; the
+	* handler copies that to dueAt and sets due, and the VM takes the
+	* sample at its next taken jump, call or return, before control
+	* leaves the code dueAt is in.
+	*/
+	static volatile sig_atomic_t due;
+	static const void * volatile at;
+	static const void * volatile dueAt;
+	/*
+	* Machine code stores its stack and frame pointers here as it
+	* calls into the runtime, and clears the first when back, so that
+	* samples taken there still find the call and its callers.
+	*/
+	static volatile uintptr_t callOut[2];
+	// Takes a sample of stack, outermost frame first
+	void add(const std::vector<SampleFrame>& stack);
+	/*
+	* Turns the addresses the handler took into samples. locate gives
+	* the function and line of an address in compiled code and
+	* returns false for any other.
+	*/
+	void resolve(const std::function<bool(uintptr_t, SampleFrame&)>& locate);
+
+	void writeReport(std::ostream& out) const;
+	void writeFolded(std::ostream& out) const;
+
+	static const int DEFAULT_INTERVAL = 1000; // microseconds of CPU time
+	static const size_t MAX_DEPTH = 128;      // frames, innermost first, kept of a stack
+private:
+	static void onSignal(int sig, siginfo_t * info, void * context);
+	void takeAddresses(void * context);
+	std::string frameName(const SampleFrame& frame) const;
+
+	std::vector<std::string> myNames;
+	std::vector<int> myLines;
+	int myInterval;
+	bool myRunning = false;
+	std::clock_t myStart = 0;
+	double mySeconds = 0; // of CPU time the timer ran for
+	std::vector<std::vector<SampleFrame>> mySamples;
+	/*
+	* What the handler takes from machine code: per sample its depth,
+	* then that many addresses, innermost first. Allocated before the
+	* timer starts, since the handler may not allocate.
+	*/
+	std::unique_ptr<uintptr_t[]> myAddresses;
+	size_t myAddressesUsed = 0;
+	size_t myDropped = 0;
+	uintptr_t myStackTop = 0;
+	struct sigaction myOldAction;
+};
+
+} //End namespace LILC
+
+#endif
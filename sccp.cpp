@@ -0,0 +1,247 @@
+#include "ssa.hpp"
+#include <set>
+#include <utility>
+
+namespace LILC{
+
+/*
+* Sparse conditional constant propagation (Wegman and Zadeck).
+* Every SSA value starts out unknown (TOP) and only moves down the
+* lattice to a constant and then to "not a constant" (BOTTOM).
+* Blocks are only evaluated once an edge into them is known to be
+* executable, so constants flowing into branches that can never be
+* taken, or around loops whose exits are decided at compile time,
+* are found where folding a single expression cannot see them.
+*/
+
+namespace {
+
+enum Lattice { TOP, CONST, BOTTOM };
+
+// Where a value is used: an instruction, a phi or a terminator.
+struct SSAUse{
+	int block;
+	int kind;
+	int index;
+};
+const int USE_INST = 0;
+const int USE_PHI = 1;
+const int USE_TERM = 2;
+
+class SCCPSolver{
+public:
+	SCCPSolver(IRFunction& fn) : myFn(fn){
+		fn.computePreds();
+		size_t numVals = fn.vals.size();
+		myState.assign(numVals, TOP);
+		myConst.assign(numVals, 0);
+		myUses.assign(numVals, std::vector<SSAUse>());
+		myExecutable.assign(fn.blocks.size(), 0);
+		for (int f = 0; f < fn.numFormals; f++){
+			myState[f] = BOTTOM;
+		}
+		for (size_t b = 0; b < fn.blocks.size(); b++){
+			IRBlock & block = fn.blocks[b];
+			for (size_t i = 0; i < block.phis.size(); i++){
+				for (int arg : block.phis[i].args){
+					myUses[arg].push_back(SSAUse{(int)b, USE_PHI, (int)i});
+				}
+			}
+			for (size_t i = 0; i < block.insts.size(); i++){
+				IRInst & inst = block.insts[i];
+				if (inst.a >= 0) myUses[inst.a].push_back(SSAUse{(int)b, USE_INST, (int)i});
+				if (inst.b >= 0) myUses[inst.b].push_back(SSAUse{(int)b, USE_INST, (int)i});
+			}
+			if (block.term.val >= 0){
+				myUses[block.term.val].push_back(SSAUse{(int)b, USE_TERM, 0});
+			}
+		}
+	}
+
+	void solve(){
+		myEdgeWork.push_back({-1, 0});
+		while (!myEdgeWork.empty() || !myValWork.empty()){
+			while (!myEdgeWork.empty()){
+				std::pair<int, int> edge = myEdgeWork.back();
+				myEdgeWork.pop_back();
+				int b = edge.second;
+				IRBlock & block = myFn.blocks[b];
+				for (size_t i = 0; i < block.phis.size(); i++){
+					visitPhi(b, i);
+				}
+				if (!myExecutable[b]){
+					myExecutable[b] = 1;
+					for (size_t i = 0; i < block.insts.size(); i++){
+						visitInst(b, i);
+					}
+					visitTerm(b);
+				}
+			}
+			while (!myValWork.empty()){
+				int val = myValWork.back();
+				myValWork.pop_back();
+				for (SSAUse & use : myUses[val]){
+					if (!myExecutable[use.block]) continue;
+					if (use.kind == USE_PHI) visitPhi(use.block, use.index);
+					else if (use.kind == USE_INST) visitInst(use.block, use.index);
+					else visitTerm(use.block);
+				}
+			}
+		}
+	}
+
+	/*
+	* Replaces every value proven constant by a constant, and every
+	* branch on a constant by a jump.
+	*/
+	int rewrite(){
+		int folded = 0;
+		for (size_t b = 0; b < myFn.blocks.size(); b++){
+			if (!myExecutable[b]) continue;
+			IRBlock & block = myFn.blocks[b];
+			std::vector<IRPhi> phis;
+			std::vector<IRInst> consts;
+			for (IRPhi & phi : block.phis){
+				if (myState[phi.dst] == CONST){
+					consts.push_back(IRInst{IROp::Const, phi.dst, -1, -1, myConst[phi.dst]});
+					folded++;
+				} else {
+					phis.push_back(phi);
+				}
+			}
+			block.phis.swap(phis);
+			for (IRInst & inst : block.insts){
+				if (inst.dst < 0 || inst.op == IROp::Const) continue;
+				if (irHasSideEffects(inst.op) || myState[inst.dst] != CONST) continue;
+				inst = IRInst{IROp::Const, inst.dst, -1, -1, myConst[inst.dst], inst.line};
+				folded++;
+			}
+			block.insts.insert(block.insts.begin(), consts.begin(), consts.end());
+			IRTerm & term = block.term;
+			if (term.kind == IRTermKind::Branch && myState[term.val] == CONST
+			  && term.succ[0] != term.succ[1]){
+				int taken = myConst[term.val] ? term.succ[0] : term.succ[1];
+				int dropped = myConst[term.val] ? term.succ[1] : term.succ[0];
+				for (IRPhi & phi : myFn.blocks[dropped].phis){
+					for (size_t i = 0; i < phi.blocks.size(); i++){
+						if (phi.blocks[i] != (int)b) continue;
+						phi.blocks.erase(phi.blocks.begin() + i);
+						phi.args.erase(phi.args.begin() + i);
+						break;
+					}
+				}
+				term = IRTerm{IRTermKind::Jump, -1, {taken, -1}};
+				folded++;
+			}
+		}
+		myFn.removeUnreachable();
+		return folded;
+	}
+private:
+	void lower(int val, int state, int c){
+		if (myState[val] == BOTTOM || state == TOP) return;
+		if (myState[val] == CONST){
+			if (state == CONST && myConst[val] == c) return;
+			state = BOTTOM;
+		}
+		myState[val] = state;
+		myConst[val] = c;
+		myValWork.push_back(val);
+	}
+
+	void markEdge(int from, int to){
+		if (myEdges.insert({from, to}).second){
+			myEdgeWork.push_back({from, to});
+		}
+	}
+
+	void visitPhi(int b, int i){
+		IRPhi & phi = myFn.blocks[b].phis[i];
+		int state = TOP;
+		int c = 0;
+		for (size_t k = 0; k < phi.args.size(); k++){
+			if (myEdges.count({phi.blocks[k], b}) == 0) continue;
+			int arg = phi.args[k];
+			if (myState[arg] == TOP) continue;
+			if (myState[arg] == BOTTOM || (state == CONST && myConst[arg] != c)){
+				state = BOTTOM;
+				break;
+			}
+			state = CONST;
+			c = myConst[arg];
+		}
+		lower(phi.dst, state, c);
+	}
+
+	void visitInst(int b, int i){
+		IRInst & inst = myFn.blocks[b].insts[i];
+		if (inst.dst < 0) return;
+		switch (inst.op){
+			case IROp::Const:
+				lower(inst.dst, CONST, inst.imm);
+				return;
+			case IROp::Copy:
+				lower(inst.dst, myState[inst.a], myConst[inst.a]);
+				return;
+			default:
+				break;
+		}
+		bool unary = inst.op == IROp::Neg || inst.op == IROp::Not;
+		if (!unary && !irIsBinary(inst.op)){
+			lower(inst.dst, BOTTOM, 0);
+			return;
+		}
+		int stateA = myState[inst.a];
+		int stateB = unary ? CONST : myState[inst.b];
+		if (stateA == BOTTOM || stateB == BOTTOM){
+			lower(inst.dst, BOTTOM, 0);
+			return;
+		}
+		if (stateA == TOP || stateB == TOP) return;
+		int result;
+		int valB = unary ? 0 : myConst[inst.b];
+		if (irFold(inst.op, myConst[inst.a], valB, result)){
+			lower(inst.dst, CONST, result);
+		} else {
+			lower(inst.dst, BOTTOM, 0);
+		}
+	}
+
+	void visitTerm(int b){
+		IRTerm & term = myFn.blocks[b].term;
+		switch (term.kind){
+			case IRTermKind::Jump:
+				markEdge(b, term.succ[0]);
+				break;
+			case IRTermKind::Branch:
+				if (myState[term.val] == CONST){
+					markEdge(b, myConst[term.val] ? term.succ[0] : term.succ[1]);
+				} else if (myState[term.val] == BOTTOM){
+					markEdge(b, term.succ[0]);
+					markEdge(b, term.succ[1]);
+				}
+				break;
+			case IRTermKind::Return:
+				break;
+		}
+	}
+
+	IRFunction & myFn;
+	std::vector<char> myState;
+	std::vector<int> myConst;
+	std::vector<std::vector<SSAUse>> myUses;
+	std::vector<char> myExecutable;
+	std::set<std::pair<int, int>> myEdges;
+	std::vector<std::pair<int, int>> myEdgeWork;
+	std::vector<int> myValWork;
+};
+
+} // End anonymous namespace
+
+int sccp(IRFunction& fn){
+	SCCPSolver solver(fn);
+	solver.solve();
+	return solver.rewrite();
+}
+
+} // End namespace LILC
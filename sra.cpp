@@ -0,0 +1,66 @@
+#include "ssa.hpp"
+
+namespace LILC{
+
+/*
+* Scalar replacement of aggregates. Lowering flattens a local
+* struct variable (a VarDeclNode of StructNode type) into a run of
+* frame slots, one per scalar field with nested structs included,
+* laid out by the StructDeclNode's field list, and resolves every
+* DotAccessNode chain to one fixed slot. A struct can only ever be
+* reached through such accesses: it is never assigned, passed or
+* returned as a whole, and nothing takes its address. So no slot
+* escapes, and each becomes a value of its own, named after its
+* field path (p.pos.x), that SSA construction and every later pass
+* treat like any scalar local, down to register allocation.
+*
+* Fields that are never accessed are dropped instead. A struct
+* variable counts as split when at least one of its fields is used.
+*/
+
+SRAStats scalarReplace(IRFunction& fn){
+	SRAStats stats;
+	if (fn.slots.empty()) return stats;
+	std::vector<char> used(fn.slots.size(), 0);
+	for (IRBlock & block : fn.blocks){
+		for (IRInst & inst : block.insts){
+			if (inst.op == IROp::Load) used[inst.imm] = 1;
+		}
+	}
+
+	// Stores to a field nobody loads become copies into a value
+	// nobody reads, which cleanupSSA deletes.
+	std::vector<int> fieldVals;
+	std::vector<char> split(fn.slots.size(), 0);
+	for (size_t s = 0; s < fn.slots.size(); s++){
+		IRSlot & slot = fn.slots[s];
+		fieldVals.push_back(fn.newValue(slot.type, used[s] ? slot.name : ""));
+		if (!used[s]){
+			stats.unused++;
+			continue;
+		}
+		stats.fields++;
+		if (!split[slot.first]) stats.structs++;
+		split[slot.first] = 1;
+	}
+
+	// Rewritten in place, so the instruction keeps everything else
+	// it carries
+	for (IRBlock & block : fn.blocks){
+		for (IRInst & inst : block.insts){
+			if (inst.op == IROp::Load){
+				inst.op = IROp::Copy;
+				inst.a = fieldVals[inst.imm];
+				inst.imm = 0;
+			} else if (inst.op == IROp::Store){
+				inst.op = IROp::Copy;
+				inst.dst = fieldVals[inst.imm];
+				inst.imm = 0;
+			}
+		}
+	}
+	fn.slots.clear();
+	return stats;
+}
+
+} // End namespace LILC
@@ -0,0 +1,444 @@
+#include "ssa.hpp"
+#include <algorithm>
+
+namespace LILC{
+
+// Dominators
+
+DomTree::DomTree(IRFunction& fn){
+	size_t numBlocks = fn.blocks.size();
+	fn.computePreds();
+	myRPO = fn.reversePostorder();
+	std::vector<int> order(numBlocks, -1);
+	for (size_t i = 0; i < myRPO.size(); i++){
+		order[myRPO[i]] = i;
+	}
+	myIdom.assign(numBlocks, -1);
+	myIdom[0] = 0;
+	auto intersect = [&](int a, int b){
+		while (a != b){
+			while (order[a] > order[b]) a = myIdom[a];
+			while (order[b] > order[a]) b = myIdom[b];
+		}
+		return a;
+	};
+	bool changed = true;
+	while (changed){
+		changed = false;
+		for (size_t i = 1; i < myRPO.size(); i++){
+			int b = myRPO[i];
+			int newIdom = -1;
+			for (int pred : fn.blocks[b].preds){
+				if (myIdom[pred] < 0) continue;
+				newIdom = newIdom < 0 ? pred : intersect(pred, newIdom);
+			}
+			if (myIdom[b] != newIdom){
+				myIdom[b] = newIdom;
+				changed = true;
+			}
+		}
+	}
+	myIdom[0] = -1;
+
+	myChildren.assign(numBlocks, std::vector<int>());
+	myDepth.assign(numBlocks, 0);
+	for (int b : myRPO){
+		if (myIdom[b] < 0) continue;
+		myChildren[myIdom[b]].push_back(b);
+		myDepth[b] = myDepth[myIdom[b]] + 1;
+	}
+
+	myFrontier.assign(numBlocks, std::vector<int>());
+	for (int b : myRPO){
+		if (fn.blocks[b].preds.size() < 2) continue;
+		for (int pred : fn.blocks[b].preds){
+			if (order[pred] < 0) continue;
+			for (int runner = pred; runner != myIdom[b]; runner = myIdom[runner]){
+				std::vector<int> & df = myFrontier[runner];
+				if (df.empty() || df.back() != b) df.push_back(b);
+				if (runner == 0) break;
+			}
+		}
+	}
+}
+
+bool DomTree::dominates(int a, int b) const{
+	while (myDepth[b] > myDepth[a]){
+		b = myIdom[b];
+	}
+	return a == b;
+}
+
+// SSA construction
+
+namespace {
+
+/*
+* Renames every definition of a variable apart while walking the
+* dominator tree, keeping a stack of the reaching definition of
+* each original variable.
+*/
+class SSARenamer{
+public:
+	SSARenamer(IRFunction& fn, DomTree& dom,
+	  std::vector<std::vector<int>>& phiVars)
+	: myFn(fn), myDom(dom), myPhiVars(phiVars){
+		size_t numVars = fn.vals.size();
+		myStacks.assign(numVars, std::vector<int>());
+		myDefined.assign(numVars, 0);
+		myVersions.assign(numVars, 0);
+		for (int f = 0; f < fn.numFormals; f++){
+			myStacks[f].push_back(f);
+			myDefined[f] = 1;
+		}
+	}
+
+	void rename(int b){
+		IRBlock & block = myFn.blocks[b];
+		std::vector<int> pushed;
+		for (size_t i = 0; i < block.phis.size(); i++){
+			int var = myPhiVars[b][i];
+			block.phis[i].dst = define(var);
+			pushed.push_back(var);
+		}
+		for (IRInst & inst : block.insts){
+			if (inst.a >= 0) inst.a = reaching(inst.a);
+			if (inst.b >= 0) inst.b = reaching(inst.b);
+			if (inst.dst >= 0){
+				int var = inst.dst;
+				inst.dst = define(var);
+				pushed.push_back(var);
+			}
+		}
+		if (block.term.val >= 0){
+			block.term.val = reaching(block.term.val);
+		}
+		for (int s = 0; s < block.numSuccs(); s++){
+			int succ = block.term.succ[s];
+			IRBlock & succBlock = myFn.blocks[succ];
+			for (size_t i = 0; i < succBlock.phis.size(); i++){
+				succBlock.phis[i].args.push_back(reaching(myPhiVars[succ][i]));
+				succBlock.phis[i].blocks.push_back(b);
+			}
+		}
+		for (int child : myDom.children(b)){
+			rename(child);
+		}
+		for (std::vector<int>::reverse_iterator var = pushed.rbegin();
+		  var != pushed.rend(); ++var){
+			myStacks[*var].pop_back();
+		}
+	}
+
+	/*
+	* A use that no definition reaches reads the same zero every
+	* declared local starts with.
+	*/
+	void finish(){
+		if (myUndef < 0) return;
+		IRBlock & entry = myFn.blocks[0];
+		entry.insts.insert(entry.insts.begin(),
+			IRInst{IROp::Const, myUndef, -1, -1, 0});
+	}
+private:
+	int reaching(int var){
+		if (!myStacks[var].empty()) return myStacks[var].back();
+		if (myUndef < 0) myUndef = myFn.newValue(IRType::Int);
+		return myUndef;
+	}
+
+	// The first definition reached keeps the variable's own number.
+	int define(int var){
+		int val = var;
+		if (myDefined[var]){
+			std::string name = myFn.vals[var].name;
+			if (!name.empty()){
+				name += ".v" + std::to_string(++myVersions[var]);
+			}
+			val = myFn.newValue(myFn.vals[var].type, name);
+		}
+		myDefined[var] = 1;
+		myStacks[var].push_back(val);
+		return val;
+	}
+
+	IRFunction & myFn;
+	DomTree & myDom;
+	std::vector<std::vector<int>> & myPhiVars;
+	std::vector<std::vector<int>> myStacks;
+	std::vector<char> myDefined;
+	std::vector<int> myVersions;
+	int myUndef = -1;
+};
+
+} // End anonymous namespace
+
+/*
+* Semi-pruned SSA: phis are only placed for variables that are
+* read in some block before being written there, since no other
+* variable can be live across a block boundary.
+*/
+void buildSSA(IRFunction& fn){
+	DomTree dom(fn);
+	size_t numVars = fn.vals.size();
+	size_t numBlocks = fn.blocks.size();
+
+	std::vector<std::vector<int>> defBlocks(numVars);
+	std::vector<char> crossesBlocks(numVars, 0);
+	std::vector<int> definedIn(numVars, -1);
+	for (int f = 0; f < fn.numFormals; f++){
+		defBlocks[f].push_back(0);
+	}
+	for (size_t b = 0; b < numBlocks; b++){
+		IRBlock & block = fn.blocks[b];
+		auto use = [&](int val){
+			if (val >= 0 && definedIn[val] != (int)b) crossesBlocks[val] = 1;
+		};
+		for (IRInst & inst : block.insts){
+			use(inst.a);
+			use(inst.b);
+			if (inst.dst >= 0 && definedIn[inst.dst] != (int)b){
+				definedIn[inst.dst] = b;
+				std::vector<int> & defs = defBlocks[inst.dst];
+				if (defs.empty() || defs.back() != (int)b) defs.push_back(b);
+			}
+		}
+		use(block.term.val);
+	}
+
+	std::vector<std::vector<int>> phiVars(numBlocks);
+	std::vector<int> hasPhi(numBlocks, -1);
+	std::vector<int> queued(numBlocks, -1);
+	for (size_t var = 0; var < numVars; var++){
+		if (!crossesBlocks[var]) continue;
+		std::vector<int> work = defBlocks[var];
+		for (int b : work) queued[b] = var;
+		while (!work.empty()){
+			int b = work.back();
+			work.pop_back();
+			for (int d : dom.frontier(b)){
+				if (hasPhi[d] == (int)var) continue;
+				hasPhi[d] = var;
+				fn.blocks[d].phis.push_back(IRPhi{(int)var, {}, {}});
+				phiVars[d].push_back(var);
+				if (queued[d] != (int)var){
+					queued[d] = var;
+					work.push_back(d);
+				}
+			}
+		}
+	}
+
+	SSARenamer renamer(fn, dom, phiVars);
+	renamer.rename(0);
+	renamer.finish();
+}
+
+// SSA destruction
+
+/*
+* Appends the parallel copy dsts[i] = srcs[i] to insts as a
+* sequence of ordinary copies. A copy is only emitted once no other
+* pending copy still needs to read its destination; what is left
+* after that are cycles (a swap, say), each broken by saving one
+* destination in a fresh temporary.
+*/
+static void sequentialize(IRFunction& fn, std::vector<int> dsts,
+  std::vector<int> srcs, std::vector<IRInst>& insts){
+	for (size_t i = 0; i < dsts.size(); ){
+		if (dsts[i] == srcs[i]){
+			dsts.erase(dsts.begin() + i);
+			srcs.erase(srcs.begin() + i);
+		} else {
+			i++;
+		}
+	}
+	while (!dsts.empty()){
+		bool progress = false;
+		for (size_t i = 0; i < dsts.size(); i++){
+			if (std::find(srcs.begin(), srcs.end(), dsts[i]) != srcs.end()) continue;
+			insts.push_back(IRInst{IROp::Copy, dsts[i], srcs[i], -1, 0});
+			dsts.erase(dsts.begin() + i);
+			srcs.erase(srcs.begin() + i);
+			progress = true;
+			break;
+		}
+		if (progress) continue;
+		int saved = dsts[0];
+		int temp = fn.newValue(fn.vals[saved].type);
+		insts.push_back(IRInst{IROp::Copy, temp, saved, -1, 0});
+		for (int & src : srcs){
+			if (src == saved) src = temp;
+		}
+	}
+}
+
+/*
+* Replaces the phis of each block by a parallel copy at the end of
+* every predecessor. Critical edges are split first so that the
+* copies only run on the edge they belong to, which rules out the
+* lost-copy problem; sequentializing each parallel copy takes care
+* of the swap problem.
+*/
+void destroySSA(IRFunction& fn){
+	fn.computePreds();
+	size_t numBlocks = fn.blocks.size();
+	for (size_t b = 0; b < numBlocks; b++){
+		if (fn.blocks[b].phis.empty()) continue;
+		std::vector<int> preds = fn.blocks[b].preds;
+		if (preds.size() < 2) continue;
+		std::sort(preds.begin(), preds.end());
+		preds.erase(std::unique(preds.begin(), preds.end()), preds.end());
+		for (int pred : preds){
+			if (fn.blocks[pred].numSuccs() > 1) fn.splitEdge(pred, b);
+		}
+	}
+	for (size_t b = 0; b < fn.blocks.size(); b++){
+		std::vector<IRPhi> phis;
+		phis.swap(fn.blocks[b].phis);
+		if (phis.empty()) continue;
+		std::vector<int> preds;
+		for (int pred : phis[0].blocks){
+			if (std::find(preds.begin(), preds.end(), pred) == preds.end()){
+				preds.push_back(pred);
+			}
+		}
+		for (int pred : preds){
+			std::vector<int> dsts;
+			std::vector<int> srcs;
+			for (IRPhi & phi : phis){
+				for (size_t i = 0; i < phi.blocks.size(); i++){
+					if (phi.blocks[i] != pred) continue;
+					dsts.push_back(phi.dst);
+					srcs.push_back(phi.args[i]);
+					break;
+				}
+			}
+			sequentialize(fn, dsts, srcs, fn.blocks[pred].insts);
+		}
+	}
+}
+
+// Cleanup
+
+/*
+* Follows a chain of replacements to its end; gives up on cycles,
+* which only dead phis can form.
+*/
+static int resolve(const std::vector<int>& map, int val){
+	for (size_t steps = 0; map[val] >= 0; steps++){
+		if (steps > map.size()) return -1;
+		val = map[val];
+	}
+	return val;
+}
+
+void cleanupSSA(IRFunction& fn){
+	bool changed = true;
+	while (changed){
+		changed = false;
+		std::vector<int> map(fn.vals.size(), -1);
+		for (IRBlock & block : fn.blocks){
+			std::vector<IRPhi> kept;
+			for (IRPhi & phi : block.phis){
+				int same = -1;
+				bool trivial = true;
+				for (int arg : phi.args){
+					if (arg == phi.dst || arg == same) continue;
+					if (same >= 0){
+						trivial = false;
+						break;
+					}
+					same = arg;
+				}
+				if (trivial && same >= 0){
+					map[phi.dst] = same;
+				} else {
+					kept.push_back(phi);
+				}
+			}
+			block.phis.swap(kept);
+			std::vector<IRInst> insts;
+			for (IRInst & inst : block.insts){
+				if (inst.op == IROp::Copy){
+					map[inst.dst] = inst.a;
+				} else {
+					insts.push_back(inst);
+				}
+			}
+			block.insts.swap(insts);
+		}
+		std::vector<int> resolved(map.size(), -1);
+		for (size_t v = 0; v < map.size(); v++){
+			if (map[v] < 0) continue;
+			resolved[v] = resolve(map, v);
+			changed = true;
+		}
+		fn.renameUses(resolved);
+		if (fn.simplifyCFG()) changed = true;
+	}
+
+	// Mark everything that feeds a side effect, a trap or a terminator
+	size_t numVals = fn.vals.size();
+	std::vector<const IRInst *> defInst(numVals, nullptr);
+	std::vector<const IRPhi *> defPhi(numVals, nullptr);
+	std::vector<char> live(numVals, 0);
+	std::vector<char> isConst(numVals, 0);
+	std::vector<int> constVal(numVals, 0);
+	std::vector<int> work;
+	auto mark = [&](int val){
+		if (val >= 0 && !live[val]){
+			live[val] = 1;
+			work.push_back(val);
+		}
+	};
+	for (IRBlock & block : fn.blocks){
+		for (IRPhi & phi : block.phis){
+			defPhi[phi.dst] = &phi;
+		}
+		for (IRInst & inst : block.insts){
+			if (inst.dst < 0) continue;
+			defInst[inst.dst] = &inst;
+			if (inst.op == IROp::Const){
+				isConst[inst.dst] = 1;
+				constVal[inst.dst] = inst.imm;
+			}
+		}
+	}
+	for (IRBlock & block : fn.blocks){
+		for (IRInst & inst : block.insts){
+			if (irHasSideEffects(inst.op) || irCanTrap(inst, isConst, constVal)){
+				mark(inst.a);
+				mark(inst.b);
+			}
+		}
+		mark(block.term.val);
+	}
+	while (!work.empty()){
+		int val = work.back();
+		work.pop_back();
+		if (defInst[val] != nullptr){
+			mark(defInst[val]->a);
+			mark(defInst[val]->b);
+		}
+		if (defPhi[val] != nullptr){
+			for (int arg : defPhi[val]->args) mark(arg);
+		}
+	}
+	for (IRBlock & block : fn.blocks){
+		std::vector<IRPhi> phis;
+		for (IRPhi & phi : block.phis){
+			if (live[phi.dst]) phis.push_back(phi);
+		}
+		block.phis.swap(phis);
+		std::vector<IRInst> insts;
+		for (IRInst & inst : block.insts){
+			if (inst.dst >= 0 && !live[inst.dst] && !irHasSideEffects(inst.op)
+			  && !irCanTrap(inst, isConst, constVal)) continue;
+			insts.push_back(inst);
+		}
+		block.insts.swap(insts);
+	}
+}
+
+} // End namespace LILC
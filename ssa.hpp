@@ -0,0 +1,128 @@
+#ifndef LILC_SSA_HPP
+#define LILC_SSA_HPP
+
+#include <vector>
+#include "ir.hpp"
+
+namespace LILC{
+
+/*
+* Dominator tree of an IRFunction's CFG, computed with the
+* iterative algorithm of Cooper, Harvey and Kennedy over the
+* reverse postorder, plus each block's dominance frontier.
+*/
+class DomTree{
+public:
+	DomTree(IRFunction& fn);
+	int idom(int block) const { return myIdom[block]; }
+	const std::vector<int>& children(int block) const { return myChildren[block]; }
+	const std::vector<int>& frontier(int block) const { return myFrontier[block]; }
+	const std::vector<int>& rpo() const { return myRPO; }
+	bool dominates(int a, int b) const;
+	int depth(int block) const { return myDepth[block]; }
+private:
+	std::vector<int> myIdom;
+	std::vector<std::vector<int>> myChildren;
+	std::vector<std::vector<int>> myFrontier;
+	std::vector<int> myRPO;
+	std::vector<int> myDepth;
+};
+
+/*
+* Scalar replacement of aggregates: splits each local struct, a run
+* of frame slots, into one plain value per field, ahead of SSA
+* construction; see sra.cpp.
+*/
+struct SRAStats{
+	int structs = 0;  // struct variables split
+	int fields = 0;   // fields turned into values
+	int unused = 0;   // fields never accessed, dropped
+};
+SRAStats scalarReplace(IRFunction& fn);
+
+/*
+* Tail-recursion elimination, ahead of SSA construction: each call
+* fn, function self of its module, makes to itself in tail position
+* becomes an assignment of the arguments to the formals and a jump
+* back to the top of the body; see tailcall.cpp. Returns how many.
+*/
+int eliminateTailRecursion(IRFunction& fn, int self);
+
+/*
+* SSA construction and destruction. buildSSA places phis at the
+* iterated dominance frontier of each variable's definitions and
+* renames every definition apart. destroySSA splits critical edges
+* and replaces the phis of a block by a sequentialized parallel copy
+* at the end of each predecessor.
+*/
+void buildSSA(IRFunction& fn);
+void destroySSA(IRFunction& fn);
+
+/*
+* Sparse conditional constant propagation over SSA form. Returns
+* the number of values and branches it folded.
+*/
+int sccp(IRFunction& fn);
+
+/*
+* Global value numbering over SSA form, scoped to the dominator
+* tree. numGlobals is the number of the module's global slots,
+* which calls may write. Returns what it eliminated.
+*/
+struct GVNStats{
+	int exprs = 0;  // arithmetic and comparisons
+	int loads = 0;  // loads of a field or global already known
+	int phis = 0;   // phis duplicating another phi of their block
+};
+GVNStats gvn(IRFunction& fn, int numGlobals);
+
+/*
+* A natural loop: a header dominating the source of an edge back
+* into it, plus every block reaching such a source without passing
+* through the header.
+*/
+struct Loop{
+	int header;
+	std::vector<char> body; // indexed by block
+	int size;
+};
+
+// The natural loops of fn, one per header, innermost (smallest) first
+std::vector<Loop> findLoops(IRFunction& fn, const DomTree& dom);
+
+/*
+* Loop-invariant code motion over SSA form: gives every natural
+* loop a preheader and moves invariant, non-trapping instructions
+* into it.
+*/
+struct LICMStats{
+	int loops = 0;
+	int hoisted = 0;
+};
+LICMStats licm(IRFunction& fn);
+
+/*
+* Strength reduction over SSA form: products of induction variables
+* and constants become additive recurrences, and multiplications and
+* divisions by powers of two become shifts.
+*/
+struct StrengthStats{
+	int ivs = 0;          // basic induction variables found
+	int recurrences = 0;  // multiplications made additive
+	int shifts = 0;       // multiplications made shifts
+	int divisions = 0;    // divisions made shifts
+};
+StrengthStats strengthReduce(IRFunction& fn);
+
+// How many natural loops each block of fn is nested in
+std::vector<int> loopDepths(IRFunction& fn);
+
+/*
+* Copy propagation, removal of trivial phis and of instructions
+* whose results are never used, over SSA form.
+*/
+void cleanupSSA(IRFunction& fn);
+
+} //End namespace LILC
+
+#endif
@@ -0,0 +1,262 @@
+#include "ssa.hpp"
+#include <map>
+#include <tuple>
+
+namespace LILC{
+
+/*
+* Strength reduction over SSA form, run once loops have preheaders.
+*
+* A basic induction variable is a loop header phi with a single
+* argument from inside the loop, that argument being the phi plus
+* or minus a constant; this is what a PostIncStmtNode or
+* PostDecStmtNode on a local lowers to. A product of a constant and
+* an induction variable (possibly offset by a constant, as in
+* (i + 1) * 4) becomes a phi of its own, starting at the product's
+* value on entry and stepping by the induction variable's step times
+* the constant, updated right where the induction variable is.
+* Arithmetic wraps at 32 bits, so the sums always equal the products.
+*
+* Then multiplications by a power of two become left shifts, and
+* divisions by one arithmetic right shifts. LIL'C division
+* truncates toward zero while a shift rounds down, so a negative
+* dividend first gets 2^k - 1 added, computed without a branch from
+* its sign bit: (a + ((a >> 31) >>> (32 - k))) >> k.
+*/
+
+namespace {
+
+struct InductionVar{
+	int phi;
+	int init;   // value entering the loop
+	int step;
+	int next;   // phi + step, fed back to the header
+	int pre;    // the block init comes from
+};
+
+class StrengthReducer{
+public:
+	StrengthReducer(IRFunction& fn) : myFn(fn) {
+		for (IRBlock & block : fn.blocks){
+			for (IRInst & inst : block.insts){
+				if (inst.op != IROp::Const) continue;
+				myConsts[inst.dst] = inst.imm;
+			}
+		}
+	}
+
+	void reduceLoop(const Loop& loop, StrengthStats& stats){
+		std::vector<InductionVar> ivs;
+		for (IRPhi & phi : myFn.blocks[loop.header].phis){
+			InductionVar iv;
+			if (findInduction(loop, phi, iv)) ivs.push_back(iv);
+		}
+		stats.ivs += ivs.size();
+		if (ivs.empty()) return;
+
+		// Values that are an induction variable plus a constant
+		std::map<int, std::pair<int, int>> affine;
+		for (size_t i = 0; i < ivs.size(); i++){
+			affine[ivs[i].phi] = {i, 0};
+		}
+		for (size_t b = 0; b < myFn.blocks.size(); b++){
+			if (!loop.body[b]) continue;
+			for (IRInst & inst : myFn.blocks[b].insts){
+				if (inst.op != IROp::Add && inst.op != IROp::Sub) continue;
+				int offset;
+				std::map<int, std::pair<int, int>>::iterator found = affine.find(inst.a);
+				if (found != affine.end() && constant(inst.b, offset)){
+					if (inst.op == IROp::Sub) offset = (int)(0u - (unsigned int)offset);
+				} else if (inst.op == IROp::Add && constant(inst.a, offset)){
+					found = affine.find(inst.b);
+					if (found == affine.end()) continue;
+				} else {
+					continue;
+				}
+				std::pair<int, int> base = found->second;
+				affine[inst.dst] = {base.first, wrapAdd(base.second, offset)};
+			}
+		}
+
+		// One new phi per (induction variable, offset, factor)
+		std::map<std::tuple<int, int, int>, int> recurrences;
+		for (size_t b = 0; b < myFn.blocks.size(); b++){
+			if (!loop.body[b]) continue;
+			for (size_t i = 0; i < myFn.blocks[b].insts.size(); i++){
+				IRInst inst = myFn.blocks[b].insts[i];
+				if (inst.op != IROp::Mul) continue;
+				int factor;
+				int operand = inst.a;
+				if (!constant(inst.b, factor)){
+					operand = inst.b;
+					if (!constant(inst.a, factor)) continue;
+				}
+				std::map<int, std::pair<int, int>>::iterator found = affine.find(operand);
+				if (found == affine.end() || factor == 0 || factor == 1) continue;
+				std::tuple<int, int, int> key{found->second.first, found->second.second, factor};
+				if (!recurrences.count(key)){
+					recurrences[key] = addRecurrence(loop, ivs[found->second.first],
+					  found->second.second, factor);
+				}
+				// The update may have gone into this block, ahead of the product
+				while (myFn.blocks[b].insts[i].dst != inst.dst) i++;
+				myFn.blocks[b].insts[i] = IRInst{IROp::Copy, inst.dst, recurrences[key], -1, 0, inst.line};
+				stats.recurrences++;
+			}
+		}
+	}
+
+	void reducePowersOfTwo(StrengthStats& stats){
+		for (IRBlock & block : myFn.blocks){
+			std::vector<IRInst> insts;
+			for (IRInst & inst : block.insts){
+				int factor;
+				int shift;
+				if (inst.op == IROp::Mul && (constant(inst.b, factor) || constant(inst.a, factor))
+				  && (shift = log2(factor)) > 0){
+					int operand = constant(inst.b, factor) ? inst.a : inst.b;
+					insts.push_back(IRInst{IROp::Shl, inst.dst, operand, newConst(insts, shift), 0, inst.line});
+					stats.shifts++;
+				} else if (inst.op == IROp::Div && constant(inst.b, factor)
+				  && (shift = log2(factor)) > 0){
+					int sign = myFn.newValue(IRType::Int);
+					int bias = myFn.newValue(IRType::Int);
+					int biased = myFn.newValue(IRType::Int);
+					insts.push_back(IRInst{IROp::Sar, sign, inst.a, newConst(insts, 31), 0, inst.line});
+					insts.push_back(IRInst{IROp::Shr, bias, sign, newConst(insts, 32 - shift), 0, inst.line});
+					insts.push_back(IRInst{IROp::Add, biased, inst.a, bias, 0, inst.line});
+					insts.push_back(IRInst{IROp::Sar, inst.dst, biased, newConst(insts, shift), 0, inst.line});
+					stats.divisions++;
+				} else {
+					insts.push_back(inst);
+				}
+			}
+			block.insts.swap(insts);
+		}
+	}
+private:
+	bool constant(int val, int& result){
+		std::map<int, int>::iterator found = myConsts.find(val);
+		if (found == myConsts.end()) return false;
+		result = found->second;
+		return true;
+	}
+
+	static int wrapAdd(int a, int b){
+		return (int)((unsigned int)a + (unsigned int)b);
+	}
+
+	static int wrapMul(int a, int b){
+		return (int)((unsigned int)a * (unsigned int)b);
+	}
+
+	// k when n is 2^k, -1 otherwise
+	static int log2(int n){
+		if (n <= 0 || (n & (n - 1)) != 0) return -1;
+		int k = 0;
+		while ((1 << k) != n) k++;
+		return k;
+	}
+
+	int newConst(std::vector<IRInst>& insts, int value){
+		int val = myFn.newValue(IRType::Int);
+		insts.push_back(IRInst{IROp::Const, val, -1, -1, value});
+		myConsts[val] = value;
+		return val;
+	}
+
+	/*
+	* Whether phi, a phi of loop's header, is a basic induction
+	* variable, and if so, its description.
+	*/
+	bool findInduction(const Loop& loop, IRPhi& phi, InductionVar& iv){
+		if (phi.args.size() != 2) return false;
+		int inside = loop.body[phi.blocks[0]] ? 0 : 1;
+		if (!loop.body[phi.blocks[inside]] || loop.body[phi.blocks[1 - inside]]){
+			return false;
+		}
+		iv = InductionVar{phi.dst, phi.args[1 - inside], 0, phi.args[inside], phi.blocks[1 - inside]};
+		const IRInst * def = definition(iv.next);
+		if (def == nullptr) return false;
+		if (def->op == IROp::Add && def->a == phi.dst && constant(def->b, iv.step)) return true;
+		if (def->op == IROp::Add && def->b == phi.dst && constant(def->a, iv.step)) return true;
+		if (def->op == IROp::Sub && def->a == phi.dst && constant(def->b, iv.step)){
+			iv.step = (int)(0u - (unsigned int)iv.step);
+			return true;
+		}
+		return false;
+	}
+
+	const IRInst * definition(int val){
+		for (IRBlock & block : myFn.blocks){
+			for (IRInst & inst : block.insts){
+				if (inst.dst == val) return &inst;
+			}
+		}
+		return nullptr;
+	}
+
+	/*
+	* Adds a header phi equal to (iv + offset) * factor on every
+	* iteration and returns it. Its initial value and step are computed
+	* at the end of the block entering the loop, the initial value
+	* folded if iv's is a constant; its update follows iv's.
+	*/
+	int addRecurrence(const Loop& loop, InductionVar& iv, int offset, int factor){
+		std::vector<IRInst> entry;
+		int start;
+		int init;
+		if (constant(iv.init, init)){
+			start = newConst(entry, wrapMul(wrapAdd(init, offset), factor));
+		} else {
+			int base = iv.init;
+			if (offset != 0){
+				base = myFn.newValue(IRType::Int);
+				entry.push_back(IRInst{IROp::Add, base, iv.init, newConst(entry, offset), 0});
+			}
+			start = myFn.newValue(IRType::Int);
+			entry.push_back(IRInst{IROp::Mul, start, base, newConst(entry, factor), 0});
+		}
+		int step = newConst(entry, wrapMul(iv.step, factor));
+		std::vector<IRInst> & preInsts = myFn.blocks[iv.pre].insts;
+		preInsts.insert(preInsts.end(), entry.begin(), entry.end());
+
+		int phi = myFn.newValue(IRType::Int);
+		int next = myFn.newValue(IRType::Int);
+		int latch = -1;
+		for (IRPhi & other : myFn.blocks[loop.header].phis){
+			if (other.dst != iv.phi) continue;
+			latch = other.blocks[0] == iv.pre ? other.blocks[1] : other.blocks[0];
+		}
+		myFn.blocks[loop.header].phis.push_back(IRPhi{phi, {start, next}, {iv.pre, latch}});
+
+		for (IRBlock & block : myFn.blocks){
+			for (size_t i = 0; i < block.insts.size(); i++){
+				if (block.insts[i].dst != iv.next) continue;
+				block.insts.insert(block.insts.begin() + i + 1, IRInst{IROp::Add, next, phi, step, 0});
+				return phi;
+			}
+		}
+		return phi;
+	}
+
+	IRFunction & myFn;
+	std::map<int, int> myConsts;
+};
+
+} // End anonymous namespace
+
+StrengthStats strengthReduce(IRFunction& fn){
+	StrengthStats stats;
+	fn.computePreds();
+	DomTree dom(fn);
+	std::vector<Loop> loops = findLoops(fn, dom);
+	StrengthReducer reducer(fn);
+	for (Loop & loop : loops){
+		reducer.reduceLoop(loop, stats);
+	}
+	reducer.reducePowersOfTwo(stats);
+	return stats;
+}
+
+} // End namespace LILC
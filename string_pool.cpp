@@ -0,0 +1,91 @@
+#include "string_pool.hpp"
+#include <cstring>
+
+namespace LILC{
+
+namespace {
+
+// FNV-1a
+uint32_t hashText(const char * text, size_t length){
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++){
+		hash ^= (unsigned char)text[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+} // End anonymous namespace
+
+/*
+* The scanner only passes on literals whose escapes are \n, \t, \',
+* \", \? and \\; the last four stand for the character escaped.
+*/
+int StringPool::addLiteral(const std::string& literal){
+	std::string text;
+	for (size_t i = 1; i + 1 < literal.size(); i++){
+		char c = literal[i];
+		if (c == '\\' && i + 2 < literal.size()){
+			c = literal[++i];
+			if (c == 'n') c = '\n';
+			else if (c == 't') c = '\t';
+		}
+		text += c;
+	}
+	return add(text);
+}
+
+int StringPool::add(const char * text, size_t length){
+	uint32_t hash = hashText(text, length);
+	if (!myTable.empty()){
+		int found = myTable[slot(text, length, hash)];
+		if (found >= 0) return found;
+	}
+	if (2 * (size() + 1) > myTable.size()) grow();
+	int index = size();
+	myStarts.push_back(myChars.size());
+	myLengths.push_back(length);
+	myHashes.push_back(hash);
+	myChars.insert(myChars.end(), text, text + length);
+	myChars.push_back('\0');
+	myTable[slot(text, length, hash)] = index;
+	return index;
+}
+
+// Where text is in the table, or the empty entry it would go in
+size_t StringPool::slot(const char * text, size_t length, uint32_t hash) const{
+	size_t mask = myTable.size() - 1;
+	for (size_t at = hash & mask; ; at = (at + 1) & mask){
+		int index = myTable[at];
+		if (index < 0) return at;
+		if (myHashes[index] == hash && myLengths[index] == length
+		  && std::memcmp(myChars.data() + myStarts[index], text, length) == 0){
+			return at;
+		}
+	}
+}
+
+void StringPool::grow(){
+	myTable.assign(myTable.empty() ? 16 : 2 * myTable.size(), -1);
+	size_t mask = myTable.size() - 1;
+	for (size_t index = 0; index < size(); index++){
+		size_t at = myHashes[index] & mask;
+		while (myTable[at] >= 0) at = (at + 1) & mask;
+		myTable[at] = index;
+	}
+}
+
+std::string StringPool::literal(int index) const{
+	std::string out = "\"";
+	const char * chars = text(index);
+	for (size_t i = 0; i < length(index); i++){
+		char c = chars[i];
+		if (c == '\n') out += "\\n";
+		else if (c == '\t') out += "\\t";
+		else if (c == '"' || c == '\\') out += std::string("\\") + c;
+		else out += c;
+	}
+	return out + "\"";
+}
+
+} // End namespace LILC
@@ -0,0 +1,46 @@
+#ifndef LILC_STRING_POOL_HPP
+#define LILC_STRING_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace LILC{
+
+/*
+* The string literals of a program, each kept once. A literal is
+* unescaped as it is added, and adding text already in the pool
+* gives back the index it got the first time, found through a hash
+* table. The texts lie end to end in one buffer, each ended by a NUL
+* so that it can be handed to the runtime as it is; pointers into
+* the buffer stay valid until the next add.
+*/
+class StringPool{
+public:
+	// Adds a literal as the source spells it, quotes and escapes included
+	int addLiteral(const std::string& literal);
+	// Adds text already unescaped
+	int add(const char * text, size_t length);
+	int add(const std::string& text) { return add(text.data(), text.size()); }
+
+	size_t size() const { return myStarts.size(); }
+	bool empty() const { return myStarts.empty(); }
+	const char * text(int index) const { return myChars.data() + myStarts[index]; }
+	size_t length(int index) const { return myLengths[index]; }
+	// The text spelled back as a LIL'C literal, for dumps and unparsing
+	std::string literal(int index) const;
+private:
+	size_t slot(const char * text, size_t length, uint32_t hash) const;
+	void grow();
+
+	std::vector<char> myChars;
+	std::vector<size_t> myStarts;
+	std::vector<size_t> myLengths;
+	std::vector<uint32_t> myHashes;
+	std::vector<int> myTable; // indices by hash, -1 where empty; a power of two long
+};
+
+} //End namespace LILC
+
+#endif
@@ -0,0 +1,363 @@
+#include "ast.hpp"
+#include "profile.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace LILC{
+
+/*
+* Struct layout. Runs after dead-store elimination and decides the
+* order of each struct's fields, which lowering flattens them in and
+* the C backend declares them in, so every backend gets the same
+* layout. An int takes 4 bytes aligned to 4 and a bool 1 byte; a
+* nested struct takes its own size and alignment, and a struct's
+* size is rounded up to its largest alignment, as a C compiler would.
+* Every struct-typed VarDeclNode, field or variable, gets its size.
+*
+* Declared keeps the source order. Packed, the default under -O,
+* sorts the fields by decreasing alignment, which with alignments
+* that are powers of two leaves no padding between them. Hot first
+* puts the fields accessed at least a quarter as often as the
+* struct's hottest one, then the rest, each group packed, so that the
+* hot fields share the start of the struct and its cache line. The
+* accesses counted are the DotAccessNodes naming the field, each
+* weighted by LOOP_WEIGHT for every loop around it, or, in functions
+* with counts from -profile-use, by how often its block ran.
+*/
+
+static const double LOOP_WEIGHT = 10;
+
+struct FieldShape{
+	DeclNode * decl;
+	int size;
+	int align;
+	bool hot;
+};
+
+static int sizeOf(const std::vector<FieldShape>& fields, int & align){
+	int size = 0;
+	align = 1;
+	for (const FieldShape & field : fields){
+		size = (size + field.align - 1) / field.align * field.align + field.size;
+		align = std::max(align, field.align);
+	}
+	return (size + align - 1) / align * align;
+}
+
+void ProgramNode::layoutStructs(LayoutMode mode, std::ostream * report){
+	myDeclList->layoutStructs(mode, report);
+}
+
+/*
+* Structs are declared before their use, so laying them out in order
+* knows the size of every nested struct by the time it is needed.
+*/
+void DeclListNode::layoutStructs(LayoutMode mode, std::ostream * report){
+	LayoutContext ctx;
+	countFieldUses(&ctx);
+	for (DeclNode * decl : *myDecls){
+		StructDeclNode * structDecl = dynamic_cast<StructDeclNode *>(decl);
+		if (structDecl != nullptr) structDecl->layout(&ctx, mode, report);
+	}
+	for (VarDeclNode * var : ctx.structVars){
+		int size, align;
+		var->layoutShape(&ctx, size, align);
+	}
+}
+
+void DeclListNode::countFieldUses(LayoutContext * ctx){
+	for (DeclNode * decl : *myDecls){
+		decl->countFieldUses(ctx);
+	}
+}
+
+void DeclListNode::declareFields(LayoutContext * ctx, const std::string& structName){
+	for (DeclNode * decl : *myDecls){
+		static_cast<VarDeclNode *>(decl)->declareField(ctx, structName);
+	}
+}
+
+void DeclListNode::layoutFields(LayoutContext * ctx, const std::string& structName,
+  LayoutMode mode, std::ostream * report){
+	std::vector<FieldShape> fields;
+	double hottest = 0;
+	for (DeclNode * decl : *myDecls){
+		FieldShape field;
+		field.decl = decl;
+		static_cast<VarDeclNode *>(decl)->layoutShape(ctx, field.size, field.align);
+		fields.push_back(field);
+		hottest = std::max(hottest, ctx->heat[structName + "." + decl->getId()]);
+	}
+	for (FieldShape & field : fields){
+		double heat = ctx->heat[structName + "." + field.decl->getId()];
+		field.hot = heat > 0 && heat * 4 >= hottest;
+	}
+
+	int align;
+	int declared = sizeOf(fields, align);
+	if (mode != LayoutMode::Declared){
+		bool byHeat = mode == LayoutMode::Hot;
+		std::stable_sort(fields.begin(), fields.end(),
+		  [byHeat](const FieldShape& a, const FieldShape& b){
+			if (byHeat && a.hot != b.hot) return a.hot;
+			return a.align > b.align;
+		});
+	}
+	int size = sizeOf(fields, align);
+	ctx->sizes[structName] = size;
+	ctx->aligns[structName] = align;
+
+	myDecls->clear();
+	for (FieldShape & field : fields){
+		myDecls->push_back(field.decl);
+	}
+	if (report != nullptr){
+		*report << "layout " << structName << ": " << size << " bytes, "
+		  << declared << " as declared:";
+		for (FieldShape & field : fields){
+			*report << " " << field.decl->getId();
+		}
+		*report << std::endl;
+	}
+}
+
+void StructDeclNode::countFieldUses(LayoutContext * ctx){
+	ctx->structs[myId->getId()] = this;
+	myDeclList->declareFields(ctx, myId->getId());
+}
+
+void StructDeclNode::layout(LayoutContext * ctx, LayoutMode mode, std::ostream * report){
+	myDeclList->layoutFields(ctx, myId->getId(), mode, report);
+}
+
+void VarDeclNode::declareField(LayoutContext * ctx, const std::string& structName){
+	if (myType->getType() == "struct"){
+		ctx->fieldStructs[structName + "." + myId->getId()] = myType->getId();
+		ctx->structVars.push_back(this);
+	}
+}
+
+void VarDeclNode::countFieldUses(LayoutContext * ctx){
+	if (myType->getType() == "struct"){
+		ctx->varStructs[myId->getId()] = myType->getId();
+		ctx->structVars.push_back(this);
+	}
+}
+
+void VarDeclNode::layoutShape(LayoutContext * ctx, int & size, int & align){
+	if (myType->getType() == "struct"){
+		size = ctx->sizes[myType->getId()];
+		align = ctx->aligns[myType->getId()];
+		mySize = size;
+	} else if (myType->getType() == "bool"){
+		size = align = 1;
+	} else {
+		size = align = 4;
+	}
+}
+
+/*
+* Locals are only visible in their function, and two functions may
+* give the same name to struct variables of different types.
+*/
+void FnDeclNode::countFieldUses(LayoutContext * ctx){
+	std::unordered_map<std::string, std::string> globals = ctx->varStructs;
+	ctx->profile = myProfile;
+	ctx->weight = myProfile != nullptr ? myProfile->entries : 1;
+	myBody->countFieldUses(ctx);
+	ctx->profile = nullptr;
+	ctx->weight = 1;
+	ctx->varStructs.swap(globals);
+}
+
+/*
+* The weight of the block taken when the test of a branch site comes
+* out as arm says, by the profile if there is one: otherwise the
+* block's accesses weigh what those around it do, times loop for
+* the body of a loop.
+*/
+static double armWeight(LayoutContext * ctx, int site, int arm, double loop){
+	if (ctx->profile == nullptr || site < 0) return ctx->weight * loop;
+	return ctx->profile->sites[site].count[arm];
+}
+
+void FnBodyNode::countFieldUses(LayoutContext * ctx){
+	myDeclList->countFieldUses(ctx);
+	myStmtList->countFieldUses(ctx);
+}
+
+void StmtListNode::countFieldUses(LayoutContext * ctx){
+	for (StmtNode * stmt : *myStmts){
+		stmt->countFieldUses(ctx);
+	}
+}
+
+void AssignStmtNode::countFieldUses(LayoutContext * ctx){
+	myAssign->countFieldUses(ctx);
+}
+
+void PostIncStmtNode::countFieldUses(LayoutContext * ctx){
+	myExp->countFieldUses(ctx);
+}
+
+void PostDecStmtNode::countFieldUses(LayoutContext * ctx){
+	myExp->countFieldUses(ctx);
+}
+
+void ReadStmtNode::countFieldUses(LayoutContext * ctx){
+	myExp->countFieldUses(ctx);
+}
+
+void WriteStmtNode::countFieldUses(LayoutContext * ctx){
+	myExp->countFieldUses(ctx);
+}
+
+void IfStmtNode::countFieldUses(LayoutContext * ctx){
+	double outer = ctx->weight;
+	myExp->countFieldUses(ctx);
+	myDecls->countFieldUses(ctx);
+	ctx->weight = armWeight(ctx, mySite, 0, 1);
+	myStmts->countFieldUses(ctx);
+	ctx->weight = outer;
+}
+
+void IfElseStmtNode::countFieldUses(LayoutContext * ctx){
+	double outer = ctx->weight;
+	myExp->countFieldUses(ctx);
+	myDeclsT->countFieldUses(ctx);
+	ctx->weight = armWeight(ctx, mySite, 0, 1);
+	myStmtsT->countFieldUses(ctx);
+	ctx->weight = outer;
+	myDeclsF->countFieldUses(ctx);
+	ctx->weight = armWeight(ctx, mySite, 1, 1);
+	myStmtsF->countFieldUses(ctx);
+	ctx->weight = outer;
+}
+
+/*
+* The test of a loop runs once more than its body, which a profile
+* counts as the times it failed.
+*/
+void WhileStmtNode::countFieldUses(LayoutContext * ctx){
+	double outer = ctx->weight;
+	ctx->weight = armWeight(ctx, mySite, 0, LOOP_WEIGHT);
+	myDecls->countFieldUses(ctx);
+	myStmts->countFieldUses(ctx);
+	if (ctx->profile != nullptr && mySite >= 0) ctx->weight += ctx->profile->sites[mySite].count[1];
+	myExp->countFieldUses(ctx);
+	ctx->weight = outer;
+}
+
+void CallStmtNode::countFieldUses(LayoutContext * ctx){
+	myCallExp->countFieldUses(ctx);
+}
+
+void ReturnStmtNode::countFieldUses(LayoutContext * ctx){
+	if (myExp != nullptr) myExp->countFieldUses(ctx);
+}
+
+// p.pos.x counts as an access to pos of p's struct and to x of pos's
+
+void DotAccessNode::countFieldUses(LayoutContext * ctx){
+	std::string base = myExp->structType(ctx);
+	if (!base.empty()) ctx->heat[base + "." + myId->getId()] += ctx->weight;
+	myExp->countFieldUses(ctx);
+}
+
+std::string IdNode::structType(LayoutContext * ctx){
+	std::unordered_map<std::string, std::string>::iterator found = ctx->varStructs.find(myStrVal);
+	return found == ctx->varStructs.end() ? "" : found->second;
+}
+
+std::string DotAccessNode::structType(LayoutContext * ctx){
+	std::string base = myExp->structType(ctx);
+	if (base.empty()) return "";
+	std::unordered_map<std::string, std::string>::iterator found =
+	  ctx->fieldStructs.find(base + "." + myId->getId());
+	return found == ctx->fieldStructs.end() ? "" : found->second;
+}
+
+void AssignNode::countFieldUses(LayoutContext * ctx){
+	myExpLHS->countFieldUses(ctx);
+	myExpRHS->countFieldUses(ctx);
+}
+
+void CallExpNode::countFieldUses(LayoutContext * ctx){
+	myExpList->countFieldUses(ctx);
+}
+
+void ExpListNode::countFieldUses(LayoutContext * ctx){
+	for (ExpNode * exp : myExps){
+		exp->countFieldUses(ctx);
+	}
+}
+
+void UnaryMinusNode::countFieldUses(LayoutContext * ctx){
+	myExp->countFieldUses(ctx);
+}
+
+void NotNode::countFieldUses(LayoutContext * ctx){
+	myExp->countFieldUses(ctx);
+}
+
+void PlusNode::countFieldUses(LayoutContext * ctx){
+	myExp1->countFieldUses(ctx);
+	myExp2->countFieldUses(ctx);
+}
+
+void MinusNode::countFieldUses(LayoutContext * ctx){
+	myExp1->countFieldUses(ctx);
+	myExp2->countFieldUses(ctx);
+}
+
+void TimesNode::countFieldUses(LayoutContext * ctx){
+	myExp1->countFieldUses(ctx);
+	myExp2->countFieldUses(ctx);
+}
+
+void DivideNode::countFieldUses(LayoutContext * ctx){
+	myExp1->countFieldUses(ctx);
+	myExp2->countFieldUses(ctx);
+}
+
+void AndNode::countFieldUses(LayoutContext * ctx){
+	myExp1->countFieldUses(ctx);
+	myExp2->countFieldUses(ctx);
+}
+
+void OrNode::countFieldUses(LayoutContext * ctx){
+	myExp1->countFieldUses(ctx);
+	myExp2->countFieldUses(ctx);
+}
+
+void EqualsNode::countFieldUses(LayoutContext * ctx){
+	myExp1->countFieldUses(ctx);
+	myExp2->countFieldUses(ctx);
+}
+
+void NotEqualsNode::countFieldUses(LayoutContext * ctx){
+	myExp1->countFieldUses(ctx);
+	myExp2->countFieldUses(ctx);
+}
+
+void LessNode::countFieldUses(LayoutContext * ctx){
+	myExp1->countFieldUses(ctx);
+	myExp2->countFieldUses(ctx);
+}
+
+void GreaterNode::countFieldUses(LayoutContext * ctx){
+	myExp1->countFieldUses(ctx);
+	myExp2->countFieldUses(ctx);
+}
+
+void LessEqNode::countFieldUses(LayoutContext * ctx){
+	myExp1->countFieldUses(ctx);
+	myExp2->countFieldUses(ctx);
+}
+
+void GreaterEqNode::countFieldUses(LayoutContext * ctx){
+	myExp1->countFieldUses(ctx);
+	myExp2->countFieldUses(ctx);
+}
+
+} // End namespace LILC
@@ -132,6 +132,7 @@ ScopeTable * SymbolTable::getTableContaining(std::string id) {
 }
 
 void SymbolTable::reportError(std::string message) {
+	errors++;
 	std::cerr << message << "\n";
 }
 
@@ -144,26 +145,32 @@ void SymbolTable::printAll() {
 }
 
 void SymbolTable::multiplyDeclaredId(char f) {
+	errors++;
 	std::cerr << "Multiply declared identifier: " << f << "\n";
 }
 
 void SymbolTable::undeclaredId(char f) {
+	errors++;
 	std::cerr << "Undeclared identifier: " << f << "\n";
 }
 
 void SymbolTable::dotAccess(char f) {
+	errors++;
 	std::cerr << "Dot-access of non-struct type: " << f << "\n";
 }
 
 void SymbolTable::invalidStructField(char f) {
+	errors++;
 	std::cerr << "Invalid struct field name: " << f << "\n";
 }
 
 void SymbolTable::nonFunctionVoid(char f) {
+	errors++;
 	std::cerr << "Non-function declared void: " << f << "\n";
 }
 
 void SymbolTable::invalidStructName(char f) {
+	errors++;
 	std::cerr << "Invalid name of struct type: " << f << "\n";
 }
 
@@ -1,6 +1,7 @@
 #ifndef LILC_SYMBOL_TABLE_HPP
 #define LILC_SYMBOL_TABLE_HPP
 #include <unordered_map>
+#include <string>
 #include <list>
 
 namespace LILC{
@@ -97,7 +98,10 @@ class SymbolTable{
 		void invalidStructField(char f);
 		void nonFunctionVoid(char f);
 		void invalidStructName(char f);
+		// Errors reported so far
+		int errorCount() const { return errors; }
 	private:
+		int errors = 0;
 		std::list<ScopeTable *> * scopeTables;
 		ScopeTable * getTableContaining(std::string id);
 };
@@ -0,0 +1,69 @@
+#include "ssa.hpp"
+
+namespace LILC{
+
+/*
+* Tail-recursion elimination. A function that ends in return f(...)
+* with f itself needs nothing of its frame once the arguments are
+* computed, so instead of calling it assigns them to its formals and
+* starts over. The top of the body becomes a loop header: the entry
+* block's code moves to a new block that the entry, now empty, jumps
+* to, and so does every tail call. Restarting there also zeroes the
+* locals again, as a real call would find them.
+*
+* The arguments are copied into temporaries before any formal is
+* assigned, since an argument may read another formal (f(b, a));
+* SSA construction and copy propagation remove the copies that turn
+* out to be needless. Other tail calls are left to the backends,
+* which turn them into jumps.
+*/
+
+int eliminateTailRecursion(IRFunction& fn, int self){
+	std::vector<int> sites;
+	for (size_t b = 0; b < fn.blocks.size(); b++){
+		IRBlock & block = fn.blocks[b];
+		size_t numInsts = block.insts.size();
+		if (numInsts == 0 || !irIsTailCall(fn, block, numInsts - 1)) continue;
+		if (block.insts.back().imm != self || (int)numInsts <= fn.numFormals) continue;
+		bool args = true;
+		for (int i = 1; i <= fn.numFormals; i++){
+			if (block.insts[numInsts - 1 - i].op != IROp::Arg) args = false;
+		}
+		if (args) sites.push_back(b);
+	}
+	if (sites.empty()) return 0;
+
+	int header = fn.newBlock();
+	std::swap(fn.blocks[0], fn.blocks[header]);
+	fn.blocks[0].term = IRTerm{IRTermKind::Jump, -1, {header, -1}};
+	for (int b = 1; b < (int)fn.blocks.size(); b++){
+		for (int k = 0; k < fn.blocks[b].numSuccs(); k++){
+			if (fn.blocks[b].term.succ[k] == 0) fn.blocks[b].term.succ[k] = header;
+		}
+	}
+
+	for (int b : sites){
+		if (b == 0) b = header;
+		std::vector<IRInst> & insts = fn.blocks[b].insts;
+		std::vector<int> args;
+		for (size_t i = insts.size() - 1 - fn.numFormals; i + 1 < insts.size(); i++){
+			args.push_back(insts[i].a);
+		}
+		int line = insts.back().line;
+		insts.resize(insts.size() - 1 - fn.numFormals);
+		std::vector<int> temps;
+		for (int i = 0; i < fn.numFormals; i++){
+			int temp = fn.newValue(fn.vals[i].type);
+			fn.blocks[b].insts.push_back(IRInst{IROp::Copy, temp, args[i], -1, 0, line});
+			temps.push_back(temp);
+		}
+		for (int i = 0; i < fn.numFormals; i++){
+			fn.blocks[b].insts.push_back(IRInst{IROp::Copy, i, temps[i], -1, 0, line});
+		}
+		fn.blocks[b].term = IRTerm{IRTermKind::Jump, -1, {header, -1}};
+	}
+	fn.computePreds();
+	return sites.size();
+}
+
+} // End namespace LILC
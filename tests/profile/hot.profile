@@ -0,0 +1,6 @@
+lilc-profile 1
+function main 372e15f067438b9a 2
+branch 40 2
+call 40 twice
+branch 0 40
+function twice d9ef04956fc5c0d3 40
@@ -0,0 +1,170 @@
+#!/bin/sh
+# Checks P5 against the programs under this directory.
+#
+# NAME.lilc is run on every backend, with and without -O; assembly
+# and C output are built with the C compiler and lilc_runtime.c. What it writes,
+# followed by its exit status when that is not 0, must match
+# NAME.out. Its input, if any, is NAME.in. Run on the VM, the JIT
+# and natively with LILC_OUTPUT_MMAP naming a file, it must write
+# nothing on stdout and the same output to that file.
+#
+# passes/NAME.lilc is compiled with the options in NAME.args. The file
+# P5 writes must match NAME.expect, and what it writes on stderr must
+# match NAME.report, or be empty when there is no NAME.report.
+#
+# profile/NAME.lilc is run twice under -profile-gen on NAME.in, which
+# must write NAME.out each time and leave the merged counts of both
+# runs in a profile matching NAME.profile. Compiled with -profile-use
+# of that profile and the options in NAME.args, it must write
+# NAME.expect, and on stderr NAME.report; run under -O with it, it
+# must write NAME.out again.
+#
+# sample/NAME.lilc is run on NAME.in under -sample on the VM and the
+# JIT. It must write NAME.out; its folded stacks, which depend on
+# timing, must be nonempty lines of frames from main with a count,
+# and the report must start with its summary line.
+#
+# errors/NAME.lilc must be rejected in every mode, with the messages
+# in NAME.err. runtime/NAME.lilc compiles, but running it in process
+# must fail with the messages in NAME.err.
+#
+# Usage: tests/run.sh [path to P5] [C compiler]
+P5=${1:-./P5}
+CC=${2:-cc}
+DIR=$(dirname "$0")
+RUNTIME="$DIR/../lilc_runtime.c"
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+failed=0
+
+fail() {
+	echo "FAIL $1"
+	failed=$((failed + 1))
+}
+
+# Runs its arguments on the test's input, printing their output and
+# any nonzero exit status
+run() {
+	"$@" <"$input" 2>/dev/null
+	status=$?
+	[ $status -eq 0 ] || echo "exit status $status"
+}
+
+# As run, but with the output mapped to a file
+run_mapped() {
+	rm -f "$WORK/mapped"
+	LILC_OUTPUT_MMAP="$WORK/mapped" "$@" <"$input" >"$WORK/stdout" 2>/dev/null
+	status=$?
+	cat "$WORK/mapped" 2>/dev/null
+	[ -s "$WORK/stdout" ] && echo "output on stdout"
+	[ $status -eq 0 ] || echo "exit status $status"
+}
+
+for prog in "$DIR"/*.lilc; do
+	name=${prog%.lilc}
+	input=$name.in
+	[ -f "$input" ] || input=/dev/null
+	for mode in "-run" "-run -O" "-jit" "-jit -O" "-S" "-S -O" "-c" "-c -O"; do
+		case $mode in
+		-S*)
+			"$P5" "$prog" "$WORK/prog.s" $mode >/dev/null 2>&1 &&
+			  $CC "$WORK/prog.s" "$RUNTIME" -o "$WORK/prog" &&
+			  run "$WORK/prog" >"$WORK/out" ;;
+		-c*)
+			"$P5" "$prog" "$WORK/prog.c" $mode >/dev/null 2>&1 &&
+			  $CC -std=c99 -I"$DIR/.." "$WORK/prog.c" "$RUNTIME" -o "$WORK/prog" &&
+			  run "$WORK/prog" >"$WORK/out" ;;
+		*)
+			run "$P5" "$prog" /dev/null $mode >"$WORK/out" ;;
+		esac
+		if [ $? -ne 0 ] || ! cmp -s "$WORK/out" "$name.out"; then
+			fail "$(basename "$name") $mode"
+		fi
+	done
+	for mode in -run -jit -S; do
+		case $mode in
+		-S)
+			"$P5" "$prog" "$WORK/prog.s" $mode >/dev/null 2>&1 &&
+			  $CC "$WORK/prog.s" "$RUNTIME" -o "$WORK/prog" &&
+			  run_mapped "$WORK/prog" >"$WORK/out" ;;
+		*)
+			run_mapped "$P5" "$prog" /dev/null $mode >"$WORK/out" ;;
+		esac
+		if [ $? -ne 0 ] || ! cmp -s "$WORK/out" "$name.out"; then
+			fail "$(basename "$name") $mode LILC_OUTPUT_MMAP"
+		fi
+	done
+done
+
+for prog in "$DIR"/passes/*.lilc; do
+	name=${prog%.lilc}
+	report=$name.report
+	[ -f "$report" ] || report=/dev/null
+	rm -f "$WORK/out"
+	if ! "$P5" "$prog" "$WORK/out" $(cat "$name.args") >/dev/null 2>"$WORK/err" </dev/null ||
+	  ! cmp -s "$WORK/out" "$name.expect" || ! cmp -s "$WORK/err" "$report"; then
+		fail "passes/$(basename "$name")"
+	fi
+done
+
+for prog in "$DIR"/profile/*.lilc; do
+	name=${prog%.lilc}
+	input=$name.in
+	rm -f "$WORK/profile" "$WORK/out"
+	for k in 1 2; do
+		if ! "$P5" "$prog" /dev/null -profile-gen "$WORK/profile" <"$input" >"$WORK/run" 2>/dev/null ||
+		  ! cmp -s "$WORK/run" "$name.out"; then
+			fail "profile/$(basename "$name") -profile-gen"
+		fi
+	done
+	if ! cmp -s "$WORK/profile" "$name.profile"; then
+		fail "profile/$(basename "$name") profile"
+	fi
+	if ! "$P5" "$prog" "$WORK/out" -profile-use "$WORK/profile" $(cat "$name.args") >/dev/null 2>"$WORK/err" </dev/null ||
+	  ! cmp -s "$WORK/out" "$name.expect" || ! cmp -s "$WORK/err" "$name.report"; then
+		fail "profile/$(basename "$name") -profile-use"
+	fi
+	if ! "$P5" "$prog" /dev/null -profile-use "$WORK/profile" -run -O <"$input" >"$WORK/run" 2>/dev/null ||
+	  ! cmp -s "$WORK/run" "$name.out"; then
+		fail "profile/$(basename "$name") -profile-use -run"
+	fi
+done
+
+for prog in "$DIR"/sample/*.lilc; do
+	name=${prog%.lilc}
+	for mode in -run -jit; do
+		rm -f "$WORK/folded"
+		if ! "$P5" "$prog" /dev/null $mode -sample "$WORK/folded" <"$name.in" >"$WORK/run" 2>"$WORK/err" ||
+		  ! cmp -s "$WORK/run" "$name.out" || [ ! -s "$WORK/folded" ] ||
+		  grep -qv '^main\(;[A-Za-z_0-9]*\)* [0-9][0-9]*$' "$WORK/folded" ||
+		  ! head -n 1 "$WORK/err" | grep -q '^samples: [0-9]* in '; then
+			fail "sample/$(basename "$name") $mode"
+		fi
+	done
+done
+
+for prog in "$DIR"/errors/*.lilc; do
+	name=${prog%.lilc}
+	for mode in "" -O -run -jit -S -c; do
+		if "$P5" "$prog" "$WORK/out" $mode >/dev/null 2>"$WORK/err" </dev/null ||
+		  ! cmp -s "$WORK/err" "$name.err"; then
+			fail "errors/$(basename "$name") $mode"
+		fi
+	done
+done
+
+for prog in "$DIR"/runtime/*.lilc; do
+	name=${prog%.lilc}
+	for mode in -run -jit; do
+		if "$P5" "$prog" /dev/null $mode >/dev/null 2>"$WORK/err" </dev/null ||
+		  ! cmp -s "$WORK/err" "$name.err"; then
+			fail "runtime/$(basename "$name") $mode"
+		fi
+	done
+done
+
+if [ $failed -ne 0 ]; then
+	echo "$failed failed"
+	exit 1
+fi
+echo "all passed"
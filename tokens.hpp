@@ -8,7 +8,11 @@ namespace LILC{
 class Token {
 	public:
 		std::string name;
-		Token(size_t line, size_t column, int tag){ this->_tag = tag; }
+		Token(size_t line, size_t column, int tag){
+			this->line = line;
+			this->column = column;
+			this->_tag = tag;
+		}
 		int tag() { return _tag; }
 		size_t line;
 		size_t column;
@@ -10,15 +10,414 @@ bool ASTNode::typeAnalysis(){
 		"subclass at which it is encountered");
 }
 
+/*
+* Type analysis, run once name analysis has found no errors. Each
+* error is reported on cerr; the program is well typed if there were
+* none. The checker keeps scopes of its own, built as name analysis
+* builds its, so it also catches what name analysis lets through:
+* the fields of struct declarations, and names in the inner parts of
+* a dot-access chain. Strings can only be written, and main, which
+* every backend calls with no arguments, can have no formals.
+*/
 bool ProgramNode::typeAnalysis(){
-	//TODO: recurse down the AST, making sure to
-	// uncover any type errors as detailed in the 
-	// project 5 spec
-	std::cerr << "[DELETE ME]: program node typeAnalysis\n"
-	" should probably check for some children typing before\n"
-	" declaring victory here.\n";
-	
-	return false;
+	TypeChecker types;
+	types.scopes.push_back(SemScope());
+	myDeclList->typeCheck(&types);
+	return types.errors == 0;
+}
+
+void TypeChecker::error(const std::string& message){
+	errors++;
+	std::cerr << message << "\n";
+}
+
+void TypeChecker::declare(const std::string& name, SemType type){
+	scopes.back()[name] = type;
+}
+
+SemType TypeChecker::lookup(const std::string& name){
+	for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope){
+		SemScope::const_iterator got = scope->find(name);
+		if (got != scope->end()) return got->second;
+	}
+	error("Undeclared identifier: " + name);
+	return SemType{TypeKind::Error};
+}
+
+static bool isError(const SemType& type){
+	return type.kind == TypeKind::Error;
+}
+
+// Declarations
+
+void DeclListNode::typeCheck(TypeChecker * types){
+	for (DeclNode * decl : *myDecls){
+		decl->typeCheck(types);
+	}
+}
+
+void DeclListNode::typeCheckFields(TypeChecker * types, SemScope * fields){
+	for (DeclNode * decl : *myDecls){
+		decl->typeCheckField(types, fields);
+	}
+}
+
+void VarDeclNode::typeCheck(TypeChecker * types){
+	types->declare(myId->getId(), myType->semType());
+}
+
+/*
+* Name analysis does not look inside struct declarations, so their
+* fields are checked here. A field's struct type must be declared
+* before it, which also rules out a struct containing itself.
+*/
+void VarDeclNode::typeCheckField(TypeChecker * types, SemScope * fields){
+	std::string name = myId->getId();
+	SemType type = myType->semType();
+	if (type.kind == TypeKind::Void){
+		types->error("Non-function declared void: " + name);
+	} else if (type.kind == TypeKind::Struct && types->structs.count(type.name) == 0){
+		types->error("Invalid name of struct type: " + type.name);
+	} else if (!fields->insert({name, type}).second){
+		types->error("Multiply declared identifier: " + name);
+	}
+}
+
+void StructDeclNode::typeCheck(TypeChecker * types){
+	std::string name = myId->getId();
+	SemScope fields;
+	myDeclList->typeCheckFields(types, &fields);
+	types->structs[name] = fields;
+	types->declare(name, SemType{TypeKind::StructName, name});
+}
+
+void FormalDeclNode::typeCheck(TypeChecker * types){
+	types->declare(myId->getId(), myType->semType());
+}
+
+void FormalsListNode::typeCheck(TypeChecker * types, std::vector<SemType> * formals){
+	for (FormalDeclNode * formal : *myFormals){
+		formal->typeCheck(types);
+		formals->push_back(formal->semType());
+	}
+}
+
+/*
+* The function is in scope in its own body, so that it can call
+* itself.
+*/
+void FnDeclNode::typeCheck(TypeChecker * types){
+	std::string name = myId->getId();
+	FnSignature & signature = types->functions[name];
+	signature.ret = myType->semType();
+	types->declare(name, SemType{TypeKind::Fn, name});
+	types->scopes.push_back(SemScope());
+	myFormals->typeCheck(types, &signature.formals);
+	if (name == "main" && !signature.formals.empty()){
+		types->error("Function main declared with formals");
+	}
+	types->retType = signature.ret;
+	myBody->typeCheck(types);
+	types->scopes.pop_back();
+}
+
+void FnBodyNode::typeCheck(TypeChecker * types){
+	myDeclList->typeCheck(types);
+	myStmtList->typeCheck(types);
+}
+
+// Statements
+
+void StmtListNode::typeCheck(TypeChecker * types){
+	for (StmtNode * stmt : *myStmts){
+		stmt->typeCheck(types);
+	}
+}
+
+// Checks a block in a scope of its own
+static void typeCheckBlock(TypeChecker * types, DeclListNode * decls, StmtListNode * stmts){
+	types->scopes.push_back(SemScope());
+	decls->typeCheck(types);
+	stmts->typeCheck(types);
+	types->scopes.pop_back();
+}
+
+void AssignStmtNode::typeCheck(TypeChecker * types){
+	myAssign->typeCheck(types);
+}
+
+void PostIncStmtNode::typeCheck(TypeChecker * types){
+	SemType type = myExp->typeCheck(types);
+	if (!isError(type) && type.kind != TypeKind::Int){
+		types->error("Arithmetic operator applied to non-numeric operand");
+	}
+}
+
+void PostDecStmtNode::typeCheck(TypeChecker * types){
+	SemType type = myExp->typeCheck(types);
+	if (!isError(type) && type.kind != TypeKind::Int){
+		types->error("Arithmetic operator applied to non-numeric operand");
+	}
+}
+
+void ReadStmtNode::typeCheck(TypeChecker * types){
+	SemType type = myExp->typeCheck(types);
+	if (type.kind == TypeKind::Fn){
+		types->error("Attempt to read a function");
+	} else if (type.kind == TypeKind::StructName){
+		types->error("Attempt to read a struct name");
+	} else if (type.kind == TypeKind::Struct){
+		types->error("Attempt to read a struct variable");
+	}
+}
+
+void WriteStmtNode::typeCheck(TypeChecker * types){
+	SemType type = myExp->typeCheck(types);
+	if (type.kind == TypeKind::Fn){
+		types->error("Attempt to write a function");
+	} else if (type.kind == TypeKind::StructName){
+		types->error("Attempt to write a struct name");
+	} else if (type.kind == TypeKind::Struct){
+		types->error("Attempt to write a struct variable");
+	} else if (type.kind == TypeKind::Void){
+		types->error("Attempt to write void");
+	}
+}
+
+void IfStmtNode::typeCheck(TypeChecker * types){
+	SemType cond = myExp->typeCheck(types);
+	if (!isError(cond) && cond.kind != TypeKind::Bool){
+		types->error("Non-bool expression used as an if condition");
+	}
+	typeCheckBlock(types, myDecls, myStmts);
+}
+
+void IfElseStmtNode::typeCheck(TypeChecker * types){
+	SemType cond = myExp->typeCheck(types);
+	if (!isError(cond) && cond.kind != TypeKind::Bool){
+		types->error("Non-bool expression used as an if condition");
+	}
+	typeCheckBlock(types, myDeclsT, myStmtsT);
+	typeCheckBlock(types, myDeclsF, myStmtsF);
+}
+
+void WhileStmtNode::typeCheck(TypeChecker * types){
+	SemType cond = myExp->typeCheck(types);
+	if (!isError(cond) && cond.kind != TypeKind::Bool){
+		types->error("Non-bool expression used as a while condition");
+	}
+	typeCheckBlock(types, myDecls, myStmts);
+}
+
+void CallStmtNode::typeCheck(TypeChecker * types){
+	myCallExp->typeCheck(types);
+}
+
+void ReturnStmtNode::typeCheck(TypeChecker * types){
+	SemType ret = types->retType;
+	if (myExp == nullptr){
+		if (ret.kind != TypeKind::Void){
+			types->error("Missing return value");
+		}
+		return;
+	}
+	SemType type = myExp->typeCheck(types);
+	if (ret.kind == TypeKind::Void){
+		types->error("Return with a value in a void function");
+	} else if (!isError(type) && type != ret){
+		types->error("Bad return value");
+	}
+}
+
+// Expressions
+
+SemType IdNode::typeCheck(TypeChecker * types){
+	return types->lookup(myStrVal);
+}
+
+SemType IntLitNode::typeCheck(TypeChecker * types){
+	return SemType{TypeKind::Int};
+}
+
+SemType StrLitNode::typeCheck(TypeChecker * types){
+	return SemType{TypeKind::String};
+}
+
+SemType TrueNode::typeCheck(TypeChecker * types){
+	return SemType{TypeKind::Bool};
+}
+
+SemType FalseNode::typeCheck(TypeChecker * types){
+	return SemType{TypeKind::Bool};
+}
+
+SemType DotAccessNode::typeCheck(TypeChecker * types){
+	SemType base = myExp->typeCheck(types);
+	if (isError(base)) return base;
+	if (base.kind != TypeKind::Struct){
+		types->error("Dot-access of non-struct type: " + myId->getId());
+		return SemType{TypeKind::Error};
+	}
+	const SemScope & fields = types->structs[base.name];
+	SemScope::const_iterator field = fields.find(myId->getId());
+	if (field == fields.end()){
+		types->error("Invalid struct field name: " + myId->getId());
+		return SemType{TypeKind::Error};
+	}
+	return field->second;
+}
+
+SemType AssignNode::typeCheck(TypeChecker * types){
+	SemType lhs = myExpLHS->typeCheck(types);
+	SemType rhs = myExpRHS->typeCheck(types);
+	if (isError(lhs) || isError(rhs)) return SemType{TypeKind::Error};
+	if (lhs.kind == TypeKind::Fn && rhs.kind == TypeKind::Fn){
+		types->error("Function assignment");
+	} else if (lhs.kind == TypeKind::StructName && rhs.kind == TypeKind::StructName){
+		types->error("Struct name assignment");
+	} else if (lhs.kind == TypeKind::Struct && rhs.kind == TypeKind::Struct){
+		types->error("Struct variable assignment");
+	} else if (lhs != rhs){
+		types->error("Type mismatch");
+	} else {
+		return lhs;
+	}
+	return SemType{TypeKind::Error};
+}
+
+void ExpListNode::typeCheck(TypeChecker * types, std::vector<SemType> * actuals){
+	for (ExpNode * exp : myExps){
+		actuals->push_back(exp->typeCheck(types));
+	}
+}
+
+SemType CallExpNode::typeCheck(TypeChecker * types){
+	SemType callee = myId->typeCheck(types);
+	std::vector<SemType> actuals;
+	myExpList->typeCheck(types, &actuals);
+	if (isError(callee)) return callee;
+	if (callee.kind != TypeKind::Fn){
+		types->error("Attempt to call a non-function");
+		return SemType{TypeKind::Error};
+	}
+	const FnSignature & signature = types->functions[callee.name];
+	if (actuals.size() != signature.formals.size()){
+		types->error("Function call with wrong number of args");
+		return signature.ret;
+	}
+	for (size_t i = 0; i < actuals.size(); i++){
+		if (!isError(actuals[i]) && actuals[i] != signature.formals[i]){
+			types->error("Type of actual does not match type of formal");
+		}
+	}
+	return signature.ret;
+}
+
+// Checks that an operand has the type an operator takes
+static bool operand(TypeChecker * types, ExpNode * exp, TypeKind kind, const char * message){
+	SemType type = exp->typeCheck(types);
+	if (isError(type)) return false;
+	if (type.kind != kind){
+		types->error(message);
+		return false;
+	}
+	return true;
+}
+
+static const char * ARITHMETIC = "Arithmetic operator applied to non-numeric operand";
+static const char * LOGICAL = "Logical operator applied to non-bool operand";
+static const char * RELATIONAL = "Relational operator applied to non-numeric operand";
+
+/*
+* Both operands are checked, so that each bad one is reported. The
+* result has the operator's type unless an operand was in error.
+*/
+static SemType binary(TypeChecker * types, ExpNode * exp1, ExpNode * exp2,
+  TypeKind operands, TypeKind result, const char * message){
+	bool ok1 = operand(types, exp1, operands, message);
+	bool ok2 = operand(types, exp2, operands, message);
+	if (!ok1 || !ok2) return SemType{TypeKind::Error};
+	return SemType{result};
+}
+
+static SemType equality(TypeChecker * types, ExpNode * exp1, ExpNode * exp2){
+	SemType type1 = exp1->typeCheck(types);
+	SemType type2 = exp2->typeCheck(types);
+	if (isError(type1) || isError(type2)) return SemType{TypeKind::Error};
+	if (type1.kind == TypeKind::Void && type2.kind == TypeKind::Void){
+		types->error("Equality operator applied to void functions");
+	} else if (type1.kind == TypeKind::Fn && type2.kind == TypeKind::Fn){
+		types->error("Equality operator applied to functions");
+	} else if (type1.kind == TypeKind::StructName && type2.kind == TypeKind::StructName){
+		types->error("Equality operator applied to struct names");
+	} else if (type1.kind == TypeKind::Struct && type2.kind == TypeKind::Struct){
+		types->error("Equality operator applied to struct variables");
+	} else if (type1.kind == TypeKind::String && type2.kind == TypeKind::String){
+		types->error("Equality operator applied to strings");
+	} else if (type1 != type2){
+		types->error("Type mismatch");
+	} else {
+		return SemType{TypeKind::Bool};
+	}
+	return SemType{TypeKind::Error};
+}
+
+SemType UnaryMinusNode::typeCheck(TypeChecker * types){
+	if (!operand(types, myExp, TypeKind::Int, ARITHMETIC)) return SemType{TypeKind::Error};
+	return SemType{TypeKind::Int};
+}
+
+SemType NotNode::typeCheck(TypeChecker * types){
+	if (!operand(types, myExp, TypeKind::Bool, LOGICAL)) return SemType{TypeKind::Error};
+	return SemType{TypeKind::Bool};
+}
+
+SemType PlusNode::typeCheck(TypeChecker * types){
+	return binary(types, myExp1, myExp2, TypeKind::Int, TypeKind::Int, ARITHMETIC);
+}
+
+SemType MinusNode::typeCheck(TypeChecker * types){
+	return binary(types, myExp1, myExp2, TypeKind::Int, TypeKind::Int, ARITHMETIC);
+}
+
+SemType TimesNode::typeCheck(TypeChecker * types){
+	return binary(types, myExp1, myExp2, TypeKind::Int, TypeKind::Int, ARITHMETIC);
+}
+
+SemType DivideNode::typeCheck(TypeChecker * types){
+	return binary(types, myExp1, myExp2, TypeKind::Int, TypeKind::Int, ARITHMETIC);
+}
+
+SemType AndNode::typeCheck(TypeChecker * types){
+	return binary(types, myExp1, myExp2, TypeKind::Bool, TypeKind::Bool, LOGICAL);
+}
+
+SemType OrNode::typeCheck(TypeChecker * types){
+	return binary(types, myExp1, myExp2, TypeKind::Bool, TypeKind::Bool, LOGICAL);
+}
+
+SemType EqualsNode::typeCheck(TypeChecker * types){
+	return equality(types, myExp1, myExp2);
+}
+
+SemType NotEqualsNode::typeCheck(TypeChecker * types){
+	return equality(types, myExp1, myExp2);
+}
+
+SemType LessNode::typeCheck(TypeChecker * types){
+	return binary(types, myExp1, myExp2, TypeKind::Int, TypeKind::Bool, RELATIONAL);
+}
+
+SemType GreaterNode::typeCheck(TypeChecker * types){
+	return binary(types, myExp1, myExp2, TypeKind::Int, TypeKind::Bool, RELATIONAL);
+}
+
+SemType LessEqNode::typeCheck(TypeChecker * types){
+	return binary(types, myExp1, myExp2, TypeKind::Int, TypeKind::Bool, RELATIONAL);
+}
+
+SemType GreaterEqNode::typeCheck(TypeChecker * types){
+	return binary(types, myExp1, myExp2, TypeKind::Int, TypeKind::Bool, RELATIONAL);
 }
 
 /*
@@ -46,7 +445,7 @@ std::string FormalsListNode::getTypeString(){
 std::string FnDeclNode::getTypeString(){
 	return myFormals->getTypeString() 
 		+ "->" 
-		+ myRetType->getTypeString();
+		+ myType->getTypeString();
 }
 
 /*
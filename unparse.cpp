@@ -212,7 +212,7 @@ void IntLitNode::unparse(std::ostream& out, int indent){
 
 void StrLitNode::unparse(std::ostream& out, int indent){
 	doIndent(out, indent);
-	out << myString;
+	out << myPool->literal(myIndex);
 }
 
 void TrueNode::unparse(std::ostream& out, int indent){
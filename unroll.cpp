@@ -0,0 +1,683 @@
+#include "ast.hpp"
+#include "profile.hpp"
+#include <algorithm>
+#include <climits>
+#include <iterator>
+#include <stdexcept>
+
+namespace LILC{
+
+/*
+* Loop unrolling, run under -O after dead-store elimination. A while
+* loop runs a number of times known at compile time when its test
+* compares a local counter with a constant, the statement before it
+* sets the counter to a constant, and its body ends in a ++ or -- of
+* the counter and assigns it nowhere else. Such a loop is replaced
+* by that many copies of its body if they fit FULL_BUDGET. Otherwise
+* each iteration runs the body factor times, fewer if the copies
+* would not fit PARTIAL_BUDGET; the iterations left over when the
+* trip count is not a multiple of the factor are peeled off ahead of
+* the loop, so its unchanged test stays exact. Sizes are counted in
+* statements, nested ones included.
+*
+* Under -profile-use, a loop whose body never ran when the profile
+* was taken is left alone, and one whose trip count is not known but
+* that ran on average enough iterations is unrolled all the same; see
+* WhileStmtNode::unrollHot.
+*
+* Each copy is a deep copy of the body, so the AST stays a tree. A
+* body that declares locals, at any depth, is left alone: each copy
+* would get a fresh one where the loop reused it.
+*/
+
+static const int FULL_BUDGET = 32;
+static const int PARTIAL_BUDGET = 64;
+
+void ProgramNode::unrollLoops(int factor, std::ostream * report){
+	myDeclList->unrollLoops(factor, report);
+}
+
+void DeclListNode::unrollLoops(int factor, std::ostream * report){
+	std::set<std::string> globals;
+	for (DeclNode * decl : *myDecls){
+		if (decl->getType() != "fn") globals.insert(decl->getId());
+	}
+	for (DeclNode * decl : *myDecls){
+		decl->unrollLoops(globals, factor, report);
+	}
+}
+
+void FnDeclNode::unrollLoops(const std::set<std::string>& globals, int factor, std::ostream * report){
+	Unroller u(globals, factor);
+	u.profile = myProfile;
+	myBody->unrollLoops(&u);
+	if (report != nullptr){
+		*report << "unroll " << getId() << ": " << u.full
+		  << " loops fully unrolled, " << u.partial
+		  << " partially";
+		if (u.profile != nullptr){
+			*report << ", " << u.hot << " by profile, "
+			  << u.cold << " cold";
+		}
+		*report << std::endl;
+	}
+}
+
+/*
+* Rebuilds the statement list with every loop in it unrolled where
+* possible, innermost loops first. A loop finds the statement that
+* precedes it at the end of out.
+*/
+void StmtListNode::unrollLoops(Unroller * u){
+	std::list<StmtNode *> unrolled;
+	for (StmtNode * stmt : *myStmts){
+		stmt->unrollLoops(u, &unrolled);
+	}
+	myStmts->swap(unrolled);
+}
+
+void StmtListNode::cloneInto(std::list<StmtNode *> * out){
+	for (StmtNode * stmt : *myStmts){
+		out->push_back(stmt->clone());
+	}
+}
+
+bool StmtListNode::unrollable(const std::string& var){
+	for (StmtNode * stmt : *myStmts){
+		if (!stmt->unrollable(var)) return false;
+	}
+	return true;
+}
+
+/*
+* The step of var from one iteration of a loop with this body to the
+* next, 1 or -1, or 0 if the body does not end in var++ or var--, or
+* may also change var before that.
+*/
+int StmtListNode::stepOf(const std::string& var){
+	if (myStmts->empty()) return 0;
+	std::list<StmtNode *>::iterator last = std::prev(myStmts->end());
+	for (std::list<StmtNode *>::iterator it = myStmts->begin(); it != last; ++it){
+		if (!(*it)->unrollable(var)) return 0;
+	}
+	return (*last)->stepOf(var);
+}
+
+int StmtListNode::stmtCount(){
+	int count = 0;
+	for (StmtNode * stmt : *myStmts){
+		count += stmt->stmtCount();
+	}
+	return count;
+}
+
+void StmtNode::unrollLoops(Unroller * u, std::list<StmtNode *> * out){
+	out->push_back(this);
+}
+
+void IfStmtNode::unrollLoops(Unroller * u, std::list<StmtNode *> * out){
+	myStmts->unrollLoops(u);
+	out->push_back(this);
+}
+
+void IfElseStmtNode::unrollLoops(Unroller * u, std::list<StmtNode *> * out){
+	myStmtsT->unrollLoops(u);
+	myStmtsF->unrollLoops(u);
+	out->push_back(this);
+}
+
+/*
+* How many times a loop testing test runs, entered with its counter
+* at start and stepping it by step. Fails when the counter would wrap
+* around before the test fails.
+*/
+static bool tripCount(const LoopTest& test, int start, int step, long long & trips){
+	long long s = start;
+	long long b = test.bound;
+	bool enters = false;
+	switch (test.rel){
+		case LoopTest::Lt: enters = s < b; break;
+		case LoopTest::Le: enters = s <= b; break;
+		case LoopTest::Gt: enters = s > b; break;
+		case LoopTest::Ge: enters = s >= b; break;
+		case LoopTest::Ne: enters = s != b; break;
+	}
+	if (!enters){
+		trips = 0;
+		return true;
+	}
+	if (step > 0){
+		switch (test.rel){
+			case LoopTest::Lt: trips = b - s; return true;
+			case LoopTest::Le: trips = b - s + 1; return b < INT_MAX;
+			case LoopTest::Ne: trips = b - s; return s < b;
+			default: return false;
+		}
+	}
+	switch (test.rel){
+		case LoopTest::Gt: trips = s - b; return true;
+		case LoopTest::Ge: trips = s - b + 1; return b > INT_MIN;
+		case LoopTest::Ne: trips = s - b; return s > b;
+		default: return false;
+	}
+}
+
+void WhileStmtNode::unrollLoops(Unroller * u, std::list<StmtNode *> * out){
+	myStmts->unrollLoops(u);
+	if (u->profile != nullptr && mySite >= 0 && u->profile->sites[mySite].count[0] == 0){
+		u->cold++;
+		out->push_back(this);
+		return;
+	}
+
+	LoopTest test;
+	std::string var;
+	int start;
+	int step = 0;
+	long long trips;
+	bool counted = myDecls->isEmpty() && myExp->loopTest(&test) && !u->globals.count(test.var)
+	  && !out->empty() && out->back()->constAssign(var, start) && var == test.var;
+	if (counted) step = myStmts->stepOf(test.var);
+	if (step == 0 || !tripCount(test, start, step, trips)){
+		if (unrollHot(u)) u->hot++;
+		out->push_back(this);
+		return;
+	}
+
+	int size = myStmts->stmtCount();
+	if (trips * size <= FULL_BUDGET){
+		for (long long k = 0; k < trips; k++){
+			myStmts->cloneInto(out);
+		}
+		u->full++;
+		return;
+	}
+	// No factor above the budget can fit, and none is tried, so the
+	// sizes below cannot overflow whatever -unroll asked for
+	int most = std::min(u->factor, PARTIAL_BUDGET / std::max(size, 1));
+	for (int factor = most; factor >= 2; factor--){
+		int left = trips % factor;
+		if (trips < 2 * factor || (factor + left) * size > PARTIAL_BUDGET) continue;
+		for (int k = 0; k < left; k++){
+			myStmts->cloneInto(out);
+		}
+		std::list<StmtNode *> * body = new std::list<StmtNode *>();
+		for (int k = 0; k < factor; k++){
+			myStmts->cloneInto(body);
+		}
+		myStmts = new StmtListNode(body);
+		u->partial++;
+		break;
+	}
+	out->push_back(this);
+}
+
+/*
+* Unrolls a loop whose trip count is not known at compile time by
+* the profile's average: the iterations per entry, or the iterations
+* overall for a loop only left by returning. Each iteration runs the
+* body and then runs it again while the test still holds, up to
+* factor copies in all, as in while (c) { B if (c) { B } }. The test
+* must be free of side effects, since it is evaluated once more than
+* before when the loop ends between two copies; the body must
+* declare no locals, as unrollable asks of a body whatever var is.
+* As with a counted loop, the average must be at least twice the
+* factor and the copies and their tests fit PARTIAL_BUDGET.
+*/
+bool WhileStmtNode::unrollHot(Unroller * u){
+	if (u->profile == nullptr || mySite < 0 || !myDecls->isEmpty()
+	  || myExp->hasSideEffects() || !myStmts->unrollable("")){
+		return false;
+	}
+	const ProfileSite & counts = u->profile->sites[mySite];
+	uint64_t trips = counts.count[0] / std::max<uint64_t>(counts.count[1], 1);
+	int size = myStmts->stmtCount();
+	// As for a counted loop, the factor is clamped to what the budget
+	// allows before the sizes are computed
+	int most = std::min(u->factor, (PARTIAL_BUDGET + 1) / (size + 1));
+	for (int factor = most; factor >= 2; factor--){
+		if (trips < 2 * (uint64_t)factor || factor * (size + 1) - 1 > PARTIAL_BUDGET) continue;
+		std::list<StmtNode *> * body = new std::list<StmtNode *>();
+		myStmts->cloneInto(body);
+		for (int k = 1; k < factor; k++){
+			StmtListNode * rest = new StmtListNode(body);
+			body = new std::list<StmtNode *>();
+			myStmts->cloneInto(body);
+			body->push_back(new IfStmtNode(myExp->clone(),
+			  new DeclListNode(new std::list<DeclNode *>()), rest));
+		}
+		myStmts = new StmtListNode(body);
+		return true;
+	}
+	return false;
+}
+
+/*
+* Whether a statement can be repeated in the body of a loop counting
+* with var: it leaves var alone and declares no locals.
+*/
+
+bool AssignStmtNode::unrollable(const std::string& var){
+	return !myAssign->assigns(var);
+}
+
+bool PostIncStmtNode::unrollable(const std::string& var){
+	return myExp->accessPath() != var;
+}
+
+bool PostDecStmtNode::unrollable(const std::string& var){
+	return myExp->accessPath() != var;
+}
+
+bool ReadStmtNode::unrollable(const std::string& var){
+	return myExp->accessPath() != var;
+}
+
+bool WriteStmtNode::unrollable(const std::string& var){
+	return !myExp->assigns(var);
+}
+
+bool IfStmtNode::unrollable(const std::string& var){
+	return myDecls->isEmpty() && !myExp->assigns(var) && myStmts->unrollable(var);
+}
+
+bool IfElseStmtNode::unrollable(const std::string& var){
+	return myDeclsT->isEmpty() && myDeclsF->isEmpty() && !myExp->assigns(var)
+	  && myStmtsT->unrollable(var) && myStmtsF->unrollable(var);
+}
+
+bool WhileStmtNode::unrollable(const std::string& var){
+	return myDecls->isEmpty() && !myExp->assigns(var) && myStmts->unrollable(var);
+}
+
+bool CallStmtNode::unrollable(const std::string& var){
+	return !myCallExp->assigns(var);
+}
+
+bool ReturnStmtNode::unrollable(const std::string& var){
+	return myExp == nullptr || !myExp->assigns(var);
+}
+
+int IfStmtNode::stmtCount(){
+	return 1 + myStmts->stmtCount();
+}
+
+int IfElseStmtNode::stmtCount(){
+	return 1 + myStmtsT->stmtCount() + myStmtsF->stmtCount();
+}
+
+int WhileStmtNode::stmtCount(){
+	return 1 + myStmts->stmtCount();
+}
+
+bool AssignStmtNode::constAssign(std::string & var, int & val){
+	return myAssign->constAssign(var, val);
+}
+
+bool AssignNode::constAssign(std::string & var, int & val){
+	var = myExpLHS->accessPath();
+	return myExpRHS->constValue(val);
+}
+
+int PostIncStmtNode::stepOf(const std::string& var){
+	return myExp->accessPath() == var ? 1 : 0;
+}
+
+int PostDecStmtNode::stepOf(const std::string& var){
+	return myExp->accessPath() == var ? -1 : 0;
+}
+
+/*
+* Whether evaluating an expression may assign var, through an
+* assignment nested in it. Calls cannot: var is never a global.
+*/
+
+bool AssignNode::assigns(const std::string& var){
+	return myExpLHS->accessPath() == var || myExpLHS->assigns(var) || myExpRHS->assigns(var);
+}
+
+bool CallExpNode::assigns(const std::string& var){
+	return myExpList->assigns(var);
+}
+
+bool ExpListNode::assigns(const std::string& var){
+	for (ExpNode * exp : myExps){
+		if (exp->assigns(var)) return true;
+	}
+	return false;
+}
+
+bool UnaryMinusNode::assigns(const std::string& var){
+	return myExp->assigns(var);
+}
+
+bool NotNode::assigns(const std::string& var){
+	return myExp->assigns(var);
+}
+
+bool PlusNode::assigns(const std::string& var){
+	return myExp1->assigns(var) || myExp2->assigns(var);
+}
+
+bool MinusNode::assigns(const std::string& var){
+	return myExp1->assigns(var) || myExp2->assigns(var);
+}
+
+bool TimesNode::assigns(const std::string& var){
+	return myExp1->assigns(var) || myExp2->assigns(var);
+}
+
+bool DivideNode::assigns(const std::string& var){
+	return myExp1->assigns(var) || myExp2->assigns(var);
+}
+
+bool AndNode::assigns(const std::string& var){
+	return myExp1->assigns(var) || myExp2->assigns(var);
+}
+
+bool OrNode::assigns(const std::string& var){
+	return myExp1->assigns(var) || myExp2->assigns(var);
+}
+
+bool EqualsNode::assigns(const std::string& var){
+	return myExp1->assigns(var) || myExp2->assigns(var);
+}
+
+bool NotEqualsNode::assigns(const std::string& var){
+	return myExp1->assigns(var) || myExp2->assigns(var);
+}
+
+bool LessNode::assigns(const std::string& var){
+	return myExp1->assigns(var) || myExp2->assigns(var);
+}
+
+bool GreaterNode::assigns(const std::string& var){
+	return myExp1->assigns(var) || myExp2->assigns(var);
+}
+
+bool LessEqNode::assigns(const std::string& var){
+	return myExp1->assigns(var) || myExp2->assigns(var);
+}
+
+bool GreaterEqNode::assigns(const std::string& var){
+	return myExp1->assigns(var) || myExp2->assigns(var);
+}
+
+/*
+* A comparison is a loop test when one side names a plain variable
+* and the other is a constant; rel is the relation with the variable
+* on the left, flipped the one with it on the right.
+*/
+static bool matchTest(ExpNode * exp1, ExpNode * exp2,
+  LoopTest::Rel rel, LoopTest::Rel flipped, LoopTest * test){
+	std::string path1 = exp1->accessPath();
+	std::string path2 = exp2->accessPath();
+	if (!path1.empty() && path1.find('.') == std::string::npos
+	  && exp2->constValue(test->bound)){
+		test->var = path1;
+		test->rel = rel;
+		return true;
+	}
+	if (!path2.empty() && path2.find('.') == std::string::npos
+	  && exp1->constValue(test->bound)){
+		test->var = path2;
+		test->rel = flipped;
+		return true;
+	}
+	return false;
+}
+
+bool NotEqualsNode::loopTest(LoopTest * test){
+	return matchTest(myExp1, myExp2, LoopTest::Ne, LoopTest::Ne, test);
+}
+
+bool LessNode::loopTest(LoopTest * test){
+	return matchTest(myExp1, myExp2, LoopTest::Lt, LoopTest::Gt, test);
+}
+
+bool GreaterNode::loopTest(LoopTest * test){
+	return matchTest(myExp1, myExp2, LoopTest::Gt, LoopTest::Lt, test);
+}
+
+bool LessEqNode::loopTest(LoopTest * test){
+	return matchTest(myExp1, myExp2, LoopTest::Le, LoopTest::Ge, test);
+}
+
+bool GreaterEqNode::loopTest(LoopTest * test){
+	return matchTest(myExp1, myExp2, LoopTest::Ge, LoopTest::Le, test);
+}
+
+/*
+* Deep copies for the unrolled bodies. Each node is copied whole, so
+* it keeps whatever earlier passes recorded in it, and then gets
+* copies of its children. Unrolling never copies a block that
+* declares locals, so neither does this.
+*/
+
+static DeclListNode * cloneDecls(DeclListNode * decls){
+	if (!decls->isEmpty()){
+		throw std::runtime_error("Internal Error: copy of a block that declares locals");
+	}
+	return new DeclListNode(new std::list<DeclNode *>());
+}
+
+StmtListNode * StmtListNode::clone(){
+	std::list<StmtNode *> * stmts = new std::list<StmtNode *>();
+	cloneInto(stmts);
+	return new StmtListNode(stmts);
+}
+
+StmtNode * AssignStmtNode::clone(){
+	AssignStmtNode * copy = new AssignStmtNode(*this);
+	copy->myAssign = myAssign->clone();
+	return copy;
+}
+
+StmtNode * PostIncStmtNode::clone(){
+	PostIncStmtNode * copy = new PostIncStmtNode(*this);
+	copy->myExp = myExp->clone();
+	return copy;
+}
+
+StmtNode * PostDecStmtNode::clone(){
+	PostDecStmtNode * copy = new PostDecStmtNode(*this);
+	copy->myExp = myExp->clone();
+	return copy;
+}
+
+StmtNode * ReadStmtNode::clone(){
+	ReadStmtNode * copy = new ReadStmtNode(*this);
+	copy->myExp = myExp->clone();
+	return copy;
+}
+
+StmtNode * WriteStmtNode::clone(){
+	WriteStmtNode * copy = new WriteStmtNode(*this);
+	copy->myExp = myExp->clone();
+	return copy;
+}
+
+StmtNode * IfStmtNode::clone(){
+	IfStmtNode * copy = new IfStmtNode(*this);
+	copy->myExp = myExp->clone();
+	copy->myDecls = cloneDecls(myDecls);
+	copy->myStmts = myStmts->clone();
+	return copy;
+}
+
+StmtNode * IfElseStmtNode::clone(){
+	IfElseStmtNode * copy = new IfElseStmtNode(*this);
+	copy->myExp = myExp->clone();
+	copy->myDeclsT = cloneDecls(myDeclsT);
+	copy->myStmtsT = myStmtsT->clone();
+	copy->myDeclsF = cloneDecls(myDeclsF);
+	copy->myStmtsF = myStmtsF->clone();
+	return copy;
+}
+
+StmtNode * WhileStmtNode::clone(){
+	WhileStmtNode * copy = new WhileStmtNode(*this);
+	copy->myExp = myExp->clone();
+	copy->myDecls = cloneDecls(myDecls);
+	copy->myStmts = myStmts->clone();
+	return copy;
+}
+
+StmtNode * CallStmtNode::clone(){
+	CallStmtNode * copy = new CallStmtNode(*this);
+	copy->myCallExp = myCallExp->clone();
+	return copy;
+}
+
+StmtNode * ReturnStmtNode::clone(){
+	ReturnStmtNode * copy = new ReturnStmtNode(*this);
+	if (myExp != nullptr) copy->myExp = myExp->clone();
+	return copy;
+}
+
+ExpListNode * ExpListNode::clone(){
+	ExpListNode * copy = new ExpListNode(*this);
+	for (ExpNode *& exp : copy->myExps){
+		exp = exp->clone();
+	}
+	return copy;
+}
+
+IdNode * IdNode::clone(){
+	return new IdNode(*this);
+}
+
+ExpNode * IntLitNode::clone(){
+	return new IntLitNode(*this);
+}
+
+ExpNode * StrLitNode::clone(){
+	return new StrLitNode(*this);
+}
+
+ExpNode * TrueNode::clone(){
+	return new TrueNode(*this);
+}
+
+ExpNode * FalseNode::clone(){
+	return new FalseNode(*this);
+}
+
+ExpNode * DotAccessNode::clone(){
+	DotAccessNode * copy = new DotAccessNode(*this);
+	copy->myExp = myExp->clone();
+	copy->myId = myId->clone();
+	return copy;
+}
+
+AssignNode * AssignNode::clone(){
+	AssignNode * copy = new AssignNode(*this);
+	copy->myExpLHS = myExpLHS->clone();
+	copy->myExpRHS = myExpRHS->clone();
+	return copy;
+}
+
+CallExpNode * CallExpNode::clone(){
+	CallExpNode * copy = new CallExpNode(*this);
+	copy->myId = myId->clone();
+	copy->myExpList = myExpList->clone();
+	return copy;
+}
+
+ExpNode * UnaryMinusNode::clone(){
+	UnaryMinusNode * copy = new UnaryMinusNode(*this);
+	copy->myExp = myExp->clone();
+	return copy;
+}
+
+ExpNode * NotNode::clone(){
+	NotNode * copy = new NotNode(*this);
+	copy->myExp = myExp->clone();
+	return copy;
+}
+
+ExpNode * PlusNode::clone(){
+	PlusNode * copy = new PlusNode(*this);
+	copy->myExp1 = myExp1->clone();
+	copy->myExp2 = myExp2->clone();
+	return copy;
+}
+
+ExpNode * MinusNode::clone(){
+	MinusNode * copy = new MinusNode(*this);
+	copy->myExp1 = myExp1->clone();
+	copy->myExp2 = myExp2->clone();
+	return copy;
+}
+
+ExpNode * TimesNode::clone(){
+	TimesNode * copy = new TimesNode(*this);
+	copy->myExp1 = myExp1->clone();
+	copy->myExp2 = myExp2->clone();
+	return copy;
+}
+
+ExpNode * DivideNode::clone(){
+	DivideNode * copy = new DivideNode(*this);
+	copy->myExp1 = myExp1->clone();
+	copy->myExp2 = myExp2->clone();
+	return copy;
+}
+
+ExpNode * AndNode::clone(){
+	AndNode * copy = new AndNode(*this);
+	copy->myExp1 = myExp1->clone();
+	copy->myExp2 = myExp2->clone();
+	return copy;
+}
+
+ExpNode * OrNode::clone(){
+	OrNode * copy = new OrNode(*this);
+	copy->myExp1 = myExp1->clone();
+	copy->myExp2 = myExp2->clone();
+	return copy;
+}
+
+ExpNode * EqualsNode::clone(){
+	EqualsNode * copy = new EqualsNode(*this);
+	copy->myExp1 = myExp1->clone();
+	copy->myExp2 = myExp2->clone();
+	return copy;
+}
+
+ExpNode * NotEqualsNode::clone(){
+	NotEqualsNode * copy = new NotEqualsNode(*this);
+	copy->myExp1 = myExp1->clone();
+	copy->myExp2 = myExp2->clone();
+	return copy;
+}
+
+ExpNode * LessNode::clone(){
+	LessNode * copy = new LessNode(*this);
+	copy->myExp1 = myExp1->clone();
+	copy->myExp2 = myExp2->clone();
+	return copy;
+}
+
+ExpNode * GreaterNode::clone(){
+	GreaterNode * copy = new GreaterNode(*this);
+	copy->myExp1 = myExp1->clone();
+	copy->myExp2 = myExp2->clone();
+	return copy;
+}
+
+ExpNode * LessEqNode::clone(){
+	LessEqNode * copy = new LessEqNode(*this);
+	copy->myExp1 = myExp1->clone();
+	copy->myExp2 = myExp2->clone();
+	return copy;
+}
+
+ExpNode * GreaterEqNode::clone(){
+	GreaterEqNode * copy = new GreaterEqNode(*this);
+	copy->myExp1 = myExp1->clone();
+	copy->myExp2 = myExp2->clone();
+	return copy;
+}
+
+} // End namespace LILC
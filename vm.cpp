@@ -0,0 +1,255 @@
+#include "bytecode.hpp"
+#include "sampler.hpp"
+#include "lilc_runtime.h"
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+namespace LILC{
+
+namespace {
+
+// An instruction with its opcode replaced by its handler's address
+struct Threaded{
+	const void * handler;
+	int32_t a;
+	int32_t b;
+	int32_t c;
+};
+
+struct Frame{
+	const Threaded * code;    // the caller's code
+	const Threaded * ret;     // where the caller resumes
+	size_t base;              // the caller's first register
+	int size;                 // the caller's register count
+	int dst;                  // caller register taking the result, or -1
+};
+
+/*
+* Grows the register stack to hold at least needed registers.
+*/
+void reserve(std::vector<int32_t>& stack, size_t needed){
+	if (needed <= stack.size()) return;
+	if (needed > VM::MAX_STACK){
+		throw std::runtime_error("Runtime Error: stack overflow");
+	}
+	stack.resize(std::max(needed, stack.size() * 2), 0);
+}
+
+} // End anonymous namespace
+
+void VM::run(bool countInsts){
+	if (myModule.mainIndex < 0){
+		throw std::runtime_error("Runtime Error: no main function");
+	}
+	myExecuted = 0;
+	myCounters.assign(myModule.numCounters, 0);
+	if (countInsts){
+		if (mySampler != nullptr) execute<true, true>(); else execute<true, false>();
+	} else {
+		if (mySampler != nullptr) execute<false, true>(); else execute<false, false>();
+	}
+	lilc_rt_flush();
+}
+
+/*
+* The interpreter loop. COUNT selects, at compile time, a copy that
+* counts every instruction it dispatches, and SAMPLE one that tells
+* the sampler where it is and checks at each taken jump, call and
+* return whether a sample is due, so plain runs pay nothing for
+* either. Registers of all active frames live in one vector, each
+* frame's right after its caller's; r is re-derived from it whenever
+* it may have been reallocated.
+*/
+template <bool COUNT, bool SAMPLE>
+void VM::execute(){
+	static const void * const handlers[] = {
+		&&L_Const, &&L_Move, &&L_Neg, &&L_Not,
+		&&L_Add, &&L_Sub, &&L_Mul, &&L_Div, &&L_Shl, &&L_Sar, &&L_Shr,
+		&&L_Eq, &&L_Ne, &&L_Lt, &&L_Gt, &&L_Le, &&L_Ge,
+		&&L_GLoad, &&L_GStore, &&L_Arg, &&L_Call, &&L_TailCall, &&L_Ret, &&L_RetVoid,
+		&&L_Jump, &&L_JumpIf, &&L_JumpIfNot,
+		&&L_Read, &&L_Write, &&L_WriteStr, &&L_Count,
+		&&L_AddImm, &&L_SubImm, &&L_MulImm,
+		&&L_JumpLt, &&L_JumpGt, &&L_JumpLe, &&L_JumpGe, &&L_JumpEq, &&L_JumpNe,
+		&&L_JumpLtImm, &&L_JumpGtImm, &&L_JumpLeImm, &&L_JumpGeImm,
+		&&L_JumpEqImm, &&L_JumpNeImm,
+	};
+	static_assert(sizeof(handlers) / sizeof(handlers[0]) == (size_t)BCOp::NumOps,
+	  "every bytecode operation needs a handler");
+
+	std::vector<std::vector<Threaded>> code(myModule.functions.size());
+	for (size_t f = 0; f < code.size(); f++){
+		for (const BCInst & inst : myModule.functions[f].code){
+			code[f].push_back(Threaded{handlers[(int)inst.op], inst.a, inst.b, inst.c});
+		}
+	}
+	std::vector<int32_t> globals(myModule.numGlobals, 0);
+	std::vector<int32_t> stack(1024, 0);
+	std::vector<int32_t> args;
+	std::vector<Frame> frames;
+	uint64_t executed = 0;
+
+	const BCFunction & main = myModule.functions[myModule.mainIndex];
+	if ((size_t)main.numRegs > stack.size()) stack.resize(main.numRegs, 0);
+	const Threaded * fnCode = code[myModule.mainIndex].data();
+	const Threaded * ip = fnCode;
+	size_t base = 0;
+	int frameSize = main.numRegs;
+	int32_t * r = stack.data();
+
+#define DISPATCH() do { \
+		if (COUNT) executed++; \
+		if (SAMPLE) Sampler::at = ip; \
+		goto *ip->handler; \
+	} while (0)
+#define NEXT() do { ip++; DISPATCH(); } while (0)
+#define POLL() do { if (SAMPLE && Sampler::due) goto L_sample; } while (0)
+#define JUMP_IF(cond, target) do { \
+		if (cond){ POLL(); ip = fnCode + (target); DISPATCH(); } NEXT(); \
+	} while (0)
+#define BINARY(expr) do { \
+		uint32_t x = r[ip->b]; \
+		uint32_t y = r[ip->c]; \
+		r[ip->a] = (int32_t)(expr); \
+		NEXT(); \
+	} while (0)
+#define IMMEDIATE(expr) do { \
+		uint32_t x = r[ip->b]; \
+		uint32_t y = ip->c; \
+		r[ip->a] = (int32_t)(expr); \
+		NEXT(); \
+	} while (0)
+
+	DISPATCH();
+
+// Not an instruction: takes the sample due, each caller at the line
+// of its call, and then runs the instruction at ip again. The
+// function running is at dueAt unless the signal came as it left.
+L_sample: {
+	Sampler::due = 0;
+	std::vector<SampleFrame> sample;
+	for (size_t k = 0; k <= frames.size(); k++){
+		const Threaded * start = k < frames.size() ? frames[k].code : fnCode;
+		const Threaded * at = k < frames.size() ? frames[k].ret - 1 : ip;
+		size_t f = 0;
+		while (code[f].data() != start) f++;
+		const Threaded * dueAt = (const Threaded *)Sampler::dueAt;
+		if (k == frames.size() && dueAt >= start && dueAt < start + code[f].size()) at = dueAt;
+		sample.push_back(SampleFrame{(int)f, myModule.functions[f].lines[at - start]});
+	}
+	mySampler->add(sample);
+	goto *ip->handler;
+}
+
+L_Const: r[ip->a] = ip->b; NEXT();
+L_Move: r[ip->a] = r[ip->b]; NEXT();
+L_Neg: r[ip->a] = (int32_t)(0u - (uint32_t)r[ip->b]); NEXT();
+L_Not: r[ip->a] = !r[ip->b]; NEXT();
+L_Add: BINARY(x + y);
+L_Sub: BINARY(x - y);
+L_Mul: BINARY(x * y);
+L_Div: {
+	int32_t x = r[ip->b];
+	int32_t y = r[ip->c];
+	if (y == 0) throw std::runtime_error("Runtime Error: division by zero");
+	r[ip->a] = (x == INT_MIN && y == -1) ? INT_MIN : x / y;
+	NEXT();
+}
+L_Shl: BINARY(x << (y & 31));
+L_Sar: {
+	int32_t x = r[ip->b];
+	int shift = r[ip->c] & 31;
+	r[ip->a] = x < 0 ? ~(~x >> shift) : x >> shift;
+	NEXT();
+}
+L_Shr: BINARY(x >> (y & 31));
+L_Eq: r[ip->a] = r[ip->b] == r[ip->c]; NEXT();
+L_Ne: r[ip->a] = r[ip->b] != r[ip->c]; NEXT();
+L_Lt: r[ip->a] = r[ip->b] < r[ip->c]; NEXT();
+L_Gt: r[ip->a] = r[ip->b] > r[ip->c]; NEXT();
+L_Le: r[ip->a] = r[ip->b] <= r[ip->c]; NEXT();
+L_Ge: r[ip->a] = r[ip->b] >= r[ip->c]; NEXT();
+L_GLoad: r[ip->a] = globals[ip->b]; NEXT();
+L_GStore: globals[ip->a] = r[ip->b]; NEXT();
+L_Arg: args.push_back(r[ip->a]); NEXT();
+L_Call: {
+	POLL();
+	const BCFunction & callee = myModule.functions[ip->b];
+	size_t calleeBase = base + frameSize;
+	reserve(stack, calleeBase + callee.numRegs);
+	frames.push_back(Frame{fnCode, ip + 1, base, frameSize, ip->a});
+	base = calleeBase;
+	frameSize = callee.numRegs;
+	r = stack.data() + base;
+	std::fill(r, r + frameSize, 0);
+	std::copy(args.begin(), args.end(), r);
+	args.clear();
+	fnCode = code[ip->b].data();
+	ip = fnCode;
+	DISPATCH();
+}
+// The callee takes over the frame, and returns where the caller would
+L_TailCall: {
+	POLL();
+	const BCFunction & callee = myModule.functions[ip->b];
+	reserve(stack, base + callee.numRegs);
+	frameSize = callee.numRegs;
+	r = stack.data() + base;
+	std::fill(r, r + frameSize, 0);
+	std::copy(args.begin(), args.end(), r);
+	args.clear();
+	fnCode = code[ip->b].data();
+	ip = fnCode;
+	DISPATCH();
+}
+L_Ret:
+L_RetVoid: {
+	POLL();
+	int32_t result = ip->handler == &&L_Ret ? r[ip->a] : 0;
+	if (frames.empty()){
+		if (COUNT) myExecuted = executed;
+		return;
+	}
+	Frame & frame = frames.back();
+	fnCode = frame.code;
+	ip = frame.ret;
+	base = frame.base;
+	frameSize = frame.size;
+	r = stack.data() + base;
+	if (frame.dst >= 0) r[frame.dst] = result;
+	frames.pop_back();
+	DISPATCH();
+}
+L_Jump: POLL(); ip = fnCode + ip->a; DISPATCH();
+L_JumpIf: JUMP_IF(r[ip->a], ip->b);
+L_JumpIfNot: JUMP_IF(!r[ip->a], ip->b);
+L_Read: r[ip->a] = lilc_rt_read_int(); NEXT();
+L_Write: lilc_rt_write_int(r[ip->a]); NEXT();
+L_WriteStr: lilc_rt_write_str(myModule.strings.text(ip->a)); NEXT();
+L_Count: myCounters[ip->a]++; NEXT();
+L_AddImm: IMMEDIATE(x + y);
+L_SubImm: IMMEDIATE(x - y);
+L_MulImm: IMMEDIATE(x * y);
+L_JumpLt: JUMP_IF(r[ip->a] < r[ip->b], ip->c);
+L_JumpGt: JUMP_IF(r[ip->a] > r[ip->b], ip->c);
+L_JumpLe: JUMP_IF(r[ip->a] <= r[ip->b], ip->c);
+L_JumpGe: JUMP_IF(r[ip->a] >= r[ip->b], ip->c);
+L_JumpEq: JUMP_IF(r[ip->a] == r[ip->b], ip->c);
+L_JumpNe: JUMP_IF(r[ip->a] != r[ip->b], ip->c);
+L_JumpLtImm: JUMP_IF(r[ip->a] < ip->b, ip->c);
+L_JumpGtImm: JUMP_IF(r[ip->a] > ip->b, ip->c);
+L_JumpLeImm: JUMP_IF(r[ip->a] <= ip->b, ip->c);
+L_JumpGeImm: JUMP_IF(r[ip->a] >= ip->b, ip->c);
+L_JumpEqImm: JUMP_IF(r[ip->a] == ip->b, ip->c);
+L_JumpNeImm: JUMP_IF(r[ip->a] != ip->b, ip->c);
+
+#undef IMMEDIATE
+#undef BINARY
+#undef JUMP_IF
+#undef POLL
+#undef NEXT
+#undef DISPATCH
+}
+
+} // End namespace LILC